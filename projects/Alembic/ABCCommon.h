@@ -18,6 +18,9 @@ extern Alembic::AbcGeom::IArchive readABC(std::string const &path);
 
 extern std::shared_ptr<zeno::ListObject> get_xformed_prims(std::shared_ptr<zeno::ABCTree> abctree);
 
+// clones of all prims in the tree, with their xforms applied if use_xform
+extern std::shared_ptr<zeno::ListObject> get_alembic_prims(std::shared_ptr<zeno::ABCTree> abctree, bool use_xform);
+
 extern std::shared_ptr<PrimitiveObject> get_alembic_prim(std::shared_ptr<zeno::ABCTree> abctree, int index);
 
 extern void flipFrontBack(std::shared_ptr<PrimitiveObject> &prim);
@@ -196,16 +196,8 @@ struct AlembicToSoftBodyVAT: public INode {
             for (int32_t idx = frameStart; idx < frameEnd; ++idx) {
                 const int32_t frameIndex = frameEnd - idx - 1;
                 auto abctree = std::make_shared<ABCTree>();
-                auto prims = std::make_shared<zeno::ListObject>();
                 traverseABC(obj, *abctree, idx, read_done);
-                if (use_xform) {
-                    prims = get_xformed_prims(abctree);
-                } else {
-                    abctree->visitPrims([&] (auto const &p) {
-                        auto np = std::static_pointer_cast<PrimitiveObject>(p->clone());
-                        prims->arr.push_back(np);
-                    });
-                }
+                auto prims = get_alembic_prims(abctree, use_xform);
                 auto mergedPrim = zeno::primMerge(prims->getRaw<PrimitiveObject>());
                 if (get_input2<bool>("flipFrontBack")) {
                     flipFrontBack(mergedPrim);
@@ -390,16 +382,8 @@ struct AlembicToDynamicRemeshVAT : public INode {
       for (int32_t idx = frameStart; idx < frameEnd; ++idx) {
         const int32_t frameIndex = frameEnd - idx - 1;
         auto abctree = std::make_shared<ABCTree>();
-        auto prims = std::make_shared<zeno::ListObject>();
         traverseABC(obj, *abctree, idx, read_done);
-        if (use_xform) {
-          prims = get_xformed_prims(abctree);
-        } else {
-          abctree->visitPrims([&] (auto const &p) {
-            auto np = std::static_pointer_cast<PrimitiveObject>(p->clone());
-            prims->arr.push_back(np);
-          });
-        }
+        auto prims = get_alembic_prims(abctree, use_xform);
         auto mergedPrim = zeno::primMerge(prims->getRaw<PrimitiveObject>());
         if (shouldFlipFrontBack) {
           flipFrontBack(mergedPrim);
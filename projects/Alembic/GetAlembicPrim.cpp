@@ -40,12 +40,14 @@ ZENDEFNODE(CountAlembicPrims, {
 });
 
 void flipFrontBack(std::shared_ptr<PrimitiveObject> &prim) {
-    for (auto i = 0; i < prim->polys.size(); i++) {
+    int *uvs = prim->loops.has_attr("uvs") ? prim->loops.attr<int>("uvs").data() : nullptr;
+#pragma omp parallel for
+    for (intptr_t i = 0; i < (intptr_t)prim->polys.size(); i++) {
         auto [base, cnt] = prim->polys[i];
         for (int j = 0; j < (cnt / 2); j++) {
             std::swap(prim->loops[base + j], prim->loops[base + cnt - 1 - j]);
-            if (prim->loops.has_attr("uvs")) {
-                std::swap(prim->loops.attr<int>("uvs")[base + j], prim->loops.attr<int>("uvs")[base + cnt - 1 - j]);
+            if (uvs) {
+                std::swap(uvs[base + j], uvs[base + cnt - 1 - j]);
             }
         }
     }
@@ -117,8 +119,8 @@ get_xformed_prims(
     std::vector<std::shared_ptr<ABCTree>> linear_abctrees;
     std::vector<int> linear_abctree_parent;
     dfs_abctree(abctree, -1, linear_abctrees, linear_abctree_parent);
-    std::shared_ptr<PrimitiveObject> prim;
     std::vector<Alembic::Abc::M44d> transforms;
+    std::vector<int> prim_nodes;
     for (auto i = 0; i < linear_abctrees.size(); i++) {
         auto const& abc_node = linear_abctrees[i];
         int parent_index = linear_abctree_parent[i];
@@ -128,15 +130,41 @@ get_xformed_prims(
             transforms.push_back(abc_node->xform);
         }
         if (abc_node->prim) {
-            prim = std::static_pointer_cast<PrimitiveObject>(abc_node->prim->clone());
-            auto& mat = transforms.back();
-            for (auto& p: prim->verts) {
-                auto pos = Imath::V4d(p[0], p[1], p[2], 1) * mat;
-                p = zeno::vec3f((float)pos.x, (float)pos.y, (float)pos.z);
-            }
-            prims->arr.push_back(prim);
+            prim_nodes.push_back(i);
         }
     }
+    // transforms are accumulated serially above, the prims are cloned and transformed in parallel
+    prims->arr.resize(prim_nodes.size());
+#pragma omp parallel for schedule(dynamic) if (prim_nodes.size() > 1)
+    for (intptr_t k = 0; k < (intptr_t)prim_nodes.size(); k++) {
+        auto prim = std::static_pointer_cast<PrimitiveObject>(linear_abctrees[prim_nodes[k]]->prim->clone());
+        auto const& mat = transforms[prim_nodes[k]];
+        auto &verts = prim->verts.values;
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)verts.size(); i++) {
+            auto &p = verts[i];
+            auto pos = Imath::V4d(p[0], p[1], p[2], 1) * mat;
+            p = zeno::vec3f((float)pos.x, (float)pos.y, (float)pos.z);
+        }
+        prims->arr[k] = std::move(prim);
+    }
+    return prims;
+}
+
+std::shared_ptr<zeno::ListObject> get_alembic_prims(std::shared_ptr<zeno::ABCTree> abctree, bool use_xform) {
+    if (use_xform) {
+        return get_xformed_prims(abctree);
+    }
+    std::vector<std::shared_ptr<PrimitiveObject>> found;
+    abctree->visitPrims([&] (auto const &p) {
+        found.push_back(p);
+    });
+    auto prims = std::make_shared<zeno::ListObject>();
+    prims->arr.resize(found.size());
+#pragma omp parallel for schedule(dynamic)
+    for (intptr_t i = 0; i < (intptr_t)found.size(); i++) {
+        prims->arr[i] = found[i]->clone();
+    }
     return prims;
 }
 struct GetAlembicPrim : INode {
@@ -176,16 +204,8 @@ ZENDEFNODE(GetAlembicPrim, {
 struct AllAlembicPrim : INode {
     virtual void apply() override {
         auto abctree = get_input<ABCTree>("abctree");
-        auto prims = std::make_shared<zeno::ListObject>();
         int use_xform = get_input<NumericObject>("use_xform")->get<int>();
-        if (use_xform) {
-            prims = get_xformed_prims(abctree);
-        } else {
-            abctree->visitPrims([&] (auto const &p) {
-                auto np = std::static_pointer_cast<PrimitiveObject>(p->clone());
-                prims->arr.push_back(np);
-            });
-        }
+        auto prims = get_alembic_prims(abctree, use_xform);
         auto outprim = zeno::primMerge(prims->getRaw<PrimitiveObject>());
         if (get_input2<bool>("flipFrontBack")) {
             flipFrontBack(outprim);
@@ -312,15 +332,7 @@ struct ImportAlembicPrim : INode {
         auto index = get_input2<int>("index");
         std::shared_ptr<PrimitiveObject> outprim;
         if (index == -1) {
-            auto prims = std::make_shared<zeno::ListObject>();
-            if (use_xform) {
-                prims = get_xformed_prims(abctree);
-            } else {
-                abctree->visitPrims([&] (auto const &p) {
-                    auto np = std::static_pointer_cast<PrimitiveObject>(p->clone());
-                    prims->arr.push_back(np);
-                });
-            }
+            auto prims = get_alembic_prims(abctree, use_xform);
             outprim = zeno::primMerge(prims->getRaw<PrimitiveObject>());
         }
         else {
@@ -17,6 +17,12 @@
 #include <cstring>
 #include <cstdio>
 #include <filesystem>
+#include <functional>
+#include <future>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <type_traits>
 
 using namespace Alembic::AbcGeom;
 
@@ -40,42 +46,61 @@ static void read_velocity(std::shared_ptr<PrimitiveObject> prim, V3fArraySampleP
             log_info("[alembic] totally {} velocities", marr->size());
         }
         auto &parr = prim->add_attr<vec3f>("v");
-        for (size_t i = 0; i < marr->size(); i++) {
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
             auto const &val = (*marr)[i];
             parr[i] = {val[0], val[1], val[2]};
         }
     }
 }
 
-static void read_attributes(std::shared_ptr<PrimitiveObject> prim, ICompoundProperty arbattrs, const ISampleSelector &iSS, bool read_done) {
+// a geom param is either an array property or, when indexed, a compound of .vals and .indices
+static bool is_constant_property(ICompoundProperty parent, const PropertyHeader &p) {
+    if (p.isArray()) {
+        return IArrayProperty(parent, p.getName()).isConstant();
+    } else if (p.isScalar()) {
+        return IScalarProperty(parent, p.getName()).isConstant();
+    }
+    ICompoundProperty comp(parent, p.getName());
+    for (size_t i = 0; i < comp.getNumProperties(); i++) {
+        if (!is_constant_property(comp, comp.getPropertyHeader(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void read_attributes(std::shared_ptr<PrimitiveObject> prim, ICompoundProperty arbattrs, const ISampleSelector &iSS, bool read_done, bool varying_only = false) {
     if (!arbattrs) {
         return;
     }
     size_t numProps = arbattrs.getNumProperties();
     for (auto i = 0; i < numProps; i++) {
         PropertyHeader p = arbattrs.getPropertyHeader(i);
+        if (varying_only && is_constant_property(arbattrs, p)) {
+            continue;
+        }
         if (IFloatGeomParam::matches(p)) {
             IFloatGeomParam param(arbattrs, p.getName());
 
             IFloatGeomParam::Sample samp = param.getIndexedValue(iSS);
-            std::vector<float> data;
-            data.resize(samp.getVals()->size());
-            for (auto i = 0; i < samp.getVals()->size(); i++) {
-                data[i] = samp.getVals()->get()[i];
-            }
+            auto vals = samp.getVals();
+            std::vector<float> data(vals->get(), vals->get() + vals->size());
             if (!read_done) {
                 log_info("[alembic] float attr {}, len {}.", p.getName(), data.size());
             }
 
             if (prim->verts.size() == data.size()) {
                 auto &attr = prim->add_attr<float>(p.getName());
-                for (auto i = 0; i < prim->verts.size(); i++) {
+#pragma omp parallel for
+                for (intptr_t i = 0; i < (intptr_t)prim->verts.size(); i++) {
                     attr[i] = data[i];
                 }
             }
             else if (prim->verts.size() * 3 == data.size()) {
                 auto &attr = prim->add_attr<zeno::vec3f>(p.getName());
-                for (auto i = 0; i < prim->verts.size(); i++) {
+#pragma omp parallel for
+                for (intptr_t i = 0; i < (intptr_t)prim->verts.size(); i++) {
                     attr[i] = { data[ 3 * i], data[3 * i + 1], data[3 * i + 2]};
                 }
             }
@@ -89,18 +114,16 @@ static void read_attributes(std::shared_ptr<PrimitiveObject> prim, ICompoundProp
             IInt32GeomParam param(arbattrs, p.getName());
 
             IInt32GeomParam::Sample samp = param.getIndexedValue(iSS);
-            std::vector<int> data;
-            data.resize(samp.getVals()->size());
-            for (auto i = 0; i < samp.getVals()->size(); i++) {
-                data[i] = samp.getVals()->get()[i];
-            }
+            auto vals = samp.getVals();
+            std::vector<int> data(vals->get(), vals->get() + vals->size());
             if (!read_done) {
                 log_info("[alembic] i32 attr {}, len {}.", p.getName(), data.size());
             }
 
             if (prim->verts.size() == data.size()) {
                 auto &attr = prim->add_attr<int>(p.getName());
-                for (auto i = 0; i < prim->verts.size(); i++) {
+#pragma omp parallel for
+                for (intptr_t i = 0; i < (intptr_t)prim->verts.size(); i++) {
                     attr[i] = data[i];
                 }
             }
@@ -118,8 +141,10 @@ static void read_attributes(std::shared_ptr<PrimitiveObject> prim, ICompoundProp
             IV3fGeomParam::Sample samp = param.getIndexedValue(iSS);
             if (prim->verts.size() == samp.getVals()->size()) {
                 auto &attr = prim->add_attr<zeno::vec3f>(p.getName());
-                for (auto i = 0; i < prim->verts.size(); i++) {
-                    auto v = samp.getVals()->get()[i];
+                auto vals = samp.getVals()->get();
+#pragma omp parallel for
+                for (intptr_t i = 0; i < (intptr_t)prim->verts.size(); i++) {
+                    auto v = vals[i];
                     attr[i] = {v[0], v[1], v[2]};
                 }
             }
@@ -132,8 +157,10 @@ static void read_attributes(std::shared_ptr<PrimitiveObject> prim, ICompoundProp
             IN3fGeomParam::Sample samp = param.getIndexedValue(iSS);
             if (prim->verts.size() == samp.getVals()->size()) {
                 auto &attr = prim->add_attr<zeno::vec3f>(p.getName());
-                for (auto i = 0; i < prim->verts.size(); i++) {
-                    auto v = samp.getVals()->get()[i];
+                auto vals = samp.getVals()->get();
+#pragma omp parallel for
+                for (intptr_t i = 0; i < (intptr_t)prim->verts.size(); i++) {
+                    auto v = vals[i];
                     attr[i] = {v[0], v[1], v[2]};
                 }
             }
@@ -146,8 +173,10 @@ static void read_attributes(std::shared_ptr<PrimitiveObject> prim, ICompoundProp
             IC3fGeomParam::Sample samp = param.getIndexedValue(iSS);
             if (prim->verts.size() == samp.getVals()->size()) {
                 auto &attr = prim->add_attr<zeno::vec3f>(p.getName());
-                for (auto i = 0; i < prim->verts.size(); i++) {
-                    auto v = samp.getVals()->get()[i];
+                auto vals = samp.getVals()->get();
+#pragma omp parallel for
+                for (intptr_t i = 0; i < (intptr_t)prim->verts.size(); i++) {
+                    auto v = vals[i];
                     attr[i] = {v[0], v[1], v[2]};
                 }
             }
@@ -217,6 +246,61 @@ static void read_user_data(std::shared_ptr<PrimitiveObject> prim, ICompoundPrope
     }
 }
 
+static void read_uvs(std::shared_ptr<PrimitiveObject> prim, IV2fGeomParam uv, const ISampleSelector &iSS, bool read_done) {
+    auto uvsamp = uv.getIndexedValue(iSS);
+    int value_size = (int)uvsamp.getVals()->size();
+    int index_size = (int)uvsamp.getIndices()->size();
+    if (!read_done) {
+        log_debug("[alembic] totally {} uv value", value_size);
+        log_debug("[alembic] totally {} uv indices", index_size);
+        if (prim->loops.size() == index_size) {
+            log_debug("[alembic] uv per face");
+        } else if (prim->verts.size() == index_size) {
+            log_debug("[alembic] uv per vertex");
+        } else {
+            log_error("[alembic] error uv indices");
+        }
+    }
+    prim->uvs.resize(value_size);
+    {
+        auto marr = uvsamp.getVals();
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
+            auto const &val = (*marr)[i];
+            prim->uvs[i] = {val[0], val[1]};
+        }
+    }
+    if (prim->loops.size() == index_size) {
+        auto &uvs = prim->loops.add_attr<int>("uvs");
+        auto const &indices = *uvsamp.getIndices();
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)prim->loops.size(); i++) {
+            uvs[i] = indices[i];
+        }
+    }
+    else if (prim->verts.size() == index_size) {
+        auto &uvs = prim->loops.add_attr<int>("uvs");
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)prim->loops.size(); i++) {
+            uvs[i] = prim->loops[i];
+        }
+    }
+}
+
+static void read_normals(std::shared_ptr<PrimitiveObject> prim, IN3fGeomParam nrm, const ISampleSelector &iSS) {
+    auto nrmsamp = nrm.getIndexedValue(iSS);
+    int value_size = (int)nrmsamp.getVals()->size();
+    if (value_size == prim->verts.size()) {
+        auto &nrms = prim->verts.add_attr<vec3f>("nrm");
+        auto marr = nrmsamp.getVals();
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
+            auto const &n = (*marr)[i];
+            nrms[i] = {n[0], n[1], n[2]};
+        }
+    }
+}
+
 static std::shared_ptr<PrimitiveObject> foundABCMesh(Alembic::AbcGeom::IPolyMeshSchema &mesh, int frameid, bool read_done) {
     auto prim = std::make_shared<PrimitiveObject>();
 
@@ -234,25 +318,17 @@ static std::shared_ptr<PrimitiveObject> foundABCMesh(Alembic::AbcGeom::IPolyMesh
             log_debug("[alembic] totally {} positions", marr->size());
         }
         auto &parr = prim->verts;
-        for (size_t i = 0; i < marr->size(); i++) {
+        parr.resize(marr->size());
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
             auto const &val = (*marr)[i];
-            parr.emplace_back(val[0], val[1], val[2]);
+            parr[i] = {val[0], val[1], val[2]};
         }
     }
 
     read_velocity(prim, mesamp.getVelocities(), read_done);
     if (auto nrm = mesh.getNormalsParam()) {
-        auto nrmsamp =
-                nrm.getIndexedValue(Alembic::Abc::v12::ISampleSelector((Alembic::AbcCoreAbstract::index_t)sample_index));
-        int value_size = (int)nrmsamp.getVals()->size();
-        if (value_size == prim->verts.size()) {
-            auto &nrms = prim->verts.add_attr<vec3f>("nrm");
-            auto marr = nrmsamp.getVals();
-            for (size_t i = 0; i < marr->size(); i++) {
-                auto const &n = (*marr)[i];
-                nrms[i] = {n[0], n[1], n[2]};
-            }
-        }
+        read_normals(prim, nrm, iSS);
     }
 
     if (auto marr = mesamp.getFaceIndices()) {
@@ -260,9 +336,10 @@ static std::shared_ptr<PrimitiveObject> foundABCMesh(Alembic::AbcGeom::IPolyMesh
             log_debug("[alembic] totally {} face indices", marr->size());
         }
         auto &parr = prim->loops;
-        for (size_t i = 0; i < marr->size(); i++) {
-            int ind = (*marr)[i];
-            parr.push_back(ind);
+        parr.resize(marr->size());
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
+            parr[i] = (*marr)[i];
         }
     }
 
@@ -272,6 +349,7 @@ static std::shared_ptr<PrimitiveObject> foundABCMesh(Alembic::AbcGeom::IPolyMesh
         }
         auto &loops = prim->loops;
         auto &parr = prim->polys;
+        parr.reserve(marr->size());
         int base = 0;
         for (size_t i = 0; i < marr->size(); i++) {
             int cnt = (*marr)[i];
@@ -280,41 +358,7 @@ static std::shared_ptr<PrimitiveObject> foundABCMesh(Alembic::AbcGeom::IPolyMesh
         }
     }
     if (auto uv = mesh.getUVsParam()) {
-        auto uvsamp =
-            uv.getIndexedValue(Alembic::Abc::v12::ISampleSelector((Alembic::AbcCoreAbstract::index_t)sample_index));
-        int value_size = (int)uvsamp.getVals()->size();
-        int index_size = (int)uvsamp.getIndices()->size();
-        if (!read_done) {
-            log_debug("[alembic] totally {} uv value", value_size);
-            log_debug("[alembic] totally {} uv indices", index_size);
-            if (prim->loops.size() == index_size) {
-                log_debug("[alembic] uv per face");
-            } else if (prim->verts.size() == index_size) {
-                log_debug("[alembic] uv per vertex");
-            } else {
-                log_error("[alembic] error uv indices");
-            }
-        }
-        prim->uvs.resize(value_size);
-        {
-            auto marr = uvsamp.getVals();
-            for (size_t i = 0; i < marr->size(); i++) {
-                auto const &val = (*marr)[i];
-                prim->uvs[i] = {val[0], val[1]};
-            }
-        }
-        if (prim->loops.size() == index_size) {
-            prim->loops.add_attr<int>("uvs");
-            for (auto i = 0; i < prim->loops.size(); i++) {
-                prim->loops.attr<int>("uvs")[i] = (*uvsamp.getIndices())[i];
-            }
-        }
-        else if (prim->verts.size() == index_size) {
-            prim->loops.add_attr<int>("uvs");
-            for (auto i = 0; i < prim->loops.size(); i++) {
-                prim->loops.attr<int>("uvs")[i] = prim->loops[i];
-            }
-        }
+        read_uvs(prim, uv, iSS, read_done);
     }
     if (!prim->loops.has_attr("uvs")) {
         if (!read_done) {
@@ -323,9 +367,6 @@ static std::shared_ptr<PrimitiveObject> foundABCMesh(Alembic::AbcGeom::IPolyMesh
         prim->uvs.resize(1);
         prim->uvs[0] = zeno::vec2f(0, 0);
         prim->loops.add_attr<int>("uvs");
-        for (auto i = 0; i < prim->loops.size(); i++) {
-            prim->loops.attr<int>("uvs")[i] = 0;
-        }
     }
     ICompoundProperty arbattrs = mesh.getArbGeomParams();
     read_attributes(prim, arbattrs, iSS, read_done);
@@ -352,9 +393,11 @@ static std::shared_ptr<PrimitiveObject> foundABCSubd(Alembic::AbcGeom::ISubDSche
             log_debug("[alembic] totally {} positions", marr->size());
         }
         auto &parr = prim->verts;
-        for (size_t i = 0; i < marr->size(); i++) {
+        parr.resize(marr->size());
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
             auto const &val = (*marr)[i];
-            parr.emplace_back(val[0], val[1], val[2]);
+            parr[i] = {val[0], val[1], val[2]};
         }
     }
 
@@ -365,9 +408,10 @@ static std::shared_ptr<PrimitiveObject> foundABCSubd(Alembic::AbcGeom::ISubDSche
             log_debug("[alembic] totally {} face indices", marr->size());
         }
         auto &parr = prim->loops;
-        for (size_t i = 0; i < marr->size(); i++) {
-            int ind = (*marr)[i];
-            parr.push_back(ind);
+        parr.resize(marr->size());
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
+            parr[i] = (*marr)[i];
         }
     }
 
@@ -377,6 +421,7 @@ static std::shared_ptr<PrimitiveObject> foundABCSubd(Alembic::AbcGeom::ISubDSche
         }
         auto &loops = prim->loops;
         auto &parr = prim->polys;
+        parr.reserve(marr->size());
         int base = 0;
         for (size_t i = 0; i < marr->size(); i++) {
             int cnt = (*marr)[i];
@@ -385,41 +430,7 @@ static std::shared_ptr<PrimitiveObject> foundABCSubd(Alembic::AbcGeom::ISubDSche
         }
     }
     if (auto uv = subd.getUVsParam()) {
-        auto uvsamp =
-            uv.getIndexedValue(Alembic::Abc::v12::ISampleSelector((Alembic::AbcCoreAbstract::index_t)sample_index));
-        int value_size = (int)uvsamp.getVals()->size();
-        int index_size = (int)uvsamp.getIndices()->size();
-        if (!read_done) {
-            log_debug("[alembic] totally {} uv value", value_size);
-            log_debug("[alembic] totally {} uv indices", index_size);
-            if (prim->loops.size() == index_size) {
-                log_debug("[alembic] uv per face");
-            } else if (prim->verts.size() == index_size) {
-                log_debug("[alembic] uv per vertex");
-            } else {
-                log_error("[alembic] error uv indices");
-            }
-        }
-        prim->uvs.resize(value_size);
-        {
-            auto marr = uvsamp.getVals();
-            for (size_t i = 0; i < marr->size(); i++) {
-                auto const &val = (*marr)[i];
-                prim->uvs[i] = {val[0], val[1]};
-            }
-        }
-        if (prim->loops.size() == index_size) {
-            prim->loops.add_attr<int>("uvs");
-            for (auto i = 0; i < prim->loops.size(); i++) {
-                prim->loops.attr<int>("uvs")[i] = (*uvsamp.getIndices())[i];
-            }
-        }
-        else if (prim->verts.size() == index_size) {
-            prim->loops.add_attr<int>("uvs");
-            for (auto i = 0; i < prim->loops.size(); i++) {
-                prim->loops.attr<int>("uvs")[i] = prim->loops[i];
-            }
-        }
+        read_uvs(prim, uv, iSS, read_done);
     }
     if (!prim->loops.has_attr("uvs")) {
         if (!read_done) {
@@ -428,9 +439,6 @@ static std::shared_ptr<PrimitiveObject> foundABCSubd(Alembic::AbcGeom::ISubDSche
         prim->uvs.resize(1);
         prim->uvs[0] = zeno::vec2f(0, 0);
         prim->loops.add_attr<int>("uvs");
-        for (auto i = 0; i < prim->loops.size(); i++) {
-            prim->loops.attr<int>("uvs")[i] = 0;
-        }
     }
     ICompoundProperty arbattrs = subd.getArbGeomParams();
     read_attributes(prim, arbattrs, iSS, read_done);
@@ -490,9 +498,11 @@ static std::shared_ptr<PrimitiveObject> foundABCPoints(Alembic::AbcGeom::IPoints
             log_info("[alembic] totally {} positions", marr->size());
         }
         auto &parr = prim->verts;
-        for (size_t i = 0; i < marr->size(); i++) {
+        parr.resize(marr->size());
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
             auto const &val = (*marr)[i];
-            parr.emplace_back(val[0], val[1], val[2]);
+            parr[i] = {val[0], val[1], val[2]};
         }
     }
     read_velocity(prim, mesamp.getVelocities(), read_done);
@@ -519,9 +529,11 @@ static std::shared_ptr<PrimitiveObject> foundABCCurves(Alembic::AbcGeom::ICurves
             log_info("[alembic] totally {} positions", marr->size());
         }
         auto &parr = prim->verts;
-        for (size_t i = 0; i < marr->size(); i++) {
+        parr.resize(marr->size());
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
             auto const &val = (*marr)[i];
-            parr.emplace_back(val[0], val[1], val[2]);
+            parr[i] = {val[0], val[1], val[2]};
         }
     }
     read_velocity(prim, mesamp.getVelocities(), read_done);
@@ -544,11 +556,15 @@ static std::shared_ptr<PrimitiveObject> foundABCCurves(Alembic::AbcGeom::ICurves
     return prim;
 }
 
-void traverseABC(
+using ABCJobs = std::vector<std::function<void()>>;
+
+// the hierarchy is walked serially, the geometry found is decoded by runABCJobs afterwards
+static void collectABC(
     Alembic::AbcGeom::IObject &obj,
     ABCTree &tree,
     int frameid,
-    bool read_done
+    bool read_done,
+    ABCJobs &jobs
 ) {
     {
         auto const &md = obj.getMetaData();
@@ -556,6 +572,7 @@ void traverseABC(
             log_debug("[alembic] meta data: [{}]", md.serialize());
         }
         tree.name = obj.getName();
+        ABCTree *t = &tree;
 
         if (Alembic::AbcGeom::IPolyMesh::matches(md)) {
             if (!read_done) {
@@ -563,9 +580,10 @@ void traverseABC(
             }
 
             Alembic::AbcGeom::IPolyMesh meshy(obj);
-            auto &mesh = meshy.getSchema();
-            tree.prim = foundABCMesh(mesh, frameid, read_done);
-            tree.prim->userData().set2("_abc_name", obj.getName());
+            jobs.push_back([=] () mutable {
+                t->prim = foundABCMesh(meshy.getSchema(), frameid, read_done);
+                t->prim->userData().set2("_abc_name", t->name);
+            });
         } else if (Alembic::AbcGeom::IXformSchema::matches(md)) {
             if (!read_done) {
                 log_debug("[alembic] found a Xform [{}]", obj.getName());
@@ -585,25 +603,28 @@ void traverseABC(
                 log_debug("[alembic] found points [{}]", obj.getName());
             }
             Alembic::AbcGeom::IPoints points(obj);
-            auto &points_sch = points.getSchema();
-            tree.prim = foundABCPoints(points_sch, frameid, read_done);
-            tree.prim->userData().set2("_abc_name", obj.getName());
+            jobs.push_back([=] () mutable {
+                t->prim = foundABCPoints(points.getSchema(), frameid, read_done);
+                t->prim->userData().set2("_abc_name", t->name);
+            });
         } else if(Alembic::AbcGeom::ICurvesSchema::matches(md)) {
             if (!read_done) {
                 log_debug("[alembic] found curves [{}]", obj.getName());
             }
             Alembic::AbcGeom::ICurves curves(obj);
-            auto &curves_sch = curves.getSchema();
-            tree.prim = foundABCCurves(curves_sch, frameid, read_done);
-            tree.prim->userData().set2("_abc_name", obj.getName());
+            jobs.push_back([=] () mutable {
+                t->prim = foundABCCurves(curves.getSchema(), frameid, read_done);
+                t->prim->userData().set2("_abc_name", t->name);
+            });
         } else if (Alembic::AbcGeom::ISubDSchema::matches(md)) {
             if (!read_done) {
                 log_debug("[alembic] found SubD [{}]", obj.getName());
             }
             Alembic::AbcGeom::ISubD subd(obj);
-            auto &subd_sch = subd.getSchema();
-            tree.prim = foundABCSubd(subd_sch, frameid, read_done);
-            tree.prim->userData().set2("_abc_name", obj.getName());
+            jobs.push_back([=] () mutable {
+                t->prim = foundABCSubd(subd.getSchema(), frameid, read_done);
+                t->prim->userData().set2("_abc_name", t->name);
+            });
         }
     }
 
@@ -621,30 +642,249 @@ void traverseABC(
         Alembic::AbcGeom::IObject child(obj, name);
 
         auto childTree = std::make_shared<ABCTree>();
-        traverseABC(child, *childTree, frameid, read_done);
+        collectABC(child, *childTree, frameid, read_done, jobs);
+        tree.children.push_back(std::move(childTree));
+    }
+}
+
+static std::string readABCHeader(std::string const &native_path) {
+    char buf[5];
+    std::memset(buf, 0, 5);
+    auto fp = std::fopen(native_path.c_str(), "rb");
+    if (!fp)
+        return {};
+    std::fread(buf, 4, 1, fp);
+    std::fclose(fp);
+    return buf;
+}
+
+// Ogawa archives are opened by readABC with a stream per thread and can be read from
+// several threads at once, HDF5 ones can't, their objects are decoded one after another
+static bool canReadConcurrently(Alembic::AbcGeom::IObject &obj) {
+    return readABCHeader(obj.getArchive().getName()) == "Ogaw";
+}
+
+// one object per task, an object's own per-element loops go parallel when it is the only one
+static void runABCJobs(ABCJobs &jobs, bool concurrent) {
+    std::vector<std::exception_ptr> errors(jobs.size());
+#pragma omp parallel for schedule(dynamic) if (concurrent && jobs.size() > 1)
+    for (intptr_t i = 0; i < (intptr_t)jobs.size(); i++) {
+        try {
+            jobs[i]();
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }
+    for (auto const &e: errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+void traverseABC(
+    Alembic::AbcGeom::IObject &obj,
+    ABCTree &tree,
+    int frameid,
+    bool read_done
+) {
+    ABCJobs jobs;
+    collectABC(obj, tree, frameid, read_done, jobs);
+    runABCJobs(jobs, canReadConcurrently(obj));
+}
+
+// what ReadAlembic keeps from frame to frame: the object hierarchy with its schemas already
+// opened, and for geometry whose topology doesn't change, the first sample read (topology,
+// uvs, constant attributes), which later frames copy and refresh only the varying parts of
+struct ABCCacheNode {
+    enum Kind { Other, Mesh, SubD, Points, Curves, Xform, Camera };
+    Kind kind = Other;
+    std::string name;
+    IPolyMesh mesh;
+    ISubD subd;
+    IPoints points;
+    ICurves curves;
+    IXform xform;
+    ICamera camera;
+    bool reuse = false;
+    std::shared_ptr<PrimitiveObject> base;
+    std::vector<std::shared_ptr<ABCCacheNode>> children;
+};
+
+template <class Schema>
+static ISampleSelector sample_selector(Schema &schema, int frameid) {
+    std::shared_ptr<Alembic::AbcCoreAbstract::v12::TimeSampling> time = schema.getTimeSampling();
+    float time_per_cycle =  time->getTimeSamplingType().getTimePerCycle();
+    double start = time->getStoredTimes().front();
+    int start_frame = (int)std::round(start / time_per_cycle );
+    int sample_index = clamp(frameid - start_frame, 0, (int)schema.getNumSamples() - 1);
+    return Alembic::Abc::v12::ISampleSelector((Alembic::AbcCoreAbstract::index_t)sample_index);
+}
+
+// reads the time-varying properties of a sample into a copy of the cached one,
+// false if the point count changed after all and the sample has to be read in full
+template <class Schema>
+static bool read_varying(Schema &schema, std::shared_ptr<PrimitiveObject> prim, const ISampleSelector &iSS, bool read_done) {
+    auto pos = schema.getPositionsProperty();
+    if (!pos.isConstant()) {
+        auto marr = pos.getValue(iSS);
+        if (marr->size() != prim->verts.size()) {
+            return false;
+        }
+        auto &parr = prim->verts.values;
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)marr->size(); i++) {
+            auto const &val = (*marr)[i];
+            parr[i] = {val[0], val[1], val[2]};
+        }
+    }
+    auto vel = schema.getVelocitiesProperty();
+    if (vel.valid() && !vel.isConstant()) {
+        auto marr = vel.getValue(iSS);
+        if (marr->size() != prim->verts.size()) {
+            return false;
+        }
+        read_velocity(prim, marr, read_done);
+    }
+    if constexpr (std::is_same_v<Schema, IPolyMeshSchema>) {
+        auto nrm = schema.getNormalsParam();
+        if (nrm.valid() && !nrm.isConstant()) {
+            read_normals(prim, nrm, iSS);
+        }
+    }
+    if constexpr (std::is_same_v<Schema, IPolyMeshSchema> || std::is_same_v<Schema, ISubDSchema>) {
+        auto uv = schema.getUVsParam();
+        if (uv.valid() && !uv.isConstant()) {
+            read_uvs(prim, uv, iSS, read_done);
+        }
+    }
+    read_attributes(prim, schema.getArbGeomParams(), iSS, read_done, true);
+    read_user_data(prim, schema.getUserProperties(), iSS, read_done);
+    return true;
+}
+
+template <class Schema>
+static std::shared_ptr<PrimitiveObject> read_cached_geom(
+    Schema &schema,
+    ABCCacheNode &node,
+    int frameid,
+    bool read_done,
+    std::shared_ptr<PrimitiveObject> (*read_full)(Schema &, int, bool)
+) {
+    if (!node.reuse) {
+        return read_full(schema, frameid, read_done);
+    }
+    if (!node.base) {
+        node.base = read_full(schema, frameid, read_done);
+        return std::make_shared<PrimitiveObject>(*node.base);
+    }
+    auto prim = std::make_shared<PrimitiveObject>(*node.base);
+    if (!read_varying(schema, prim, sample_selector(schema, frameid), read_done)) {
+        return read_full(schema, frameid, read_done);
+    }
+    return prim;
+}
+
+static void buildABCCache(Alembic::AbcGeom::IObject &obj, ABCCacheNode &node, bool read_done) {
+    auto const &md = obj.getMetaData();
+    node.name = obj.getName();
+
+    if (Alembic::AbcGeom::IPolyMesh::matches(md)) {
+        node.kind = ABCCacheNode::Mesh;
+        node.mesh = Alembic::AbcGeom::IPolyMesh(obj);
+        node.reuse = node.mesh.getSchema().getTopologyVariance() != kHeterogenousTopology;
+    } else if (Alembic::AbcGeom::IXformSchema::matches(md)) {
+        node.kind = ABCCacheNode::Xform;
+        node.xform = Alembic::AbcGeom::IXform(obj);
+    } else if (Alembic::AbcGeom::ICameraSchema::matches(md)) {
+        node.kind = ABCCacheNode::Camera;
+        node.camera = Alembic::AbcGeom::ICamera(obj);
+    } else if (Alembic::AbcGeom::IPointsSchema::matches(md)) {
+        node.kind = ABCCacheNode::Points;
+        node.points = Alembic::AbcGeom::IPoints(obj);
+        node.reuse = node.points.getSchema().getPositionsProperty().isConstant();
+    } else if (Alembic::AbcGeom::ICurvesSchema::matches(md)) {
+        node.kind = ABCCacheNode::Curves;
+        node.curves = Alembic::AbcGeom::ICurves(obj);
+        node.reuse = node.curves.getSchema().getTopologyVariance() != kHeterogenousTopology;
+    } else if (Alembic::AbcGeom::ISubDSchema::matches(md)) {
+        node.kind = ABCCacheNode::SubD;
+        node.subd = Alembic::AbcGeom::ISubD(obj);
+        node.reuse = node.subd.getSchema().getTopologyVariance() != kHeterogenousTopology;
+    }
+    if (!read_done && node.kind != ABCCacheNode::Other) {
+        log_debug("[alembic] found [{}], topology {}", node.name, node.reuse ? "cached" : "varying");
+    }
+
+    size_t nch = obj.getNumChildren();
+    for (size_t i = 0; i < nch; i++) {
+        Alembic::AbcGeom::IObject child(obj, obj.getChildHeader(i).getName());
+        auto childNode = std::make_shared<ABCCacheNode>();
+        buildABCCache(child, *childNode, read_done);
+        node.children.push_back(std::move(childNode));
+    }
+}
+
+static std::shared_ptr<PrimitiveObject> readCachedPrim(ABCCacheNode &node, int frameid, bool read_done) {
+    switch (node.kind) {
+    case ABCCacheNode::Mesh:
+        return read_cached_geom(node.mesh.getSchema(), node, frameid, read_done, foundABCMesh);
+    case ABCCacheNode::SubD:
+        return read_cached_geom(node.subd.getSchema(), node, frameid, read_done, foundABCSubd);
+    case ABCCacheNode::Points:
+        return read_cached_geom(node.points.getSchema(), node, frameid, read_done, foundABCPoints);
+    case ABCCacheNode::Curves:
+        return read_cached_geom(node.curves.getSchema(), node, frameid, read_done, foundABCCurves);
+    default:
+        return nullptr;
+    }
+}
+
+static void collectCachedABC(ABCCacheNode &node, ABCTree &tree, int frameid, bool read_done, ABCJobs &jobs) {
+    tree.name = node.name;
+    switch (node.kind) {
+    case ABCCacheNode::Xform:
+        tree.xform = foundABCXform(node.xform.getSchema(), frameid);
+        break;
+    case ABCCacheNode::Camera:
+        tree.camera_info = foundABCCamera(node.camera.getSchema(), frameid);
+        break;
+    case ABCCacheNode::Other:
+        break;
+    default:
+        // each job only touches its own cache node
+        jobs.push_back([&node, t = &tree, frameid, read_done] {
+            t->prim = readCachedPrim(node, frameid, read_done);
+            t->prim->userData().set2("_abc_name", node.name);
+        });
+        break;
+    }
+
+    for (auto const &child: node.children) {
+        auto childTree = std::make_shared<ABCTree>();
+        collectCachedABC(*child, *childTree, frameid, read_done, jobs);
         tree.children.push_back(std::move(childTree));
     }
 }
 
+static void readCachedABC(ABCCacheNode &node, ABCTree &tree, int frameid, bool read_done, bool concurrent) {
+    ABCJobs jobs;
+    collectCachedABC(node, tree, frameid, read_done, jobs);
+    runABCJobs(jobs, concurrent);
+}
+
 Alembic::AbcGeom::IArchive readABC(std::string const &path) {
     std::string native_path = std::filesystem::u8path(path).string();
-    std::string hdr;
-    {
-        char buf[5];
-        std::memset(buf, 0, 5);
-        auto fp = std::fopen(native_path.c_str(), "rb");
-        if (!fp)
-            throw Exception("[alembic] cannot open file for read: " + path);
-        std::fread(buf, 4, 1, fp);
-        std::fclose(fp);
-        hdr = buf;
-    }
+    std::string hdr = readABCHeader(native_path);
+    if (hdr.empty())
+        throw Exception("[alembic] cannot open file for read: " + path);
     if (hdr == "\x89HDF") {
         log_info("[alembic] opening as HDF5 format");
         return {Alembic::AbcCoreHDF5::ReadArchive(), native_path};
     } else if (hdr == "Ogaw") {
         log_info("[alembic] opening as Ogawa format");
-        return {Alembic::AbcCoreOgawa::ReadArchive(), native_path};
+        size_t streams = std::max(1u, std::thread::hardware_concurrency());
+        return {Alembic::AbcCoreOgawa::ReadArchive(streams), native_path};
     } else {
         throw Exception("[alembic] unrecognized ABC header: [" + hdr + "]");
     }
@@ -654,6 +894,13 @@ struct ReadAlembic : INode {
     Alembic::Abc::v12::IArchive archive;
     std::string usedPath;
     bool read_done = false;
+    std::shared_ptr<ABCCacheNode> cache;
+    bool concurrent = false;
+    bool prefetchIgnored = false;  // already told the user this archive can't be prefetched
+    int prefetchFrame = 0;
+    // declared last so it is waited for before the cache it reads from is destroyed
+    std::future<std::shared_ptr<ABCTree>> prefetched;
+
     virtual void apply() override {
         int frameid;
         if (has_input("frameid")) {
@@ -661,24 +908,51 @@ struct ReadAlembic : INode {
         } else {
             frameid = getGlobalState()->frameid;
         }
-        auto abctree = std::make_shared<ABCTree>();
-        {
-            auto path = get_input<StringObject>("path")->get();
+        auto path = get_input<StringObject>("path")->get();
+        std::shared_ptr<ABCTree> abctree;
+        if (prefetched.valid()) {
+            // the prefetch shares the archive and cache with us, wait for it before touching either
+            try {
+                auto tree = prefetched.get();
+                if (path == usedPath && frameid == prefetchFrame) {
+                    abctree = std::move(tree);
+                }
+            } catch (...) {
+                // read again below, reporting the error if it persists
+            }
+        }
+        if (!abctree) {
             if (usedPath != path) {
                 read_done = false;
             }
             if (read_done == false) {
                 archive = readABC(path);
-            }
-            double start, _end;
-            GetArchiveStartAndEndTime(archive, start, _end);
-            // fmt::print("GetArchiveStartAndEndTime: {}\n", start);
-            // fmt::print("archive.getNumTimeSamplings: {}\n", archive.getNumTimeSamplings());
-            auto obj = archive.getTop();
-            traverseABC(obj, *abctree, frameid, read_done);
+                cache = std::make_shared<ABCCacheNode>();
+                auto obj = archive.getTop();
+                buildABCCache(obj, *cache, read_done);
+                concurrent = canReadConcurrently(obj);
+                prefetchIgnored = false;
+            }
+            abctree = std::make_shared<ABCTree>();
+            readCachedABC(*cache, *abctree, frameid, read_done, concurrent);
             read_done = true;
             usedPath = path;
         }
+        // the next frame is read while the graph goes on, possibly into other nodes reading
+        // alembic too, which only Ogawa archives (one stream per thread) can take
+        bool prefetch = get_input2<bool>("prefetch");
+        if (prefetch && !concurrent) {
+            if (!prefetchIgnored)
+                log_warn("[alembic] {} is not an Ogawa archive, prefetch ignored", path);
+            prefetchIgnored = true;
+        } else if (prefetch) {
+            prefetchFrame = frameid + 1;
+            prefetched = std::async(std::launch::async, [cache = cache, frame = prefetchFrame, concurrent = concurrent] {
+                auto tree = std::make_shared<ABCTree>();
+                readCachedABC(*cache, *tree, frame, true, concurrent);
+                return tree;
+            });
+        }
         set_output("abctree", std::move(abctree));
     }
 };
@@ -687,6 +961,7 @@ ZENDEFNODE(ReadAlembic, {
     {
         {"readpath", "path"},
         {"frameid"},
+        {"bool", "prefetch", "0"},
     },
     {{"ABCTree", "abctree"}},
     {},
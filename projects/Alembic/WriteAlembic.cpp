@@ -10,28 +10,25 @@
 #include <Alembic/AbcCoreOgawa/All.h>
 #include <Alembic/Abc/ErrorHandler.h>
 #include "ABCTree.h"
+#include <zeno/types/ListObject.h>
+#include <zeno/utils/log.h>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <algorithm>
 #include <numeric>
+#include <variant>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <any>
+#include <set>
 
 using namespace Alembic::AbcGeom;
 namespace zeno {
 namespace {
 
-template<typename T>
-void write_velocity(std::shared_ptr<PrimitiveObject> prim, T& mesh_samp) {
-    if (prim->verts.has_attr("v")) {
-        auto &vel = prim->verts.attr<vec3f>("v");
-        mesh_samp.setVelocities(V3fArraySample( ( const V3f * )vel.data(), vel.size() ));
-    }
-}
-
-static void write_normal(std::shared_ptr<PrimitiveObject> prim, OPolyMeshSchema::Sample& mesh_samp) {
-    if (prim->verts.has_attr("nrm")) {
-        auto &nrm = (std::vector<N3f>&)prim->verts.attr<vec3f>("nrm");
-        ON3fGeomParam::Sample oNormalsSample(nrm, kFacevaryingScope);
-        mesh_samp.setNormals(oNormalsSample);
-    }
-}
-
 struct WriteAlembic : INode {
     OArchive archive;
     OPolyMesh meshyObj;
@@ -196,145 +193,269 @@ ZENDEFNODE(WriteAlembic, {
     {"deprecated"},
 });
 
-struct WriteAlembic2 : INode {
-    OArchive archive;
-    OPolyMesh meshyObj;
-    OPoints pointsObj;
-    std::map<std::string, OFloatGeomParam> attrs;
-    std::map<std::string, std::any> user_attrs;
+using ABCUserValue = std::variant<int, float, vec2i, vec3i, vec2f, vec3f, std::string>;
 
-    template<typename T1, typename T2>
-    void write_attrs(std::shared_ptr<PrimitiveObject> prim, T1& schema, T2& samp) {
-        OCompoundProperty arbAttrs = schema.getArbGeomParams();
-        prim->verts.foreach_attr([&](auto const &key, auto &arr) {
-            if (key == "v" || key == "nrm") {
-                return;
-            }
-            using T = std::decay_t<decltype(arr[0])>;
-            if constexpr (std::is_same_v<T, zeno::vec3f>) {
-                if (attrs.count(key) == 0) {
-                    attrs[key] = OFloatGeomParam(arbAttrs.getPtr(), key, false, kVaryingScope, 3);
-                }
-                auto samp = OFloatGeomParam::Sample();
-                std::vector<float> v(arr.size() * 3);
-                for (auto i = 0; i < arr.size(); i++) {
-                    v[i * 3 + 0] = arr[i][0];
-                    v[i * 3 + 1] = arr[i][1];
-                    v[i * 3 + 2] = arr[i][2];
-                }
-                samp.setVals(v);
-                attrs[key].set(samp);
-            } else if constexpr (std::is_same_v<T, float>) {
-                if (attrs.count(key) == 0) {
-                    attrs[key] = OFloatGeomParam(arbAttrs.getPtr(), key, false, kVaryingScope, 1);
-                }
-                auto samp = OFloatGeomParam::Sample();
-                samp.setVals(arr);
-                attrs[key].set(samp);
-            }
-        });
+// everything one object writes in a frame, copied out of the prim on the graph thread so the
+// prim is free to change while the sample waits to be written; topology, uvs and point ids
+// are only filled in when they differ from the previous frame, alembic repeats the previous
+// sample for what is left out
+struct ABCFrameSample {
+    struct Attr {
+        std::string name;
+        int extent;
+        std::vector<float> vals;
+    };
+
+    std::vector<vec3f> pos;
+    bool topologyChanged = false;
+    std::vector<int32_t> faceIndices;
+    std::vector<int32_t> faceCounts;
+    bool hasUVs = false;
+    bool uvsChanged = false;
+    std::vector<zeno::vec2f> uvs;
+    std::vector<uint32_t> uvIndices;
+    bool hasVel = false;
+    std::vector<vec3f> vel;
+    bool hasNrm = false;
+    std::vector<vec3f> nrm;
+    std::vector<Attr> attrs;
+    std::vector<std::pair<std::string, ABCUserValue>> userData;
+
+    size_t bytes() const {
+        size_t n = pos.size() * sizeof(vec3f) + (vel.size() + nrm.size()) * sizeof(vec3f)
+            + (faceIndices.size() + faceCounts.size() + uvIndices.size()) * sizeof(int32_t)
+            + uvs.size() * sizeof(zeno::vec2f);
+        for (auto const &a: attrs) {
+            n += a.vals.size() * sizeof(float);
+        }
+        return n;
     }
-    void write_user_data(std::shared_ptr<PrimitiveObject> prim, OCompoundProperty& user) {
-        auto &ud = prim->userData();
-        for (const auto& [key, value] : ud.m_data) {
-            if (ud.has<int>(key)) {
-                if (user_attrs.count(key) == 0) {
-                    auto p = OInt32Property(user, key);
-                    p.setTimeSampling(1);
-                    user_attrs[key] = p;
-                }
-                std::any_cast<OInt32Property>(user_attrs[key]).set(ud.get2<int>(key));
+};
+
+// what the graph thread remembers of an object's previous frame to tell what changed
+struct ABCLastFrame {
+    bool valid = false;
+    std::vector<int32_t> faceIndices;
+    std::vector<int32_t> faceCounts;
+    std::vector<zeno::vec2f> uvs;
+    std::vector<uint32_t> uvIndices;
+    size_t numPoints = 0;
+};
+
+// zeno vec's == is per component, compare the raw bytes instead
+template <class T>
+static bool same_array(std::vector<T> const &a, std::vector<T> const &b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+static void build_mesh_topology(PrimitiveObject const *prim, bool flipFrontBack, ABCFrameSample &samp) {
+    auto &vertex_index_per_face = samp.faceIndices;
+    auto &vertex_count_per_face = samp.faceCounts;
+    if (prim->loops.size()) {
+        vertex_index_per_face.reserve(prim->loops.size());
+        vertex_count_per_face.reserve(prim->polys.size());
+        for (const auto& [start, size]: prim->polys) {
+            for (auto i = 0; i < size; i++) {
+                vertex_index_per_face.push_back(prim->loops[start + i]);
             }
-            else if (ud.has<float>(key)) {
-                if (user_attrs.count(key) == 0) {
-                    auto p = OFloatProperty(user, key);
-                    p.setTimeSampling(1);
-                    user_attrs[key] = p;
+            auto base = vertex_index_per_face.size() - size;
+            if (flipFrontBack) {
+                for (int j = 0; j < (size / 2); j++) {
+                    std::swap(vertex_index_per_face[base + j], vertex_index_per_face[base + size - 1 - j]);
                 }
-                std::any_cast<OFloatProperty>(user_attrs[key]).set(ud.get2<float>(key));
             }
-            else if (ud.has<vec2i>(key)) {
-                if (user_attrs.count(key) == 0) {
-                    auto p = OV2iProperty(user, key);
-                    p.setTimeSampling(1);
-                    user_attrs[key] = p;
+            vertex_count_per_face.push_back(size);
+        }
+        if (prim->loops.has_attr("uvs")) {
+            samp.hasUVs = true;
+            samp.uvs = prim->uvs.values;
+            auto &uv_indices = samp.uvIndices;
+            auto const &loop_uvs = prim->loops.attr<int>("uvs");
+            uv_indices.reserve(prim->loops.size());
+            for (const auto& [start, size]: prim->polys) {
+                for (auto i = 0; i < size; i++) {
+                    uv_indices.push_back(loop_uvs[start + i]);
                 }
-                auto v = ud.get2<vec2i>(key);
-                std::any_cast<OV2iProperty>(user_attrs[key]).set(Imath_3_2::V2i(v[0], v[1]));
-            }
-            else if (ud.has<vec3i>(key)) {
-                if (user_attrs.count(key) == 0) {
-                    auto p = OV3iProperty(user, key);
-                    p.setTimeSampling(1);
-                    user_attrs[key] = p;
+                auto base = uv_indices.size() - size;
+                if (flipFrontBack) {
+                    for (int j = 0; j < (size / 2); j++) {
+                        std::swap(uv_indices[base + j], uv_indices[base + size - 1 - j]);
+                    }
                 }
-                auto v = ud.get2<vec3i>(key);
-                std::any_cast<OV3iProperty>(user_attrs[key]).set(Imath_3_2::V3i(v[0], v[1], v[2]));
             }
-            else if (ud.has<vec2f>(key)) {
-                if (user_attrs.count(key) == 0) {
-                    auto p = OV2fProperty(user, key);
-                    p.setTimeSampling(1);
-                    user_attrs[key] = p;
-                }
-                auto v = ud.get2<vec2f>(key);
-                std::any_cast<OV2fProperty>(user_attrs[key]).set(Imath_3_2::V2f(v[0], v[1]));
+        }
+    }
+    else {
+        vertex_index_per_face.reserve(prim->tris.size() * 3);
+        for (auto i = 0; i < prim->tris.size(); i++) {
+            vertex_index_per_face.push_back(prim->tris[i][0]);
+            if (flipFrontBack) {
+                vertex_index_per_face.push_back(prim->tris[i][2]);
+                vertex_index_per_face.push_back(prim->tris[i][1]);
             }
-            else if (ud.has<vec3f>(key)) {
-                if (user_attrs.count(key) == 0) {
-                    auto p = OV3fProperty(user, key);
-                    p.setTimeSampling(1);
-                    user_attrs[key] = p;
-                }
-                auto v = ud.get2<vec3f>(key);
-                std::any_cast<OV3fProperty>(user_attrs[key]).set(Imath_3_2::V3f(v[0], v[1], v[2]));
+            else {
+                vertex_index_per_face.push_back(prim->tris[i][1]);
+                vertex_index_per_face.push_back(prim->tris[i][2]);
             }
-            else if (ud.has<std::string>(key)) {
-                if (user_attrs.count(key) == 0) {
-                    auto p = OStringProperty(user, key);
-                    p.setTimeSampling(1);
-                    user_attrs[key] = p;
+        }
+        vertex_count_per_face.resize(prim->tris.size(), 3);
+        if (prim->tris.has_attr("uv0")) {
+            samp.hasUVs = true;
+            auto &uv_data = samp.uvs;
+            auto &uv_indices = samp.uvIndices;
+            auto const &uv0 = prim->tris.attr<zeno::vec3f>("uv0");
+            auto const &uv1 = prim->tris.attr<zeno::vec3f>("uv1");
+            auto const &uv2 = prim->tris.attr<zeno::vec3f>("uv2");
+            uv_data.reserve(prim->tris.size() * 3);
+            uv_indices.resize(prim->tris.size() * 3);
+            std::iota(uv_indices.begin(), uv_indices.end(), 0);
+            for (auto i = 0; i < prim->tris.size(); i++) {
+                uv_data.emplace_back(uv0[i][0], uv0[i][1]);
+                if (flipFrontBack) {
+                    uv_data.emplace_back(uv2[i][0], uv2[i][1]);
+                    uv_data.emplace_back(uv1[i][0], uv1[i][1]);
+                }
+                else {
+                    uv_data.emplace_back(uv1[i][0], uv1[i][1]);
+                    uv_data.emplace_back(uv2[i][0], uv2[i][1]);
                 }
-                std::any_cast<OStringProperty>(user_attrs[key]).set(ud.get2<std::string>(key));
             }
         }
     }
-    virtual void apply() override {
-        auto prim = get_input<PrimitiveObject>("prim");
-        bool flipFrontBack = get_input2<int>("flipFrontBack");
-        int frameid;
-        if (has_input("frameid")) {
-            frameid = get_input2<int>("frameid");
+}
+
+static void make_frame_sample(PrimitiveObject const *prim, bool isMesh, bool flipFrontBack, ABCLastFrame &last, ABCFrameSample &samp) {
+    samp.pos = prim->verts.values;
+    if (isMesh) {
+        build_mesh_topology(prim, flipFrontBack, samp);
+        samp.topologyChanged = !last.valid || !same_array(samp.faceIndices, last.faceIndices) || !same_array(samp.faceCounts, last.faceCounts);
+        if (samp.topologyChanged) {
+            last.faceIndices = samp.faceIndices;
+            last.faceCounts = samp.faceCounts;
         } else {
-            frameid = getGlobalState()->frameid;
+            samp.faceIndices = {};
+            samp.faceCounts = {};
         }
-        int frame_start = get_input2<int>("frame_start");
-        int frame_end = get_input2<int>("frame_end");
-        if (frameid == frame_start) {
-            std::string path = get_input2<std::string>("path");
-            archive = {Alembic::AbcCoreOgawa::WriteArchive(), path};
-            archive.addTimeSampling(TimeSampling(1.0/24, frame_start / 24.0));
-            if (prim->polys.size() || prim->tris.size()) {
-                meshyObj = OPolyMesh( OObject( archive, 1 ), "mesh" );
+        samp.uvsChanged = samp.hasUVs && (!last.valid || !same_array(samp.uvs, last.uvs) || !same_array(samp.uvIndices, last.uvIndices));
+        if (samp.uvsChanged) {
+            last.uvs = samp.uvs;
+            last.uvIndices = samp.uvIndices;
+        } else {
+            samp.uvs = {};
+            samp.uvIndices = {};
+        }
+        if (prim->verts.has_attr("nrm")) {
+            samp.hasNrm = true;
+            samp.nrm = prim->verts.attr<vec3f>("nrm");
+        }
+    } else {
+        samp.topologyChanged = !last.valid || last.numPoints != prim->verts.size();
+    }
+    last.numPoints = prim->verts.size();
+    last.valid = true;
+
+    if (prim->verts.has_attr("v")) {
+        samp.hasVel = true;
+        samp.vel = prim->verts.attr<vec3f>("v");
+    }
+    prim->verts.foreach_attr([&](auto const &key, auto const &arr) {
+        if (key == "v" || key == "nrm") {
+            return;
+        }
+        using T = std::decay_t<decltype(arr[0])>;
+        if constexpr (std::is_same_v<T, zeno::vec3f>) {
+            std::vector<float> v(arr.size() * 3);
+            for (auto i = 0; i < arr.size(); i++) {
+                v[i * 3 + 0] = arr[i][0];
+                v[i * 3 + 1] = arr[i][1];
+                v[i * 3 + 2] = arr[i][2];
             }
-            else {
-                pointsObj = OPoints (OObject( archive, 1 ), "points");
+            samp.attrs.push_back({key, 3, std::move(v)});
+        } else if constexpr (std::is_same_v<T, float>) {
+            samp.attrs.push_back({key, 1, arr});
+        }
+    });
+
+    auto &ud = prim->userData();
+    for (const auto& [key, value] : ud.m_data) {
+        if (ud.has<int>(key)) {
+            samp.userData.emplace_back(key, ud.get2<int>(key));
+        } else if (ud.has<float>(key)) {
+            samp.userData.emplace_back(key, ud.get2<float>(key));
+        } else if (ud.has<vec2i>(key)) {
+            samp.userData.emplace_back(key, ud.get2<vec2i>(key));
+        } else if (ud.has<vec3i>(key)) {
+            samp.userData.emplace_back(key, ud.get2<vec3i>(key));
+        } else if (ud.has<vec2f>(key)) {
+            samp.userData.emplace_back(key, ud.get2<vec2f>(key));
+        } else if (ud.has<vec3f>(key)) {
+            samp.userData.emplace_back(key, ud.get2<vec3f>(key));
+        } else if (ud.has<std::string>(key)) {
+            samp.userData.emplace_back(key, ud.get2<std::string>(key));
+        }
+    }
+}
+
+// one mesh or points object of the archive, only used from the thread writing samples
+struct ABCObjectWriter {
+    bool isMesh = false;
+    OPolyMesh meshyObj;
+    OPoints pointsObj;
+    std::map<std::string, OFloatGeomParam> attrs;
+    std::map<std::string, std::any> user_attrs;
+
+    template<typename T1, typename T2>
+    void write_attrs(ABCFrameSample const &frame, T1& schema, T2& samp) {
+        OCompoundProperty arbAttrs = schema.getArbGeomParams();
+        for (auto const &attr: frame.attrs) {
+            if (attrs.count(attr.name) == 0) {
+                attrs[attr.name] = OFloatGeomParam(arbAttrs.getPtr(), attr.name, false, kVaryingScope, attr.extent);
             }
-            attrs.clear();
-            user_attrs.clear();
+            auto samp = OFloatGeomParam::Sample();
+            samp.setVals(FloatArraySample(attr.vals.data(), attr.vals.size()));
+            attrs[attr.name].set(samp);
         }
-        if (!(frame_start <= frameid && frameid <= frame_end)) {
-            return;
+    }
+
+    template<typename P, typename V>
+    void write_user_prop(OCompoundProperty& user, std::string const &key, V const &value) {
+        if (user_attrs.count(key) == 0) {
+            auto p = P(user, key);
+            p.setTimeSampling(1);
+            user_attrs[key] = p;
         }
-        if (archive.valid() == false) {
-            zeno::makeError("Not init. Check whether in correct correct frame range.");
+        std::any_cast<P>(user_attrs[key]).set(value);
+    }
+
+    void write_user_data(ABCFrameSample const &frame, OCompoundProperty& user) {
+        for (const auto& [key, value] : frame.userData) {
+            std::visit([&, &key = key] (auto const &v) {
+                using T = std::decay_t<decltype(v)>;
+                if constexpr (std::is_same_v<T, int>) {
+                    write_user_prop<OInt32Property>(user, key, v);
+                } else if constexpr (std::is_same_v<T, float>) {
+                    write_user_prop<OFloatProperty>(user, key, v);
+                } else if constexpr (std::is_same_v<T, vec2i>) {
+                    write_user_prop<OV2iProperty>(user, key, Imath_3_2::V2i(v[0], v[1]));
+                } else if constexpr (std::is_same_v<T, vec3i>) {
+                    write_user_prop<OV3iProperty>(user, key, Imath_3_2::V3i(v[0], v[1], v[2]));
+                } else if constexpr (std::is_same_v<T, vec2f>) {
+                    write_user_prop<OV2fProperty>(user, key, Imath_3_2::V2f(v[0], v[1]));
+                } else if constexpr (std::is_same_v<T, vec3f>) {
+                    write_user_prop<OV3fProperty>(user, key, Imath_3_2::V3f(v[0], v[1], v[2]));
+                } else {
+                    write_user_prop<OStringProperty>(user, key, v);
+                }
+            }, value);
         }
-        if (prim->polys.size() || prim->tris.size()) {
-            // Create a PolyMesh class.
+    }
+
+    void write(ABCFrameSample const &frame) {
+        if (isMesh) {
             OPolyMeshSchema &mesh = meshyObj.getSchema();
 
             OCompoundProperty user = mesh.getUserProperties();
-            write_user_data(prim, user);
+            write_user_data(frame, user);
 
             mesh.setTimeSampling(1);
 
@@ -343,148 +464,230 @@ struct WriteAlembic2 : INode {
             // on the schema
             mesh.setUVSourceName("main_uv");
 
-            // Set a mesh sample.
-            // We're creating the sample inline here,
-            // but we could create a static sample and leave it around,
-            // only modifying the parts that have changed.
-            std::vector<int32_t> vertex_index_per_face;
-            std::vector<int32_t> vertex_count_per_face;
-
-            if (prim->loops.size()) {
-                for (const auto& [start, size]: prim->polys) {
-                    for (auto i = 0; i < size; i++) {
-                        vertex_index_per_face.push_back(prim->loops[start + i]);
-                    }
-                    auto base = vertex_index_per_face.size() - size;
-                    if (flipFrontBack) {
-                        for (int j = 0; j < (size / 2); j++) {
-                            std::swap(vertex_index_per_face[base + j], vertex_index_per_face[base + size - 1 - j]);
-                        }
-                    }
-                    vertex_count_per_face.push_back(size);
-                }
-                if (prim->loops.has_attr("uvs")) {
-                    std::vector<zeno::vec2f> uv_data;
-                    for (const auto& uv: prim->uvs) {
-                        uv_data.push_back(uv);
-                    }
-                    std::vector<uint32_t> uv_indices;
-                    for (const auto& [start, size]: prim->polys) {
-                        for (auto i = 0; i < size; i++) {
-                            auto uv_index = prim->loops.attr<int>("uvs")[start + i];
-                            uv_indices.push_back(uv_index);
-                        }
-                        auto base = uv_indices.size() - size;
-                        if (flipFrontBack) {
-                            for (int j = 0; j < (size / 2); j++) {
-                                std::swap(uv_indices[base + j], uv_indices[base + size - 1 - j]);
-                            }
-                        }
-                    }
-                    // UVs and Normals use GeomParams, which can be written or read
-                    // as indexed or not, as you'd like.
-                    OV2fGeomParam::Sample uvsamp;
-                    uvsamp.setVals(V2fArraySample( (const V2f *)uv_data.data(), uv_data.size()));
-                    uvsamp.setIndices(UInt32ArraySample( uv_indices.data(), uv_indices.size() ));
-                    uvsamp.setScope(kFacevaryingScope);
-                    OPolyMeshSchema::Sample mesh_samp(
-                    V3fArraySample( ( const V3f * )prim->verts.data(), prim->verts.size() ),
-                            Int32ArraySample( vertex_index_per_face.data(), vertex_index_per_face.size() ),
-                            Int32ArraySample( vertex_count_per_face.data(), vertex_count_per_face.size() ),
-                            uvsamp);
-                    write_velocity(prim, mesh_samp);
-                    write_normal(prim, mesh_samp);
-                    write_attrs(prim, mesh, mesh_samp);
-                    mesh.set( mesh_samp );
-                }
-                else {
-                    OPolyMeshSchema::Sample mesh_samp(
-                    V3fArraySample( ( const V3f * )prim->verts.data(), prim->verts.size() ),
-                            Int32ArraySample( vertex_index_per_face.data(), vertex_index_per_face.size() ),
-                            Int32ArraySample( vertex_count_per_face.data(), vertex_count_per_face.size() ));
-                    write_velocity(prim, mesh_samp);
-                    write_normal(prim, mesh_samp);
-                    write_attrs(prim, mesh, mesh_samp);
-                    mesh.set( mesh_samp );
-                }
+            OPolyMeshSchema::Sample mesh_samp;
+            mesh_samp.setPositions(P3fArraySample( ( const V3f * )frame.pos.data(), frame.pos.size() ));
+            if (frame.topologyChanged) {
+                mesh_samp.setFaceIndices(Int32ArraySample( frame.faceIndices.data(), frame.faceIndices.size() ));
+                mesh_samp.setFaceCounts(Int32ArraySample( frame.faceCounts.data(), frame.faceCounts.size() ));
             }
-            else {
-                for (auto i = 0; i < prim->tris.size(); i++) {
-                    vertex_index_per_face.push_back(prim->tris[i][0]);
-                    if (flipFrontBack) {
-                        vertex_index_per_face.push_back(prim->tris[i][2]);
-                        vertex_index_per_face.push_back(prim->tris[i][1]);
-                    }
-                    else {
-                        vertex_index_per_face.push_back(prim->tris[i][1]);
-                        vertex_index_per_face.push_back(prim->tris[i][2]);
-                    }
-                }
-                vertex_count_per_face.resize(prim->tris.size(), 3);
-                if (prim->tris.has_attr("uv0")) {
-                    std::vector<zeno::vec2f> uv_data;
-                    std::vector<uint32_t> uv_indices;
-                    auto& uv0 = prim->tris.attr<zeno::vec3f>("uv0");
-                    auto& uv1 = prim->tris.attr<zeno::vec3f>("uv1");
-                    auto& uv2 = prim->tris.attr<zeno::vec3f>("uv2");
-                    for (auto i = 0; i < prim->tris.size(); i++) {
-                        uv_data.emplace_back(uv0[i][0], uv0[i][1]);
-                        if (flipFrontBack) {
-                            uv_data.emplace_back(uv2[i][0], uv2[i][1]);
-                            uv_data.emplace_back(uv1[i][0], uv1[i][1]);
-                        }
-                        else {
-                            uv_data.emplace_back(uv1[i][0], uv1[i][1]);
-                            uv_data.emplace_back(uv2[i][0], uv2[i][1]);
-                        }
-                        uv_indices.push_back(uv_indices.size());
-                        uv_indices.push_back(uv_indices.size());
-                        uv_indices.push_back(uv_indices.size());
-                    }
-
-                    // UVs and Normals use GeomParams, which can be written or read
-                    // as indexed or not, as you'd like.
-                    OV2fGeomParam::Sample uvsamp;
-                    uvsamp.setVals(V2fArraySample( (const V2f *)uv_data.data(), uv_data.size()));
-                    uvsamp.setIndices(UInt32ArraySample( uv_indices.data(), uv_indices.size() ));
-                    uvsamp.setScope(kFacevaryingScope);
-                    OPolyMeshSchema::Sample mesh_samp(
-                    V3fArraySample( ( const V3f * )prim->verts.data(), prim->verts.size() ),
-                            Int32ArraySample( vertex_index_per_face.data(), vertex_index_per_face.size() ),
-                            Int32ArraySample( vertex_count_per_face.data(), vertex_count_per_face.size() ),
-                            uvsamp);
-                    write_velocity(prim, mesh_samp);
-                    write_normal(prim, mesh_samp);
-                    write_attrs(prim, mesh, mesh_samp);
-                    mesh.set( mesh_samp );
-                } else {
-                    OPolyMeshSchema::Sample mesh_samp(
-                    V3fArraySample( ( const V3f * )prim->verts.data(), prim->verts.size() ),
-                            Int32ArraySample( vertex_index_per_face.data(), vertex_index_per_face.size() ),
-                            Int32ArraySample( vertex_count_per_face.data(), vertex_count_per_face.size() ));
-                    write_velocity(prim, mesh_samp);
-                    write_normal(prim, mesh_samp);
-                    write_attrs(prim, mesh, mesh_samp);
-                    mesh.set( mesh_samp );
-                }
+            if (frame.uvsChanged) {
+                // UVs and Normals use GeomParams, which can be written or read
+                // as indexed or not, as you'd like.
+                OV2fGeomParam::Sample uvsamp;
+                uvsamp.setVals(V2fArraySample( (const V2f *)frame.uvs.data(), frame.uvs.size()));
+                uvsamp.setIndices(UInt32ArraySample( frame.uvIndices.data(), frame.uvIndices.size() ));
+                uvsamp.setScope(kFacevaryingScope);
+                mesh_samp.setUVs(uvsamp);
             }
+            if (frame.hasVel) {
+                mesh_samp.setVelocities(V3fArraySample( ( const V3f * )frame.vel.data(), frame.vel.size() ));
+            }
+            if (frame.hasNrm) {
+                ON3fGeomParam::Sample oNormalsSample(N3fArraySample( ( const N3f * )frame.nrm.data(), frame.nrm.size() ), kFacevaryingScope);
+                mesh_samp.setNormals(oNormalsSample);
+            }
+            write_attrs(frame, mesh, mesh_samp);
+            mesh.set( mesh_samp );
         }
         else {
             OPointsSchema &points = pointsObj.getSchema();
             OCompoundProperty user = points.getUserProperties();
-            write_user_data(prim, user);
+            write_user_data(frame, user);
             points.setTimeSampling(1);
-            OPointsSchema::Sample samp(V3fArraySample( ( const V3f * )prim->verts.data(), prim->verts.size() ));
-            std::vector<uint64_t> ids(prim->verts.size());
-            std::iota(ids.begin(), ids.end(), 0);
-            samp.setIds(Alembic::Abc::UInt64ArraySample(ids.data(), ids.size()));
-            write_velocity(prim, samp);
-            write_attrs(prim, points, samp);
+            OPointsSchema::Sample samp(V3fArraySample( ( const V3f * )frame.pos.data(), frame.pos.size() ));
+            std::vector<uint64_t> ids;
+            if (frame.topologyChanged) {
+                ids.resize(frame.pos.size());
+                std::iota(ids.begin(), ids.end(), 0);
+                samp.setIds(Alembic::Abc::UInt64ArraySample(ids.data(), ids.size()));
+            }
+            if (frame.hasVel) {
+                samp.setVelocities(V3fArraySample( ( const V3f * )frame.vel.data(), frame.vel.size() ));
+            }
+            write_attrs(frame, points, samp);
             points.set( samp );
         }
     }
 };
 
+struct ABCArchiveWriter {
+    OArchive archive;
+    std::vector<ABCObjectWriter> objects;
+};
+
+// runs jobs in order on a thread of its own, so the graph doesn't wait for the disk; submit()
+// blocks while more than `budget` bytes are queued, a budget of 0 runs jobs inline instead,
+// an error thrown by a job is rethrown by the next submit() or wait()
+class ABCWriteQueue {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::pair<std::function<void()>, size_t>> jobs;
+    size_t queued = 0;
+    bool stop = false;
+    std::exception_ptr error;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock lck(mtx);
+        while (true) {
+            cv.wait(lck, [&] { return stop || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            auto job = std::move(jobs.front().first);
+            size_t bytes = jobs.front().second;
+            jobs.pop_front();
+            lck.unlock();
+            std::exception_ptr err;
+            try {
+                job();
+            } catch (...) {
+                err = std::current_exception();
+            }
+            job = nullptr;
+            lck.lock();
+            if (err && !error) {
+                error = err;
+            }
+            queued -= bytes;
+            cv.notify_all();
+        }
+    }
+
+    void rethrow() {
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+    }
+
+public:
+    size_t budget = 0;
+
+    ~ABCWriteQueue() {
+        {
+            std::lock_guard lck(mtx);
+            stop = true;
+        }
+        cv.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (error) {
+            log_error("[alembic] writing samples failed");
+        }
+    }
+
+    void submit(std::function<void()> job, size_t bytes) {
+        if (!budget) {
+            wait();
+            job();
+            return;
+        }
+        bytes = std::max<size_t>(bytes, 1);
+        std::unique_lock lck(mtx);
+        rethrow();
+        if (!worker.joinable()) {
+            worker = std::thread([this] { run(); });
+        }
+        cv.wait(lck, [&] { return queued == 0 || queued + bytes <= budget; });
+        jobs.emplace_back(std::move(job), bytes);
+        queued += bytes;
+        cv.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock lck(mtx);
+        cv.wait(lck, [&] { return queued == 0; });
+        rethrow();
+    }
+};
+
+struct WriteAlembic2 : INode {
+    std::shared_ptr<ABCArchiveWriter> writer;
+    std::vector<ABCLastFrame> lastFrames;
+    // declared last so queued samples are written before the archive is closed
+    ABCWriteQueue queue;
+
+    virtual void apply() override {
+        std::vector<std::shared_ptr<PrimitiveObject>> prims;
+        bool is_list = has_input<ListObject>("prim");
+        if (is_list) {
+            prims = get_input<ListObject>("prim")->get<PrimitiveObject>();
+        } else {
+            prims.push_back(get_input<PrimitiveObject>("prim"));
+        }
+        bool flipFrontBack = get_input2<int>("flipFrontBack");
+        int frameid;
+        if (has_input("frameid")) {
+            frameid = get_input2<int>("frameid");
+        } else {
+            frameid = getGlobalState()->frameid;
+        }
+        int frame_start = get_input2<int>("frame_start");
+        int frame_end = get_input2<int>("frame_end");
+        queue.budget = (size_t)std::max(0, get_input2<int>("queueMB")) << 20;
+        if (frameid == frame_start) {
+            // finish the previous sequence before starting over
+            queue.wait();
+            writer = nullptr;
+            std::string path = get_input2<std::string>("path");
+            auto w = std::make_shared<ABCArchiveWriter>();
+            w->archive = {Alembic::AbcCoreOgawa::WriteArchive(), path};
+            w->archive.addTimeSampling(TimeSampling(1.0/24, frame_start / 24.0));
+            std::set<std::string> names;
+            for (size_t i = 0; i < prims.size(); i++) {
+                auto &prim = prims[i];
+                ABCObjectWriter obj;
+                obj.isMesh = prim->polys.size() || prim->tris.size();
+                std::string name = obj.isMesh ? "mesh" : "points";
+                if (is_list) {
+                    name = prim->userData().get2<std::string>("_abc_name", name + std::to_string(i));
+                    if (names.count(name)) {
+                        name += "_" + std::to_string(i);
+                    }
+                }
+                names.insert(name);
+                if (obj.isMesh) {
+                    obj.meshyObj = OPolyMesh( OObject( w->archive, 1 ), name );
+                }
+                else {
+                    obj.pointsObj = OPoints (OObject( w->archive, 1 ), name);
+                }
+                w->objects.push_back(std::move(obj));
+            }
+            writer = std::move(w);
+            lastFrames.assign(prims.size(), {});
+        }
+        if (!(frame_start <= frameid && frameid <= frame_end)) {
+            return;
+        }
+        if (!writer || writer->archive.valid() == false) {
+            throw makeError("Not init. Check whether in correct correct frame range.");
+        }
+        if (prims.size() != writer->objects.size()) {
+            throw makeError(format("[alembic] got {} prims, but the archive was started with {}", prims.size(), writer->objects.size()));
+        }
+        size_t count = std::min(prims.size(), writer->objects.size());
+        std::vector<ABCFrameSample> samples(count);
+#pragma omp parallel for schedule(dynamic) if (count > 1)
+        for (intptr_t i = 0; i < (intptr_t)count; i++) {
+            make_frame_sample(prims[i].get(), writer->objects[i].isMesh, flipFrontBack, lastFrames[i], samples[i]);
+        }
+        size_t bytes = 0;
+        for (auto const &samp: samples) {
+            bytes += samp.bytes();
+        }
+        queue.submit([w = writer, samples = std::move(samples)] {
+            for (size_t i = 0; i < samples.size(); i++) {
+                w->objects[i].write(samples[i]);
+            }
+        }, bytes);
+        if (frameid == frame_end) {
+            queue.wait();
+        }
+    }
+};
+
 ZENDEFNODE(WriteAlembic2, {
     {
         {"prim"},
@@ -493,6 +696,7 @@ ZENDEFNODE(WriteAlembic2, {
         {"int", "frame_start", "0"},
         {"int", "frame_end", "100"},
         {"bool", "flipFrontBack", "1"},
+        {"int", "queueMB", "1024"},
     },
     {},
     {},
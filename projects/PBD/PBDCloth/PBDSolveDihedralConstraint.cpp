@@ -1,6 +1,7 @@
 #include <zeno/zeno.h>
 #include <zeno/types/PrimitiveObject.h>
 #include "../Utils/myPrint.h"
+#include "../Utils/ConstraintColoring.h"
 #include <zeno/types/UserData.h>
 
 using namespace zeno;
@@ -36,7 +37,10 @@ struct PBDSolveDihedralConstraint : zeno::INode {
     }
 
     /**
-     * @brief 对所有的点求解二面角约束
+     * @brief 对所有的点求解二面角约束。每个三角形的三个邻接面各是一个约束，按着色分组，
+     * 同色的约束互不共享顶点，组内并行求解。isGaussSidel为真时逐组就地修正pos，
+     * 否则（Jacobi）所有约束都基于同一个pos求修正，每个点的修正取平均后再加到pos上。
+     * 两种方式的结果都与线程数无关。
      * 
      * @param prim 所传入的所有数据
      */
@@ -54,13 +58,29 @@ struct PBDSolveDihedralConstraint : zeno::INode {
         float dt = prim->userData().getLiterial<float>("dt");
         float isGaussSidel = prim->userData().getLiterial<bool>("isGaussSidel");
 
-        for (int i = 0; i < tris.size(); i++) //对所有三角面
+        //约束c对应第c/3个三角形的第c%3个邻接面，没有邻接面的约束不参与着色
+        auto coloring = cachedColoring<4, vec3i>(prim, tris, pos.size(), "pbdColor", "pbdDihedralColoring", [&] (size_t c) {
+            int id4 = adj4th[c / 3][c % 3];
+            if (id4 == -1)
+                return std::array<int, 4>{-1, -1, -1, -1};
+            return std::array<int, 4>{tris[c / 3][0], tris[c / 3][1], tris[c / 3][2], id4};
+        });
+
+        std::vector<int> count;
+        if (!isGaussSidel)
+        {
+            std::fill(dpos.begin(), dpos.end(), vec3f{0.0,0.0,0.0});
+            count.assign(pos.size(), 0);
+        }
+
+        for (int color = 0; color < coloring.numColors(); color++)
         {
-            for(int k=0; k<3; k++) //三个边，对应着三个邻接面
+#pragma omp parallel for
+            for (intptr_t c = coloring.offsets[color]; c < coloring.offsets[color + 1]; c++)
             {
+                int i = coloring.order[c] / 3; //三角面
+                int k = coloring.order[c] % 3; //三个边，对应着三个邻接面
                 int id4 = adj4th[i][k]; //取出第四个点编号
-                if (id4 == -1) //如果编号为-1，证明没有这个邻接面
-                    continue;
 
                 //对四个点进行求解。注意顺序要按照Muller2006论文中的Fig4。1-2是共享边。3是自己的点，4是对方的点。
                 int id1 = tris[i][0];
@@ -76,12 +96,33 @@ struct PBDSolveDihedralConstraint : zeno::INode {
                 //这里只传入需要的四个点的数据，求解得到4个dpos
                 dihedralConstraint(pos4p, invMass4p, restAng4p, dihedralCompliance, dt,  dpos4p);
 
-                for (size_t j = 0; j < 4; j++)
-                    dpos[id[j]] = dpos4p[j];
-
                 if (isGaussSidel) //高斯赛德尔法在原地修正pos
+                {
+                    for (size_t j = 0; j < 4; j++)
+                    {
+                        dpos[id[j]] = dpos4p[j];
+                        pos[id[j]] += dpos4p[j];
+                    }
+                }
+                else //雅可比法先累加修正值，最后取平均
+                {
                     for (size_t j = 0; j < 4; j++)
-                        pos[id[j]] += dpos[j];
+                    {
+                        dpos[id[j]] += dpos4p[j];
+                        count[id[j]]++;
+                    }
+                }
+            }
+        }
+
+        if (!isGaussSidel)
+        {
+#pragma omp parallel for
+            for (intptr_t i = 0; i < (intptr_t)pos.size(); i++)
+            {
+                if (count[i])
+                    dpos[i] /= (float)count[i];
+                pos[i] += dpos[i];
             }
         }
     }
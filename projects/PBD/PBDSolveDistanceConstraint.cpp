@@ -1,13 +1,41 @@
 #include <zeno/types/PrimitiveObject.h>
 #include <zeno/zeno.h>
 #include <zeno/types/UserData.h>
+#include "Utils/ConstraintColoring.h"
 #include <iostream>
 
 namespace zeno {
 struct PBDSolveDistanceConstraint : zeno::INode {
 private:
     /**
-     * @brief 求解PBD所有边约束（也叫距离约束）。目前采用Gauss-Seidel方式（难以并行）。
+     * @brief 求解单个距离约束，得到两个端点的位置修正。
+     */
+    static void distanceCorrection(
+        const zeno::vec3f &p0,
+        const zeno::vec3f &p1,
+        const float w0,
+        const float w1,
+        const float restLen,
+        const float alpha,
+        zeno::vec3f &dp0,
+        zeno::vec3f &dp1
+        )
+    {
+        zeno::vec3f grad = p0 - p1;
+        float Len = length(grad);
+        grad /= Len;
+        float C = Len - restLen;
+        float w = w0 + w1;
+        float s = -C / (w + alpha);
+
+        dp0 = grad *   s * w0;
+        dp1 = grad * (-s * w1);
+    }
+
+    /**
+     * @brief 求解PBD所有边约束（也叫距离约束）。边按着色分组，同色的边互不共享顶点，组内并行求解。
+     * Gauss-Seidel方式逐组就地修正pos；Jacobi方式所有边都基于同一个pos求修正，每个点的修正取平均，
+     * 两种方式的结果都与线程数无关。
      * 
      * @param pos 点位置
      * @param edge 边连接关系
@@ -15,34 +43,64 @@ private:
      * @param restLen 边的原长
      * @param disntanceCompliance 柔度（越小约束越强，最小为0）
      * @param dt 时间步长
+     * @param coloring 边的着色
+     * @param jacobi 是否用Jacobi方式
      */
     void solveDistanceConstraint( 
-        PrimitiveObject * prim,
         zeno::AttrVector<zeno::vec3f> &pos,
         const zeno::AttrVector<zeno::vec2i> &edge,
         const std::vector<float> & invMass,
         const std::vector<float> & restLen,
         const float disntanceCompliance,
-        const float dt
+        const float dt,
+        const ConstraintColoring &coloring,
+        const bool jacobi
         )
     {
         float alpha = disntanceCompliance / dt / dt;
-        zeno::vec3f grad{0, 0, 0};
-        for (int i = 0; i < edge.size(); i++) 
+        if (!jacobi)
         {
-            int id0 = edge[i][0];
-            int id1 = edge[i][1];
-
-            grad = pos[id0] - pos[id1];
-            float Len = length(grad);
-            grad /= Len;
-            float C = Len - restLen[i];
-            float w = invMass[id0] + invMass[id1];
-            float s = -C / (w + alpha);
-
-            pos[id0] += grad *   s * invMass[id0];
-            pos[id1] += grad * (-s * invMass[id1]);
+            for (int k = 0; k < coloring.numColors(); k++)
+            {
+#pragma omp parallel for
+                for (intptr_t j = coloring.offsets[k]; j < coloring.offsets[k + 1]; j++)
+                {
+                    int i = coloring.order[j];
+                    int id0 = edge[i][0];
+                    int id1 = edge[i][1];
+
+                    zeno::vec3f dp0, dp1;
+                    distanceCorrection(pos[id0], pos[id1], invMass[id0], invMass[id1], restLen[i], alpha, dp0, dp1);
+                    pos[id0] += dp0;
+                    pos[id1] += dp1;
+                }
+            }
+            return;
+        }
+
+        std::vector<zeno::vec3f> dpos(pos.size(), zeno::vec3f(0, 0, 0));
+        std::vector<int> count(pos.size(), 0);
+        for (int k = 0; k < coloring.numColors(); k++)
+        {
+#pragma omp parallel for
+            for (intptr_t j = coloring.offsets[k]; j < coloring.offsets[k + 1]; j++)
+            {
+                int i = coloring.order[j];
+                int id0 = edge[i][0];
+                int id1 = edge[i][1];
+
+                zeno::vec3f dp0, dp1;
+                distanceCorrection(pos[id0], pos[id1], invMass[id0], invMass[id1], restLen[i], alpha, dp0, dp1);
+                dpos[id0] += dp0;
+                dpos[id1] += dp1;
+                count[id0]++;
+                count[id1]++;
+            }
         }
+#pragma omp parallel for
+        for (intptr_t i = 0; i < (intptr_t)pos.size(); i++)
+            if (count[i])
+                pos[i] += dpos[i] / (float)count[i];
     }
 
 
@@ -59,9 +117,15 @@ public:
         auto &edge = prim->lines;
         auto &restLen = prim->lines.attr<float>("restLen");
         auto &invMass = prim->verts.attr<float>("invMass");
+        bool jacobi = get_input2<std::string>("solver") == "Jacobi";
+
+        //color the edges, cached on the prim until its topology changes
+        auto coloring = cachedColoring<2, int>(prim.get(), edge, pos.size(), "pbdColor", "pbdDistanceColoring", [&] (size_t i) {
+            return std::array<int, 2>{edge[i][0], edge[i][1]};
+        });
 
         //solve distance constraint
-        solveDistanceConstraint(prim.get(), pos, edge, invMass, restLen, disntanceCompliance, dt);
+        solveDistanceConstraint(pos, edge, invMass, restLen, disntanceCompliance, dt, coloring, jacobi);
 
         //output
         set_output("outPrim", std::move(prim));
@@ -71,7 +135,8 @@ public:
 ZENDEFNODE(PBDSolveDistanceConstraint, {// inputs:
                  {
                     {"PrimitiveObject", "prim"},
-                    {"float", "disntanceCompliance", "100.0"}
+                    {"float", "disntanceCompliance", "100.0"},
+                    {"enum GaussSeidel Jacobi", "solver", "GaussSeidel"},
                 },
                  // outputs:
                  {"outPrim"},
@@ -1,12 +1,44 @@
 #include <zeno/types/PrimitiveObject.h>
 #include <zeno/zeno.h>
 #include <zeno/types/UserData.h>
+#include "Utils/ConstraintColoring.h"
 
 namespace zeno {
 struct PBDSolveVolumeConstraint : zeno::INode {
 private:
     /**
-     * @brief 求解PBD所有体积约束。目前采用Gauss-Seidel方式（难以并行）。
+     * @brief 求解单个体积约束，得到四个顶点的位置修正。
+     */
+    static void volumeCorrection(
+        const std::array<vec3f, 4> &p,
+        const vec4f &invMass,
+        const float restVol,
+        const float alphaVol,
+        std::array<vec3f, 4> &dp
+        )
+    {
+        vec3f grad[4];
+        grad[0] = cross((p[3] - p[1]), (p[2] - p[1]));
+        grad[1] = cross((p[2] - p[0]), (p[3] - p[0]));
+        grad[2] = cross((p[3] - p[0]), (p[1] - p[0]));
+        grad[3] = cross((p[1] - p[0]), (p[2] - p[0]));
+
+        float w = 0.0;
+        for (int j = 0; j < 4; j++)
+            w += invMass[j] * (length(grad[j])) * (length(grad[j])) ;
+
+        float vol = dot(grad[3], p[3] - p[0]) * (1.0 / 6.0);
+        float C = (vol - restVol) * 6.0;
+        float s = -C /(w + alphaVol);
+
+        for (int j = 0; j < 4; j++)
+            dp[j] = grad[j] * s * invMass[j];
+    }
+
+    /**
+     * @brief 求解PBD所有体积约束。四面体按着色分组，同色的四面体互不共享顶点，组内并行求解。
+     * Gauss-Seidel方式逐组就地修正pos；Jacobi方式所有四面体都基于同一个pos求修正，每个点的修正取平均，
+     * 两种方式的结果都与线程数无关。
      * 
      * @param pos 点位置
      * @param tet 四面体的四个顶点连接关系
@@ -14,6 +46,8 @@ private:
      * @param dt 时间步长
      * @param restVol 原体积
      * @param invMass 点质量的倒数
+     * @param coloring 四面体的着色
+     * @param jacobi 是否用Jacobi方式
      */
     void solveVolumeConstraint(
         zeno::AttrVector<zeno::vec3f> &pos,
@@ -21,56 +55,52 @@ private:
         const float volumeCompliance,
         const float dt,
         const std::vector<float> & restVol,
-        const std::vector<float> & invMass
+        const std::vector<float> & invMass,
+        const ConstraintColoring &coloring,
+        const bool jacobi
                     )
     {
         float alphaVol = volumeCompliance / dt / dt;
-        vec3f grad[4] = {vec3f(0,0,0), vec3f(0,0,0), vec3f(0,0,0), vec3f(0,0,0)};
+        std::vector<vec3f> dpos;
+        std::vector<int> count;
+        if (jacobi)
+        {
+            dpos.assign(pos.size(), vec3f(0, 0, 0));
+            count.assign(pos.size(), 0);
+        }
 
-        for (int i = 0; i < tet.size(); i++)
+        for (int k = 0; k < coloring.numColors(); k++)
         {
-            vec4i id{-1,-1,-1,-1};
-
-            for (int j = 0; j < 4; j++)
-                id[j] = tet[i][j];
-            
-            grad[0] = cross((pos[id[3]] - pos[id[1]]), (pos[id[2]] - pos[id[1]]));
-            grad[1] = cross((pos[id[2]] - pos[id[0]]), (pos[id[3]] - pos[id[0]]));
-            grad[2] = cross((pos[id[3]] - pos[id[0]]), (pos[id[1]] - pos[id[0]]));
-            grad[3] = cross((pos[id[1]] - pos[id[0]]), (pos[id[2]] - pos[id[0]]));
-
-            float w = 0.0;
-            for (int j = 0; j < 4; j++)
-                w += invMass[id[j]] * (length(grad[j])) * (length(grad[j])) ;
-
-            float vol = tetVolume(pos, tet, i);
-            float C = (vol - restVol[i]) * 6.0;
-            float s = -C /(w + alphaVol);
-            
-            for (int j = 0; j < 4; j++)
-                pos[id[j]] += grad[j] * s * invMass[id[j]];
+#pragma omp parallel for
+            for (intptr_t c = coloring.offsets[k]; c < coloring.offsets[k + 1]; c++)
+            {
+                int i = coloring.order[c];
+                vec4i id = tet[i];
+                std::array<vec3f, 4> p{pos[id[0]], pos[id[1]], pos[id[2]], pos[id[3]]};
+                vec4f w{invMass[id[0]], invMass[id[1]], invMass[id[2]], invMass[id[3]]};
+                std::array<vec3f, 4> dp;
+                volumeCorrection(p, w, restVol[i], alphaVol, dp);
+
+                for (int j = 0; j < 4; j++)
+                {
+                    if (jacobi)
+                    {
+                        dpos[id[j]] += dp[j];
+                        count[id[j]]++;
+                    }
+                    else
+                        pos[id[j]] += dp[j];
+                }
+            }
         }
-    }
 
-    /**
-     * @brief 计算当前体积的辅助函数
-     * 
-     * @param pos 点位置
-     * @param tet 四面体顶点连接关系
-     * @param i 四面体编号
-     * @return float 四面体体积
-     */
-    float tetVolume(zeno::AttrVector<zeno::vec3f> &pos,
-                    const zeno::AttrVector<zeno::vec4i> &tet,
-                    int i)
-    {
-        auto id = vec4i(-1, -1, -1, -1);
-        for (int j = 0; j < 4; j++)
-            id[j] = tet[i][j];
-        auto temp = cross((pos[id[1]] - pos[id[0]]), (pos[id[2]] - pos[id[0]]));
-        auto res = dot(temp, pos[id[3]] - pos[id[0]]);
-        res *= 1.0 / 6.0;
-        return res;
+        if (jacobi)
+        {
+#pragma omp parallel for
+            for (intptr_t i = 0; i < (intptr_t)pos.size(); i++)
+                if (count[i])
+                    pos[i] += dpos[i] / (float)count[i];
+        }
     }
 
 
@@ -86,9 +116,15 @@ public:
         auto &tet = prim->quads;
         auto &restVol = prim->quads.attr<float>("restVol");
         auto &invMass = prim->verts.attr<float>("invMass");
+        bool jacobi = get_input2<std::string>("solver") == "Jacobi";
+
+        // color the tets, cached on the prim until its topology changes
+        auto coloring = cachedColoring<4, int>(prim.get(), tet, pos.size(), "pbdColor", "pbdVolumeColoring", [&] (size_t i) {
+            return std::array<int, 4>{tet[i][0], tet[i][1], tet[i][2], tet[i][3]};
+        });
 
         // solve
-        solveVolumeConstraint(pos, tet, volumeCompliance, dt, restVol, invMass);
+        solveVolumeConstraint(pos, tet, volumeCompliance, dt, restVol, invMass, coloring, jacobi);
 
         // output
         set_output("outPos", std::move(prim));
@@ -98,7 +134,8 @@ public:
 ZENDEFNODE(PBDSolveVolumeConstraint, {// inputs:
                  {
                     {"PrimitiveObject", "prim"},
-                    {"float", "volumeCompliance", "0.0"}
+                    {"float", "volumeCompliance", "0.0"},
+                    {"enum GaussSeidel Jacobi", "solver", "GaussSeidel"},
                 },
                  // outputs:
                  {"outPos"},
@@ -0,0 +1,175 @@
+#pragma once
+#include <zeno/utils/vec.h>
+#include <zeno/utils/Error.h>
+#include <zeno/utils/format.h>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+#include <vector>
+
+namespace zeno
+{
+
+/**
+ * @brief 均匀网格邻域搜索。格子边长不小于搜索半径，粒子按所在格子做计数排序，
+ * 邻居只需在周围27个格子里找。结果是CSR格式的邻居表：粒子i的邻居（不含自己）为
+ * indices[offsets[i]] ... indices[offsets[i+1]-1]，按格子顺序排列，与线程数无关。
+ * 网格对象应当保存下来（如放在PBFWorld里），各个缓冲区在每个substep之间复用。
+ */
+struct NeighborGrid
+{
+    vec3f origin;
+    vec3i res;
+    float dxInv;
+    std::vector<int> cellOf;    //每个粒子所在格子
+    std::vector<int> cellStart; //格子c中的粒子为 sorted[cellStart[c]] ... sorted[cellStart[c+1]-1]
+    std::vector<int> sorted;    //按格子顺序排列的粒子编号
+
+    vec3i cellXYZ(const vec3f &p) const
+    {
+        vec3i xyz = vec3i(floor((p - origin) * dxInv));
+        for (int d = 0; d < 3; d++)
+            xyz[d] = std::clamp(xyz[d], 0, res[d] - 1);
+        return xyz;
+    }
+
+    int cellXYZ2ID(const vec3i &xyz) const
+    {
+        return (xyz[2] * res[1] + xyz[1]) * res[0] + xyz[0];
+    }
+
+    void build(const std::vector<vec3f> &pos, float searchRadius)
+    {
+        intptr_t n = pos.size();
+        float x0 = std::numeric_limits<float>::max(), y0 = x0, z0 = x0;
+        float x1 = std::numeric_limits<float>::lowest(), y1 = x1, z1 = x1;
+#pragma omp parallel for reduction(min: x0, y0, z0) reduction(max: x1, y1, z1)
+        for (intptr_t i = 0; i < n; i++)
+        {
+            x0 = std::min(x0, pos[i][0]); x1 = std::max(x1, pos[i][0]);
+            y0 = std::min(y0, pos[i][1]); y1 = std::max(y1, pos[i][1]);
+            z0 = std::min(z0, pos[i][2]); z1 = std::max(z1, pos[i][2]);
+        }
+        if (!n)
+            x0 = y0 = z0 = x1 = y1 = z1 = 0;
+
+        //格子太多（粒子稀疏）时放大格子，格子只要不小于搜索半径结果就不变
+        origin = vec3f(x0, y0, z0);
+        vec3f extent = vec3f(x1, y1, z1) - origin;
+        //粒子位置出现inf/NaN时下面放大格子的循环不会结束
+        if (!(std::isfinite(extent[0]) && std::isfinite(extent[1]) && std::isfinite(extent[2])))
+            throw makeError(format("NeighborGrid: particle bounds are not finite, extent = ({}, {}, {})",
+                                   extent[0], extent[1], extent[2]));
+        float dx = std::max(searchRadius, 1e-6f);
+        size_t maxCells = std::max<size_t>(2 * n, 64);
+        while (true)
+        {
+            res = vec3i(extent / dx) + 1;
+            if ((size_t)res[0] * res[1] * res[2] <= maxCells)
+                break;
+            dx *= 1.26f;
+        }
+        dxInv = 1.0f / dx;
+        int numCells = res[0] * res[1] * res[2];
+
+        //计数排序
+        cellOf.resize(n);
+#pragma omp parallel for
+        for (intptr_t i = 0; i < n; i++)
+            cellOf[i] = cellXYZ2ID(cellXYZ(pos[i]));
+        cellStart.assign(numCells + 1, 0);
+        for (intptr_t i = 0; i < n; i++)
+            cellStart[cellOf[i] + 1]++;
+        for (int c = 0; c < numCells; c++)
+            cellStart[c + 1] += cellStart[c];
+        sorted.resize(n);
+        std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+        for (intptr_t i = 0; i < n; i++)
+            sorted[cursor[cellOf[i]]++] = i;
+    }
+
+    /**
+     * @brief 对粒子i半径内的每个邻居j（j != i）调用f(j)
+     */
+    template <class F>
+    void forNeighbors(const std::vector<vec3f> &pos, int i, float radius2, F const &f) const
+    {
+        vec3i xyz = cellXYZ(pos[i]);
+        vec3i lo, hi;
+        for (int d = 0; d < 3; d++)
+        {
+            lo[d] = std::max(xyz[d] - 1, 0);
+            hi[d] = std::min(xyz[d] + 1, res[d] - 1);
+        }
+        for (int z = lo[2]; z <= hi[2]; z++)
+            for (int y = lo[1]; y <= hi[1]; y++)
+            {
+                //同一行相邻的三个格子在sorted中是连续的
+                int beg = cellStart[cellXYZ2ID(vec3i(lo[0], y, z))];
+                int end = cellStart[cellXYZ2ID(vec3i(hi[0], y, z)) + 1];
+                for (int k = beg; k < end; k++)
+                {
+                    int j = sorted[k];
+                    if (j != i && lengthSquared(pos[i] - pos[j]) < radius2)
+                        f(j);
+                }
+            }
+    }
+
+    /**
+     * @brief 生成CSR邻居表。先数每个粒子的邻居数，前缀和后再并行填入。
+     */
+    void buildNeighborList(const std::vector<vec3f> &pos, float searchRadius,
+                           std::vector<int> &offsets, std::vector<int> &indices) const
+    {
+        intptr_t n = pos.size();
+        float radius2 = searchRadius * searchRadius;
+        offsets.assign(n + 1, 0);
+        //按格子顺序遍历粒子，相邻的线程访问相近的内存
+#pragma omp parallel for schedule(dynamic, 256)
+        for (intptr_t s = 0; s < n; s++)
+        {
+            int i = sorted[s];
+            int count = 0;
+            forNeighbors(pos, i, radius2, [&](int j) { count++; });
+            offsets[i + 1] = count;
+        }
+        for (intptr_t i = 0; i < n; i++)
+            offsets[i + 1] += offsets[i];
+        indices.resize(offsets[n]);
+#pragma omp parallel for schedule(dynamic, 256)
+        for (intptr_t s = 0; s < n; s++)
+        {
+            int i = sorted[s];
+            int k = offsets[i];
+            forNeighbors(pos, i, radius2, [&](int j) { indices[k++] = j; });
+        }
+    }
+
+    /**
+     * @brief 把一个逐粒子数组按格子顺序重排，提高之后求解时的访存局部性。
+     * 所有逐粒子数组（位置、属性、速度等）都重排完后调用finishReorder()。
+     */
+    template <class T>
+    void reorder(std::vector<T> &arr) const
+    {
+        //漏掉一个数组会让它和其它数组的粒子顺序对不上
+        if (arr.size() != sorted.size())
+            throw makeError(format("NeighborGrid::reorder: array has {} elements, but the grid has {} particles",
+                                   arr.size(), sorted.size()));
+        std::vector<T> res(arr.size());
+#pragma omp parallel for
+        for (intptr_t s = 0; s < (intptr_t)sorted.size(); s++)
+            res[s] = arr[sorted[s]];
+        arr = std::move(res);
+    }
+
+    void finishReorder()
+    {
+        reorder(cellOf);
+        std::iota(sorted.begin(), sorted.end(), 0);
+    }
+};
+
+}//zeno
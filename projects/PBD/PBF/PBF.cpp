@@ -1,5 +1,4 @@
 #include "PBF.h"
-#include "CellHelpers.h"
 using namespace zeno;
 
 void PBF::preSolve()
@@ -43,7 +42,8 @@ void PBF::solve()
     computeDpos();
 
     //apply the dpos to the pos
-    for (size_t i = 0; i < numParticles; i++)
+#pragma omp parallel for
+    for (intptr_t i = 0; i < numParticles; i++)
         pos[i] += dpos[i];
 }
 
@@ -53,15 +53,17 @@ void PBF::computeLambda()
     lambda.resize(numParticles);
     auto &pos = prim->verts;
 
-    for (size_t i = 0; i < numParticles; i++)
+    //each particle only writes its own lambda
+#pragma omp parallel for
+    for (intptr_t i = 0; i < numParticles; i++)
     {
         vec3f gradI{0.0, 0.0, 0.0};
         float sumSqr = 0.0;
         float densityCons = 0.0;
 
-        for (size_t j = 0; j < neighborList[i].size(); j++)
+        for (int j = neighborOffsets[i]; j < neighborOffsets[i + 1]; j++)
         {
-            int pj = neighborList[i][j];
+            int pj = neighborIndices[j];
             vec3f distVec = pos[i] - pos[pj];
             vec3f gradJ = kernelSpikyGradient(distVec, h);
             gradI += gradJ;
@@ -82,12 +84,13 @@ void PBF::computeDpos()
     dpos.resize(numParticles);
     auto &pos = prim->verts;
 
-    for (size_t i = 0; i < numParticles; i++)
+#pragma omp parallel for
+    for (intptr_t i = 0; i < numParticles; i++)
     {
         vec3f dposI{0.0, 0.0, 0.0};
-        for (size_t j = 0; j < neighborList[i].size(); j++)
+        for (int j = neighborOffsets[i]; j < neighborOffsets[i + 1]; j++)
         {
-            int pj = neighborList[i][j];
+            int pj = neighborIndices[j];
             vec3f distVec = pos[i] - pos[pj];
 
             float sCorr = computeScorr(distVec, coeffDq, coeffK, h);
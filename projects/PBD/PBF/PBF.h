@@ -4,6 +4,7 @@
 #include <map>
 #include <zeno/types/PrimitiveObject.h>
 #include "SPHKernelFuncs.h"
+#include "NeighborGrid.h"
 
 namespace zeno{
 struct PBF : INode{
@@ -47,28 +48,11 @@ private:
     void boundaryHandling(vec3f &p);
     inline float computeScorr(const vec3f& distVec, float coeffDq, float coeffK, float h);
 
-    //data for cells
-    inline vec3i getCellXYZ(const vec3f& p);
-    inline int getCellID(const vec3f& p);
-    inline int getCellHash(int i, int j, int k);
-    inline bool isInBound(const vec3i& cell);
-    inline int cellXYZ2ID(const vec3i& xyz);
-    inline vec3i cellID2XYZ(int i);
-    std::array<int, 3> numCellXYZ;
-    int numCell;
+    //neighborList, CSR格式：粒子i的邻居为 neighborIndices[neighborOffsets[i]] ... neighborIndices[neighborOffsets[i+1]-1]
     float dx; //cell size
-    float dxInv; 
-    void initCellData();
-    void initNeighborList();
-    struct Cell
-    {
-        int x,y,z;
-        std::vector<int> parInCell; 
-    };
-    std::map<int, Cell>  cell;
-
-    //neighborList
-    std::vector<std::vector<int>> neighborList;
+    NeighborGrid grid;
+    std::vector<int> neighborOffsets;
+    std::vector<int> neighborIndices;
     void neighborSearch();
 
 public:
@@ -111,13 +95,10 @@ public:
             vel.resize(numParticles);
             lambda.resize(numParticles);
             dpos.resize(numParticles);
-
-            initCellData();
-            initNeighborList(); 
         }
 
         preSolve();
-        neighborSearch();//grid-baed neighborSearch
+        neighborSearch();//grid-based neighborSearch
         for (size_t i = 0; i < numSubsteps; i++)
             solve(); 
         postSolve();  
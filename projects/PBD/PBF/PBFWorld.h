@@ -1,5 +1,6 @@
 #include <zeno/zeno.h>
 #include <zeno/core/IObject.h>
+#include "./NeighborGrid.h"
 namespace zeno
 {
 
@@ -35,8 +36,10 @@ struct PBFWorld:IObject
 
     // std::shared_ptr<zeno::PrimitiveObject> prim;
     
-    //neighborList
-    std::vector<std::vector<int>> neighborList;
+    //neighborList, CSR格式：粒子i的邻居为 neighborIndices[neighborOffsets[i]] ... neighborIndices[neighborOffsets[i+1]-1]
+    std::vector<int> neighborOffsets;
+    std::vector<int> neighborIndices;
+    NeighborGrid grid; //邻域搜索用的网格，每个substep复用
 };
 
     
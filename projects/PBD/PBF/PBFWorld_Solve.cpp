@@ -26,7 +26,8 @@ struct PBFWorld_Solve : zeno::INode {
 
         //apply the dpos to the pos
         auto & pos = prim->verts;
-        for (size_t i = 0; i < data->numParticles; i++)
+#pragma omp parallel for
+        for (intptr_t i = 0; i < data->numParticles; i++)
             pos[i] += data->dpos[i];
     }
     
@@ -36,17 +37,20 @@ struct PBFWorld_Solve : zeno::INode {
         data->lambda.clear();
         data->lambda.resize(data->numParticles);
         const auto &pos = prim->verts;//这里只访问，不修改
-        const auto &neighborList = data->neighborList;//这里只访问，不修改
+        const auto &offsets = data->neighborOffsets;//这里只访问，不修改
+        const auto &neighbors = data->neighborIndices;
 
-        for (size_t i = 0; i < data->numParticles; i++)
+        //每个粒子只写自己的lambda，可以并行
+#pragma omp parallel for
+        for (intptr_t i = 0; i < data->numParticles; i++)
         {
             vec3f gradI{0.0, 0.0, 0.0};
             float sumSqr = 0.0;
             float densityCons = 0.0;
 
-            for (size_t j = 0; j < neighborList[i].size(); j++)
+            for (int j = offsets[i]; j < offsets[i + 1]; j++)
             {
-                int pj = neighborList[i][j];//pj是第j个邻居的下标
+                int pj = neighbors[j];//pj是第j个邻居的下标
                 vec3f distVec = pos[i] - pos[pj];
                 vec3f gradJ = CubicKernel::gradW(distVec);
                 gradI += gradJ;
@@ -67,14 +71,16 @@ struct PBFWorld_Solve : zeno::INode {
         data->dpos.clear();
         data->dpos.resize(data->numParticles);
         const auto &pos = prim->verts; //这里只访问，不修改
-        const auto &neighborList = data->neighborList;//这里只访问，不修改
+        const auto &offsets = data->neighborOffsets;//这里只访问，不修改
+        const auto &neighbors = data->neighborIndices;
 
-        for (size_t i = 0; i < data->numParticles; i++)
+#pragma omp parallel for
+        for (intptr_t i = 0; i < data->numParticles; i++)
         {
             vec3f dposI{0.0, 0.0, 0.0};
-            for (size_t j = 0; j < neighborList[i].size(); j++)
+            for (int j = offsets[i]; j < offsets[i + 1]; j++)
             {
-                int pj = neighborList[i][j];
+                int pj = neighbors[j];
                 vec3f distVec = pos[i] - pos[pj];
 
                 float sCorr = 0.0;
@@ -1,4 +1,3 @@
-#include "../ZenoFX/LinearBvh.h"
 #include <zeno/types/PrimitiveObject.h>
 #include <zeno/zeno.h>
 #include "./PBFWorld.h"
@@ -28,34 +27,9 @@ struct PBFWorld_Step : zeno::INode {
     {
         auto &pos = prim->verts;
 
-        //构建BVH
-        auto lbvh = std::make_shared<zeno::LBvh>(prim,  data->neighborSearchRadius,zeno::LBvh::element_c<zeno::LBvh::element_e::point>);
-
-        //清零
-        data->neighborList.clear();
-        data->neighborList.resize(pos.size());
-
-        //邻域搜索
-        buildNeighborList(pos, data->neighborSearchRadius, lbvh.get(), data->neighborList);
-    }
-
-
-    void buildNeighborList(const std::vector<vec3f> &pos, float searchRadius, const zeno::LBvh *lbvh, std::vector<std::vector<int>> & list)
-    {
-        auto radius2 = searchRadius*searchRadius;
-        #pragma omp parallel for
-        for (int i = 0; i < pos.size(); i++) 
-        {
-            //BVH的使用
-            lbvh->iter_neighbors(pos[i], [&](int j) 
-                {
-                    if (lengthSquared(pos[i] - pos[j]) < radius2 && j!=i)
-                    {
-                        list[i].emplace_back(j);
-                    }
-                }
-            );
-        }
+        //构建网格（缓冲区复用上一步的），生成CSR邻居表
+        data->grid.build(pos, data->neighborSearchRadius);
+        data->grid.buildNeighborList(pos, data->neighborSearchRadius, data->neighborOffsets, data->neighborIndices);
     }
 
     void boundaryHandling(vec3f & p, const vec3f &bounds_min, const vec3f &bounds_max)
@@ -83,7 +57,8 @@ struct PBFWorld_Step : zeno::INode {
 
         //apply the dpos to the pos
         auto & pos = prim->verts;
-        for (size_t i = 0; i < data->numParticles; i++)
+#pragma omp parallel for
+        for (intptr_t i = 0; i < data->numParticles; i++)
             pos[i] += data->dpos[i];
     }
     
@@ -93,17 +68,20 @@ struct PBFWorld_Step : zeno::INode {
         data->lambda.clear();
         data->lambda.resize(data->numParticles);
         const auto &pos = prim->verts;//这里只访问，不修改
-        const auto &neighborList = data->neighborList;//这里只访问，不修改
+        const auto &offsets = data->neighborOffsets;//这里只访问，不修改
+        const auto &neighbors = data->neighborIndices;
 
-        for (size_t i = 0; i < data->numParticles; i++)
+        //每个粒子只写自己的lambda，可以并行
+#pragma omp parallel for
+        for (intptr_t i = 0; i < data->numParticles; i++)
         {
             vec3f gradI{0.0, 0.0, 0.0};
             float sumSqr = 0.0;
             float densityCons = 0.0;
 
-            for (size_t j = 0; j < neighborList[i].size(); j++)
+            for (int j = offsets[i]; j < offsets[i + 1]; j++)
             {
-                int pj = neighborList[i][j];//pj是第j个邻居的下标
+                int pj = neighbors[j];//pj是第j个邻居的下标
                 vec3f distVec = pos[i] - pos[pj];
                 vec3f gradJ = SpikyKernel::gradW(distVec);
                 gradI += gradJ;
@@ -124,14 +102,16 @@ struct PBFWorld_Step : zeno::INode {
         data->dpos.clear();
         data->dpos.resize(data->numParticles);
         const auto &pos = prim->verts; //这里只访问，不修改
-        const auto &neighborList = data->neighborList;//这里只访问，不修改
+        const auto &offsets = data->neighborOffsets;//这里只访问，不修改
+        const auto &neighbors = data->neighborIndices;
 
-        for (size_t i = 0; i < data->numParticles; i++)
+#pragma omp parallel for
+        for (intptr_t i = 0; i < data->numParticles; i++)
         {
             vec3f dposI{0.0, 0.0, 0.0};
-            for (size_t j = 0; j < neighborList[i].size(); j++)
+            for (int j = offsets[i]; j < offsets[i + 1]; j++)
             {
-                int pj = neighborList[i][j];
+                int pj = neighbors[j];
                 vec3f distVec = pos[i] - pos[pj];
 
                 float sCorr = 0.0;
@@ -169,7 +149,9 @@ struct PBFWorld_Step : zeno::INode {
         printf("pos[0] = %.5e, %.5e, %.5e \n",pos[0][0],pos[0][1], pos[0][2]);
 
         neighborhoodSearch(data.get(),prim);
-        echoVec(data->neighborList[0]);
+        std::vector<int> neighbors0(data->neighborIndices.begin() + data->neighborOffsets[0],
+                                    data->neighborIndices.begin() + data->neighborOffsets[1]);
+        echoVec(neighbors0);
 
         for(int i=0; i<data->numSubsteps; i++)
             solve(data.get(), prim.get());
@@ -137,17 +137,13 @@ void PBF_BVH::neighborSearch(std::shared_ptr<PrimitiveObject> prim)
 void PBF_BVH::buildNeighborList(const std::vector<vec3f> &pos, float searchRadius, const zeno::LBvh *lbvh, std::vector<std::vector<int>> & list)
 {
     auto radius2 = searchRadius*searchRadius;
-    #pragma omp parallel for
-    for (int i = 0; i < pos.size(); i++) 
-    {
-        //BVH的使用
-        lbvh->iter_neighbors(pos[i], [&](int j) 
+    //BVH的使用, 相邻粒子打包成一组同时遍历
+    lbvh->iter_neighbors_batch(pos.data(), pos.size(), [&](int i, int j)
+        {
+            if (lengthSquared(pos[i] - pos[j]) < radius2 && j!=i)
             {
-                if (lengthSquared(pos[i] - pos[j]) < radius2 && j!=i)
-                {
-                    list[i].emplace_back(j);
-                }
+                list[i].emplace_back(j);
             }
-        );
-    }
+        }
+    );
 }
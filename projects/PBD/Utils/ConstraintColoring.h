@@ -0,0 +1,131 @@
+#pragma once
+
+#include <zeno/types/PrimitiveObject.h>
+#include <zeno/types/UserData.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+
+namespace zeno {
+
+/**
+ * @brief 约束按颜色分组：同一颜色的约束互不共享顶点，可以并行求解，
+ * 按颜色顺序逐组求解仍然是Gauss-Seidel，且结果与线程数无关。
+ * 颜色k的约束为 order[offsets[k]] ... order[offsets[k+1]-1]。
+ */
+struct ConstraintColoring {
+    std::vector<int> offsets;
+    std::vector<int> order;
+
+    int numColors() const {
+        return (int)offsets.size() - 1;
+    }
+};
+
+/**
+ * @brief 贪心着色。verts_of(c)返回约束c的N个顶点，-1表示空位；顶点全为-1的约束不参与求解，颜色为-1。
+ * 每个顶点用64位掩码记录已用的颜色，一轮放不下的约束留到下一轮（颜色64起）。
+ */
+template <std::size_t N, class F>
+void colorConstraints(std::size_t nverts, std::size_t ncons, F const &verts_of, int *color) {
+    std::vector<int> pending;
+    pending.reserve(ncons);
+    for (std::size_t c = 0; c < ncons; c++) {
+        std::array<int, N> ids = verts_of(c);
+        bool valid = std::any_of(ids.begin(), ids.end(), [] (int id) { return id >= 0; });
+        color[c] = -1;
+        if (valid)
+            pending.push_back((int)c);
+    }
+    for (int base = 0; !pending.empty(); base += 64) {
+        std::vector<std::uint64_t> used(nverts);
+        std::vector<int> next;
+        for (int c: pending) {
+            std::array<int, N> ids = verts_of(c);
+            std::uint64_t mask = 0;
+            for (int id: ids)
+                if (id >= 0)
+                    mask |= used[id];
+            if (mask == ~(std::uint64_t)0) {
+                next.push_back(c);
+                continue;
+            }
+            int k = 0;
+            while (mask >> k & 1)
+                k++;
+            color[c] = base + k;
+            for (int id: ids)
+                if (id >= 0)
+                    used[id] |= (std::uint64_t)1 << k;
+        }
+        pending.swap(next);
+    }
+}
+
+/**
+ * @brief 按颜色对约束做稳定的计数排序，同色约束保持原有顺序。
+ */
+inline ConstraintColoring groupByColor(int const *color, std::size_t ncons) {
+    ConstraintColoring res;
+    int ncolors = 0;
+    for (std::size_t c = 0; c < ncons; c++)
+        ncolors = std::max(ncolors, color[c] + 1);
+    res.offsets.assign(ncolors + 1, 0);
+    for (std::size_t c = 0; c < ncons; c++)
+        if (color[c] >= 0)
+            res.offsets[color[c] + 1]++;
+    for (int k = 0; k < ncolors; k++)
+        res.offsets[k + 1] += res.offsets[k];
+    res.order.resize(res.offsets[ncolors]);
+    std::vector<int> cursor(res.offsets.begin(), res.offsets.end() - 1);
+    for (std::size_t c = 0; c < ncons; c++)
+        if (color[c] >= 0)
+            res.order[cursor[color[c]]++] = (int)c;
+    return res;
+}
+
+/**
+ * @brief 拓扑的指纹（约束的顶点编号和顶点数），用来判断缓存的着色是否过期。
+ */
+template <class T>
+std::string topologyKey(std::vector<T> const &cons, std::size_t nverts) {
+    std::uint64_t h = 0;
+    intptr_t n = cons.size() * sizeof(T) / sizeof(int);
+    auto const *ids = reinterpret_cast<int const *>(cons.data());
+#pragma omp parallel for reduction(^: h)
+    for (intptr_t i = 0; i < n; i++) {
+        std::uint64_t x = (std::uint64_t)(std::uint32_t)ids[i] | (std::uint64_t)i << 32;
+        x *= 0x9e3779b97f4a7c15ull;
+        h ^= x ^ (x >> 29);
+    }
+    return std::to_string(h) + ':' + std::to_string(cons.size()) + ':' + std::to_string(nverts);
+}
+
+/**
+ * @brief 取得约束的着色。着色以int属性colorAttr缓存在约束数组上（每个约束M个颜色，例如每个三角形的三条边），
+ * 拓扑指纹存在userData的keyName中，只有lines/tets等拓扑改变时才重新着色。
+ *
+ * @param prim 存放userData的prim
+ * @param cons 约束数组，如prim->lines
+ * @param nverts 顶点数
+ * @param verts_of 第c个约束（c < cons.size()*M）的N个顶点
+ */
+template <std::size_t N, class AttrT, class T, class F>
+ConstraintColoring cachedColoring(PrimitiveObject *prim, AttrVector<T> &cons, std::size_t nverts,
+                                  std::string const &colorAttr, std::string const &keyName, F const &verts_of) {
+    constexpr std::size_t M = sizeof(AttrT) / sizeof(int);
+    auto key = topologyKey(cons.values, nverts);
+    bool stale = !cons.template attr_is<AttrT>(colorAttr) || prim->userData().get2<std::string>(keyName, "") != key;
+    auto &color = cons.template add_attr<AttrT>(colorAttr);
+    color.resize(cons.size());
+    auto *colorData = reinterpret_cast<int *>(color.data());
+    if (stale) {
+        colorConstraints<N>(nverts, cons.size() * M, verts_of, colorData);
+        prim->userData().set2(keyName, key);
+    }
+    return groupByColor(colorData, cons.size() * M);
+}
+
+}
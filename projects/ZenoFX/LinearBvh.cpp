@@ -5,6 +5,7 @@
 #include <exception>
 #include <iostream>
 #include <stdexcept>
+#include <tuple>
 #include <zeno/zeno.h>
 #if defined(_OPENMP)
 #include <omp.h>
@@ -12,118 +13,93 @@
 
 namespace zeno {
 
-typename LBvh::BvFunc
-LBvh::getBvFunc(const std::shared_ptr<PrimitiveObject> &prim) const {
-  constexpr auto ma = std::numeric_limits<float>::max();
-  constexpr auto mi = std::numeric_limits<float>::lowest();
-  const Box defaultBox{TV{ma, ma, ma}, TV{mi, mi, mi}};
+namespace {
+
+/// bounding box of element i, resolved at compile time per element category;
+/// holds raw views into the primitive so it must not outlive the build/refit
+template <LBvh::element_e et> struct BvEval {
+  using TV = LBvh::TV;
+  using Box = LBvh::Box;
+  using Ti = LBvh::Ti;
+  const vec3f *refpos;
+  const void *elements;
+  const float *radius{nullptr};
+  const float *neiRadius{nullptr};
+  float thickness;
+
+  BvEval(const PrimitiveObject &prim, const LBvh &bvh)
+      : refpos(prim.attr<vec3f>("pos").data()), thickness(bvh.thickness) {
+    if constexpr (et == LBvh::element_e::tet)
+      elements = prim.quads.data();
+    else if constexpr (et == LBvh::element_e::tri)
+      elements = prim.tris.data();
+    else if constexpr (et == LBvh::element_e::line)
+      elements = prim.lines.data();
+    else {
+      elements = prim.points.data();
+      if (bvh.radiusAttr.empty() && !bvh.neiRadiusAttr.empty())
+        throw std::runtime_error("neiRadiusAttr should be empty when radiusAttr is empty");
+      if (!bvh.radiusAttr.empty())
+        radius = prim.verts.attr<float>(bvh.radiusAttr).data();
+      if (!bvh.neiRadiusAttr.empty())
+        neiRadius = prim.verts.attr<float>(bvh.neiRadiusAttr).data();
+    }
+  }
 
-  std::function<Box(typename LBvh::Ti)> getBv;
-  if (eleCategory == element_e::tet)
-    getBv = [&quads = prim->quads, &refpos = prim->attr<vec3f>("pos"),
-             defaultBox, this](Ti i) -> Box {
-      auto quad = quads[i];
-      Box bv = defaultBox;
-      for (int j = 0; j != 4; ++j) {
-        const auto &p = refpos[quad[j]];
-        for (int d = 0; d != 3; ++d) {
-          if (p[d] - thickness < bv.first[d])
-            bv.first[d] = p[d] - thickness;
-          if (p[d] + thickness > bv.second[d])
-            bv.second[d] = p[d] + thickness;
-        }
+  Box operator()(Ti i) const {
+    constexpr auto ma = std::numeric_limits<float>::max();
+    constexpr auto mi = std::numeric_limits<float>::lowest();
+    Box bv{TV{ma, ma, ma}, TV{mi, mi, mi}};
+    auto expand = [&](const vec3f &p, float r) {
+      for (int d = 0; d != 3; ++d) {
+        if (p[d] - r < bv.first[d])
+          bv.first[d] = p[d] - r;
+        if (p[d] + r > bv.second[d])
+          bv.second[d] = p[d] + r;
       }
-      return bv;
     };
-  else if (eleCategory == element_e::tri)
-    getBv = [&tris = prim->tris, &refpos = prim->attr<vec3f>("pos"), defaultBox,
-             this](Ti i) -> Box {
-      auto tri = tris[i];
-      Box bv = defaultBox;
-      for (int j = 0; j != 3; ++j) {
-        const auto &p = refpos[tri[j]];
-        for (int d = 0; d != 3; ++d) {
-          if (p[d] - thickness < bv.first[d])
-            bv.first[d] = p[d] - thickness;
-          if (p[d] + thickness > bv.second[d])
-            bv.second[d] = p[d] + thickness;
-        }
-      }
-      return bv;
-    };
-  else if (eleCategory == element_e::line)
-    getBv = [&lines = prim->lines, &refpos = prim->attr<vec3f>("pos"),
-             defaultBox, this](Ti i) -> Box {
-      auto line = lines[i];
-      Box bv = defaultBox;
-      for (int j = 0; j != 2; ++j) {
-        const auto &p = refpos[line[j]];
-        for (int d = 0; d != 3; ++d) {
-          if (p[d] - thickness < bv.first[d])
-            bv.first[d] = p[d] - thickness;
-          if (p[d] + thickness > bv.second[d])
-            bv.second[d] = p[d] + thickness;
-        }
-      }
-      return bv;
-    };
-  else if (eleCategory == element_e::point)
-      if (radiusAttr.empty() && neiRadiusAttr.empty()) {
-        getBv = [&points = prim->points, &refpos = prim->attr<vec3f>("pos"),  
-             defaultBox, this](Ti i) -> Box {
-        auto point = points[i];
-        Box bv = defaultBox;
-        const auto &p = refpos[point];
-        for (int d = 0; d != 3; ++d) {
-          if (p[d] - thickness < bv.first[d])
-            bv.first[d] = p[d] - thickness ;
-          if (p[d] + thickness > bv.second[d])
-            bv.second[d] = p[d] + thickness;
-          }
-      return bv;
-        };
-      } 
-      else if(!radiusAttr.empty() && neiRadiusAttr.empty()) {
-        getBv = [&points = prim->points, &refpos = prim->attr<vec3f>("pos"), 
-        &radius = prim->verts.attr<float>(radiusAttr),
-             defaultBox, this](Ti i) -> Box {
-        auto point = points[i];
-        Box bv = defaultBox;
-        const auto &p = refpos[point];
-        for (int d = 0; d != 3; ++d) {
-          if (p[d] - thickness - radius[i] < bv.first[d])
-            bv.first[d] = p[d] - thickness - radius[i];
-          if (p[d] + thickness + radius[i]  > bv.second[d])
-            bv.second[d] = p[d] + thickness + radius[i];
-          }
-      return bv;
-      };
-    }
-      else if(!radiusAttr.empty() && !neiRadiusAttr.empty()) {
-        getBv = [&points = prim->points, &refpos = prim->attr<vec3f>("pos"), 
-        &radius = prim->verts.attr<float>(radiusAttr),
-        &neiRadius = prim->verts.attr<float>(neiRadiusAttr),
-             defaultBox, this](Ti i) -> Box {
-        auto point = points[i];
-        Box bv = defaultBox;
-        const auto &p = refpos[point];
-        for (int d = 0; d != 3; ++d) {
-          if (p[d] - thickness - radius[i] - neiRadius[point] < bv.first[d])
-            bv.first[d] = p[d] - thickness - radius[i]- neiRadius[point] ;
-          if (p[d] + thickness + radius[i]  + neiRadius[point]> bv.second[d])
-            bv.second[d] = p[d] + thickness + radius[i] + neiRadius[point];
-          }
-      return bv;
-      };
+    if constexpr (et == LBvh::element_e::tet) {
+      auto quad = static_cast<const vec4i *>(elements)[i];
+      for (int j = 0; j != 4; ++j)
+        expand(refpos[quad[j]], thickness);
+    } else if constexpr (et == LBvh::element_e::tri) {
+      auto tri = static_cast<const vec3i *>(elements)[i];
+      for (int j = 0; j != 3; ++j)
+        expand(refpos[tri[j]], thickness);
+    } else if constexpr (et == LBvh::element_e::line) {
+      auto line = static_cast<const vec2i *>(elements)[i];
+      for (int j = 0; j != 2; ++j)
+        expand(refpos[line[j]], thickness);
+    } else {
+      auto point = static_cast<const int *>(elements)[i];
+      float r = thickness;
+      if (radius)
+        r += radius[i];
+      if (neiRadius)
+        r += neiRadius[point];
+      expand(refpos[point], r);
     }
-      else{
-          throw std::runtime_error("neiRadiusAttr should be empty when radiusAttr is empty");
-      }
-  else if (eleCategory == element_e::unknown)
-    getBv = [defaultBox](Ti) -> Box { return defaultBox; };
-  return getBv;
+    return bv;
+  }
+};
+
+/// morton code of a point in the unit cube
+LBvh::Tu getMortonCode(const LBvh::TV &p) {
+  using Tu = LBvh::Tu;
+  auto expand_bits = [](Tu v) -> Tu { // expands lower 10-bits to 30 bits
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+  };
+  return (expand_bits((Tu)(p[0] * 1024.f)) << (Tu)2) |
+         (expand_bits((Tu)(p[1] * 1024.f)) << (Tu)1) |
+         expand_bits((Tu)(p[2] * 1024.f));
 }
 
+} // namespace
+
 template <LBvh::element_e et>
 void LBvh::build(const std::shared_ptr<PrimitiveObject> &prim, float thickness, std::string radiusAttr, std::string neiRadiusAttr,//neiprim????
                  element_t<et>) {
@@ -166,17 +142,18 @@ void LBvh::build(const std::shared_ptr<PrimitiveObject> &prim, float thickness,
 
   const auto &refpos = prim->attr<vec3f>("pos");
   const Ti numNodes = numLeaves > 2 ? numLeaves + numLeaves - 1 : numLeaves;
-  sortedBvs.resize(numNodes);
+  bvMins.resize(numNodes);
+  bvMaxs.resize(numNodes);
   auxIndices.resize(numNodes);
   levels.resize(numNodes);
   parents.resize(numNodes);
   leafIndices.resize(numLeaves);
 
-  this->getBv = getBvFunc(prim);
+  const BvEval<et> getBv(*prim, *this);
 
   if (numLeaves <= 2) { // edge cases where not enough primitives to form a tree
     for (Ti i = 0; i != numLeaves; ++i) {
-      sortedBvs[i] = getBv(i);
+      std::tie(bvMins[i], bvMaxs[i]) = getBv(i);
       leafIndices[i] = i;
       levels[i] = 0;
       auxIndices[i] = i;
@@ -235,19 +212,6 @@ void LBvh::build(const std::shared_ptr<PrimitiveObject> &prim, float thickness,
   // wholeBox.second[1], wholeBox.second[2]);
 
   std::vector<std::pair<Tu, Ti>> records(numLeaves); // <mc, id>
-  /// morton codes
-  auto getMortonCode = [](const TV &p) -> Tu {
-    auto expand_bits = [](Tu v) -> Tu { // expands lower 10-bits to 30 bits
-      v = (v * 0x00010001u) & 0xFF0000FFu;
-      v = (v * 0x00000101u) & 0x0F00F00Fu;
-      v = (v * 0x00000011u) & 0xC30C30C3u;
-      v = (v * 0x00000005u) & 0x49249249u;
-      return v;
-    };
-    return (expand_bits((Tu)(p[0] * 1024.f)) << (Tu)2) |
-           (expand_bits((Tu)(p[1] * 1024.f)) << (Tu)1) |
-           expand_bits((Tu)(p[2] * 1024.f));
-  };
   {
     const auto lengths = wholeBox.second - wholeBox.first;
     auto getUniformCoord = [&wholeBox, &lengths](const TV &p) {
@@ -444,7 +408,7 @@ void LBvh::build(const std::shared_ptr<PrimitiveObject> &prim, float thickness,
   // up starting from 0
 
   /// reorder trunk
-  // [sortedBvs], [auxIndices], [parents]
+  // [bvMins], [bvMaxs], [auxIndices], [parents]
   // auxIndices here is escapeIndex (for trunk nodes)
 #if defined(_OPENMP)
 #pragma omp parallel for
@@ -454,7 +418,8 @@ void LBvh::build(const std::shared_ptr<PrimitiveObject> &prim, float thickness,
     const auto &bv = trunkBvs[i];
     // auto l = trunkL[i];
     auto r = trunkR[i];
-    sortedBvs[dst] = bv;
+    bvMins[dst] = bv.first;
+    bvMaxs[dst] = bv.second;
     const auto rb = r + 1;
     if (rb < numLeaves) {
       auto lca = leafLca[rb]; // rb must be in left-branch
@@ -467,7 +432,7 @@ void LBvh::build(const std::shared_ptr<PrimitiveObject> &prim, float thickness,
   }
 
   /// reorder leaf
-  // [sortedBvs], [auxIndices], [levels], [parents], [leafIndices]
+  // [bvMins], [bvMaxs], [auxIndices], [levels], [parents], [leafIndices]
   // auxIndices here is primitiveIndex (for leaf nodes)
 #if defined(_OPENMP)
 #pragma omp parallel for
@@ -478,7 +443,8 @@ void LBvh::build(const std::shared_ptr<PrimitiveObject> &prim, float thickness,
 
     auto dst = leafOffsets[i + 1] - 1;
     leafIndices[i] = dst;
-    sortedBvs[dst] = bv;
+    bvMins[dst] = bv.first;
+    bvMaxs[dst] = bv.second;
     auxIndices[dst] = records[i].second;
     levels[dst] = 0;
     if (parents[dst] == dst - 1)
@@ -516,69 +482,92 @@ void LBvh::build(const std::shared_ptr<PrimitiveObject> &prim,
     build(prim, thickness, radiusAttr, neiRadiusAttr, element_c<element_e::point>);
 }
 
-void LBvh::refit() {
+template <LBvh::element_e et> void LBvh::refit(element_t<et>) {
   std::shared_ptr<const PrimitiveObject> prim = primPtr.lock();
   if (!prim)
     throw std::runtime_error(
         "the primitive object referenced by lbvh not available anymore");
-  const auto &refpos = prim->attr<vec3f>("pos");
+  // views are taken anew on every refit, the attribute arrays may have been
+  // reallocated since the build
+  const BvEval<et> getBv(*prim, *this);
 
-  const auto numLeaves = getNumLeaves();
+  const Ti numLeaves = getNumLeaves();
   if (numLeaves <= 2) {
-    for (Ti i = 0; i != numLeaves; ++i) {
-      sortedBvs[i] = getBv(i);
-      leafIndices[i] = i;
-      levels[i] = 0;
-      auxIndices[i] = i;
-      parents[i] = -1;
-    }
+    for (Ti i = 0; i != numLeaves; ++i)
+      std::tie(bvMins[i], bvMaxs[i]) = getBv(auxIndices[i]);
     return;
   }
-  const auto numNodes = numLeaves * 2 - 1;
+  const Ti numNodes = numLeaves * 2 - 1;
+  // already zero-initialized during default ctor, as in build
   std::vector<std::atomic<Ti>> refitFlags(numNodes);
-#if 0
-        // comment out with the same reason in build
-#pragma omp parallel for
-        for (Ti i = 0; i < numNodes; ++i)
-            refitFlags[i] = 0;
-#endif
 
-  {
 #if defined(_OPENMP)
 #pragma omp parallel for
 #endif
-    for (Ti nid = 0; nid < numLeaves; ++nid) {
-      auto idx = leafIndices[nid];
-      sortedBvs[idx] = getBv(auxIndices[idx]);
-
-      auto par = parents[idx];
-      while (par != -1) {
-        Ti old{0};
-        if (refitFlags[par].compare_exchange_strong(old, (Ti)1,
-                                                    std::memory_order_acquire))
-          break;
-        auto lc = par + 1;
-        auto rc = levels[lc] == 0 ? lc + 1 : auxIndices[lc];
-        // merge box
-        const auto &leftBox = sortedBvs[lc];
-        const auto &rightBox = sortedBvs[rc];
-        Box bv{};
-        for (int d = 0; d != 3; ++d) {
-          bv.first[d] = leftBox.first[d] < rightBox.first[d]
-                            ? leftBox.first[d]
-                            : rightBox.first[d];
-          bv.second[d] = leftBox.second[d] > rightBox.second[d]
-                             ? leftBox.second[d]
-                             : rightBox.second[d];
-        }
-        sortedBvs[par] = bv;
-        atomic_thread_fence(std::memory_order_release);
-        par = parents[par];
+  for (Ti nid = 0; nid < numLeaves; ++nid) {
+    auto idx = leafIndices[nid];
+    std::tie(bvMins[idx], bvMaxs[idx]) = getBv(auxIndices[idx]);
+
+    auto par = parents[idx];
+    while (par != -1) {
+      // the first child to arrive leaves, the second one merges both boxes
+      Ti old{0};
+      if (refitFlags[par].compare_exchange_strong(old, (Ti)1,
+                                                  std::memory_order_acq_rel))
+        break;
+      auto lc = par + 1;
+      auto rc = levels[lc] == 0 ? lc + 1 : auxIndices[lc];
+      for (int d = 0; d != 3; ++d) {
+        bvMins[par][d] = std::min(bvMins[lc][d], bvMins[rc][d]);
+        bvMaxs[par][d] = std::max(bvMaxs[lc][d], bvMaxs[rc][d]);
       }
+      par = parents[par];
     }
   }
 }
 
+template void LBvh::refit<LBvh::element_e::point>(element_t<element_e::point>);
+template void LBvh::refit<LBvh::element_e::line>(element_t<element_e::line>);
+template void LBvh::refit<LBvh::element_e::tri>(element_t<element_e::tri>);
+template void LBvh::refit<LBvh::element_e::tet>(element_t<element_e::tet>);
+
+void LBvh::refit() {
+  if (eleCategory == element_e::tet)
+    refit(element_c<element_e::tet>);
+  else if (eleCategory == element_e::tri)
+    refit(element_c<element_e::tri>);
+  else if (eleCategory == element_e::line)
+    refit(element_c<element_e::line>);
+  else if (eleCategory == element_e::point)
+    refit(element_c<element_e::point>);
+}
+
+std::vector<LBvh::Ti> LBvh::coherentOrder(TV const *pos, std::size_t n) const {
+  std::vector<std::pair<Tu, Ti>> records(n); // <mc, qid>
+  TV lo{0.f, 0.f, 0.f}, lengths{1.f, 1.f, 1.f};
+  if (!bvMins.empty()) {
+    lo = bvMins[0];
+    lengths = bvMaxs[0] - bvMins[0];
+    for (int d = 0; d != 3; ++d)
+      if (!(lengths[d] > 0.f))
+        lengths[d] = 1.f;
+  }
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+  for (intptr_t i = 0; i < (intptr_t)n; ++i) {
+    auto offsets = pos[i] - lo;
+    for (int d = 0; d != 3; ++d)
+      offsets[d] = std::clamp(offsets[d], (float)0, lengths[d]) / lengths[d];
+    records[i] = std::make_pair(getMortonCode(offsets), (Ti)i);
+  }
+  std::sort(std::begin(records), std::end(records));
+  std::vector<Ti> order(n);
+  for (std::size_t i = 0; i != n; ++i)
+    order[i] = records[i].second;
+  return order;
+}
+
 /// nearest primitive
 template <LBvh::element_e et>
 typename LBvh::TV LBvh::find_nearest(TV const &pos, Ti &id, float &dist,
@@ -589,7 +578,7 @@ typename LBvh::TV LBvh::find_nearest(TV const &pos, Ti &id, float &dist,
         "the primitive object referenced by lbvh not available anymore");
   const auto &refpos = prim->attr<vec3f>("pos");
 
-  const Ti numNodes = sortedBvs.size();
+  const Ti numNodes = bvMins.size();
   Ti node = 0;
   TV ws{0.f, 0.f, 0.f};
   TV wsTmp{0.f, 0.f, 0.f};
@@ -597,7 +586,7 @@ typename LBvh::TV LBvh::find_nearest(TV const &pos, Ti &id, float &dist,
     Ti level = levels[node];
     // level and node are always in sync
     for (; level; --level, ++node)
-      if (auto d = distance(sortedBvs[node], pos); d > dist)
+      if (auto d = distance(getBox(node), pos); d > dist)
         break;
     // leaf node check
     if (level == 0) {
@@ -5,12 +5,20 @@
 #include <zeno/types/PrimitiveObject.h>
 #include <zeno/utils/vec.h>
 #include <zeno/zeno.h>
+#include <algorithm>
+#include <cstdint>
 #include <exception>
 #include <stdexcept>
 #include "SpatialUtils.hpp"
 #if defined(_OPENMP)
 #include <omp.h>
 #endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace zeno {
 
@@ -24,11 +32,12 @@ struct LBvh : IObjectClone<LBvh> {
   using Box = std::pair<TV, TV>;
   using Ti = int;
   using Tu = std::make_unsigned_t<Ti>;
-  using BvFunc = std::function<Box(Ti)>;
+  /// number of queries traversing the tree together in the packet queries
+  static constexpr int packet_size = 8;
 
   std::weak_ptr<const PrimitiveObject> primPtr;
-  BvFunc getBv;
-  std::vector<Box> sortedBvs;
+  /// node bounding boxes in traversal order, lower and upper corners kept apart
+  std::vector<TV> bvMins, bvMaxs;
   std::vector<Ti> auxIndices, levels, parents, leafIndices;
   float thickness{0};
   std::string radiusAttr{""};
@@ -57,7 +66,7 @@ struct LBvh : IObjectClone<LBvh> {
 
   std::size_t getNumLeaves() const noexcept { return leafIndices.size(); }
   std::size_t getNumNodes() const noexcept { return getNumLeaves() * 2 - 1; }
-  BvFunc getBvFunc(const std::shared_ptr<PrimitiveObject> &prim) const;
+  Box getBox(Ti node) const { return Box{bvMins[node], bvMaxs[node]}; }
 
   template <element_e et>
   void build(const std::shared_ptr<PrimitiveObject> &prim, float thickness, std::string radiusAttr,std::string neiRadiusAttr,
@@ -66,48 +75,52 @@ struct LBvh : IObjectClone<LBvh> {
   void build(const std::shared_ptr<PrimitiveObject> &prim, float thickness, std::string radiusAttr, std::string neiRadiusAttr);
 
 
+  /// recompute the boxes of a deforming primitive, keeping the topology
+  template <element_e et> void refit(element_t<et>);
   void refit();
 
-  static bool intersect(const Box &box, const TV &p) noexcept {
+  static bool intersect(const TV &mi, const TV &ma, const TV &p) noexcept {
     constexpr int dim = 3;
     for (Ti d = 0; d != dim; ++d)
-      if (p[d] < box.first[d] || p[d] > box.second[d])
+      if (p[d] < mi[d] || p[d] > ma[d])
         return false;
     return true;
   }
+  static bool intersect(const Box &box, const TV &p) noexcept {
+    return intersect(box.first, box.second, p);
+  }
 
-  static bool intersect_radius(const Box &box, const TV &p, const float &radius) noexcept {
-  constexpr int dim = 3;
-  float sqDist = 0.0;
-  for (Ti d = 0; d != dim; ++d) {
-    if (p[d] < box.first[d]) {
-      float diff = box.first[d] - p[d];
-      sqDist += diff * diff;
-    } else if (p[d] > box.second[d]) {
-      float diff = p[d] - box.second[d];
-      sqDist += diff * diff;
+  static float sqdist_box(const TV &mi, const TV &ma, const TV &p) noexcept {
+    constexpr int dim = 3;
+    float sqDist = 0.0;
+    for (Ti d = 0; d != dim; ++d) {
+      if (p[d] < mi[d]) {
+        float diff = mi[d] - p[d];
+        sqDist += diff * diff;
+      } else if (p[d] > ma[d]) {
+        float diff = p[d] - ma[d];
+        sqDist += diff * diff;
+      }
     }
+    return sqDist;
   }
-  return sqDist <= radius * radius;
-}
 
+  static bool intersect_radius(const TV &mi, const TV &ma, const TV &p, const float &radius) noexcept {
+    return sqdist_box(mi, ma, p) <= radius * radius;
+  }
+  static bool intersect_radius(const Box &box, const TV &p, const float &radius) noexcept {
+    return intersect_radius(box.first, box.second, p, radius);
+  }
+
+  static bool intersect_radius_two(const TV &mi, const TV &ma, const TV &p, const float &radius, const float &neiradius) noexcept {
+    //auto dist = distance(box, p);
+    //return dist <= radius + neiradius;
+    float sqRadius = (radius + neiradius) * (radius + neiradius);
+    return sqdist_box(mi, ma, p) <= sqRadius;
+  }
   static bool intersect_radius_two(const Box &box, const TV &p, const float &radius, const float &neiradius) noexcept {
-  constexpr int dim = 3;
-  float sqDist = 0.0;
-  for (Ti d = 0; d != dim; ++d) {
-    if (p[d] < box.first[d]) {
-      float diff = box.first[d] - p[d];
-      sqDist += diff * diff;
-    } else if (p[d] > box.second[d]) {
-      float diff = p[d] - box.second[d];
-      sqDist += diff * diff;
-    }
+    return intersect_radius_two(box.first, box.second, p, radius, neiradius);
   }
-  //auto dist = distance(box, p);
-  //return dist <= radius + neiradius;
-  float sqRadius = (radius + neiradius) * (radius + neiradius);
-  return sqDist <= sqRadius;
-}
 
   static float distance(const Box &bv, const TV &x) {
     const auto &[mi, ma] = bv;
@@ -138,7 +151,7 @@ struct LBvh : IObjectClone<LBvh> {
         "the primitive object referenced by lbvh not available anymore");
   const auto &refpos = prim->attr<vec3f>("pos");
 
-  const Ti numNodes = sortedBvs.size();
+  const Ti numNodes = bvMins.size();
   Ti node = 0;
   TV ws{0.f, 0.f, 0.f};
   TV wsTmp{0.f, 0.f, 0.f};
@@ -146,7 +159,7 @@ struct LBvh : IObjectClone<LBvh> {
     Ti level = levels[node];
     // level and node are always in sync
     for (; level; --level, ++node)
-      if (auto d = distance(sortedBvs[node], pos); d > dist)
+      if (auto d = distance(getBox(node), pos); d > dist)
         break;
     // leaf node check
     if (level == 0) {
@@ -203,22 +216,22 @@ struct LBvh : IObjectClone<LBvh> {
   template <class F> void iter_neighbors(TV const &pos, F &&f) const {
     if (auto numLeaves = getNumLeaves(); numLeaves <= 2) {
       for (Ti i = 0; i != numLeaves; ++i) {
-        if (intersect(sortedBvs[i], pos))
+        if (intersect(bvMins[i], bvMaxs[i], pos))
           f(auxIndices[i]);
       }
       return;
     }
-    const Ti numNodes = sortedBvs.size();
+    const Ti numNodes = bvMins.size();
     Ti node = 0;
     while (node != -1 && node != numNodes) {
       Ti level = levels[node];
       // level and node are always in sync
       for (; level; --level, ++node)
-        if (!intersect(sortedBvs[node], pos))
+        if (!intersect(bvMins[node], bvMaxs[node], pos))
           break;
       // leaf node check
       if (level == 0) {
-        if (intersect(sortedBvs[node], pos))
+        if (intersect(bvMins[node], bvMaxs[node], pos))
           f(auxIndices[node]);
         node++;
       } else // separate at internal nodes
@@ -229,20 +242,20 @@ struct LBvh : IObjectClone<LBvh> {
    template <class F> void iter_neighbors_radius(TV const &pos, const float &radius, F &&f) const {
     if (auto numLeaves = getNumLeaves(); numLeaves <= 2) {
       for (Ti i = 0; i != numLeaves; ++i) {
-        if (intersect_radius(sortedBvs[i], pos, radius))
+        if (intersect_radius(bvMins[i], bvMaxs[i], pos, radius))
           f(auxIndices[i]);
       }
       return;
     }
-    const Ti numNodes = sortedBvs.size();
+    const Ti numNodes = bvMins.size();
     Ti node = 0;
     while (node != -1 && node != numNodes) {
       Ti level = levels[node];
       for (; level; --level, ++node)
-        if (!intersect_radius(sortedBvs[node], pos, radius))
+        if (!intersect_radius(bvMins[node], bvMaxs[node], pos, radius))
           break;
       if (level == 0) {
-        if (intersect_radius(sortedBvs[node], pos, radius))
+        if (intersect_radius(bvMins[node], bvMaxs[node], pos, radius))
           f(auxIndices[node]);
         node++;
       } else
@@ -254,21 +267,21 @@ struct LBvh : IObjectClone<LBvh> {
     auto psize = neiRadius.size();
     if (auto numLeaves = getNumLeaves(); numLeaves <= 2) {
       for (Ti i = 0; i != numLeaves; ++i) {
-          if (intersect_radius_two(sortedBvs[i], pos, radius, neiRadius[auxIndices[i]]))
+          if (intersect_radius_two(bvMins[i], bvMaxs[i], pos, radius, neiRadius[auxIndices[i]]))
             f(auxIndices[i]);
         
       }
       return;
     }
-    const Ti numNodes = sortedBvs.size();
+    const Ti numNodes = bvMins.size();
     Ti node = 0;
     while (node != -1 && node != numNodes) {
       Ti level = levels[node];
       for (; level; --level, ++node)
-        if (!intersect_radius_two(sortedBvs[node], pos, radius, 0))
+        if (!intersect_radius_two(bvMins[node], bvMaxs[node], pos, radius, 0))
           break;
       if (level == 0) {
-        if (intersect_radius_two(sortedBvs[node], pos, radius, neiRadius[auxIndices[node]]))
+        if (intersect_radius_two(bvMins[node], bvMaxs[node], pos, radius, neiRadius[auxIndices[node]]))
           f(auxIndices[node]);
         node++;
       } else
@@ -276,7 +289,145 @@ struct LBvh : IObjectClone<LBvh> {
     }
   }
 
+  static int ctz(unsigned x) noexcept {
+#if defined(_MSC_VER)
+    unsigned long r;
+    _BitScanForward(&r, x);
+    return (int)r;
+#else
+    return __builtin_ctz(x);
+#endif
+  }
 
+  /// packet traversal: up to packet_size queries walk the tree together,
+  /// descending wherever any of them overlaps; test(mi, ma) returns the mask of
+  /// lanes overlapping a box, f(lane, eid) is called for the accepted leaves.
+  /// child boxes lie within their parent's, so a lane that misses a node misses
+  /// its whole subtree and needs no masking on the way down
+  template <class Test, class F>
+  void iter_packet(int npos, Test &&test, F &&f) const {
+    const unsigned mask = (1u << npos) - 1;
+    auto visitLeaf = [&](Ti node) {
+      for (unsigned h = test(bvMins[node], bvMaxs[node]) & mask; h; h &= h - 1)
+        f(ctz(h), auxIndices[node]);
+    };
+    if (auto numLeaves = getNumLeaves(); numLeaves <= 2) {
+      for (Ti i = 0; i != numLeaves; ++i)
+        visitLeaf(i);
+      return;
+    }
+    const Ti numNodes = bvMins.size();
+    Ti node = 0;
+    while (node != -1 && node != numNodes) {
+      Ti level = levels[node];
+      for (; level; --level, ++node)
+        if (!(test(bvMins[node], bvMaxs[node]) & mask))
+          break;
+      if (level == 0) {
+        visitLeaf(node);
+        node++;
+      } else
+        node = auxIndices[node];
+    }
+  }
+
+  /// queries of a packet transposed into lanes, unused lanes repeat the first
+  /// query so the box tests stay branch-free
+  struct Packet {
+    float x[packet_size], y[packet_size], z[packet_size], r2[packet_size];
+
+    Packet(TV const *pos, const float *radius, int npos) noexcept {
+      for (int l = 0; l != packet_size; ++l) {
+        int q = l < npos ? l : 0;
+        x[l] = pos[q][0], y[l] = pos[q][1], z[l] = pos[q][2];
+        r2[l] = radius ? radius[q] * radius[q] : 0.f;
+      }
+    }
+#if defined(__SSE2__) || defined(_M_X64)
+    template <class Cond> unsigned lanes(Cond &&cond) const noexcept {
+      unsigned hits = 0;
+      for (int l = 0; l != packet_size; l += 4)
+        hits |= (unsigned)_mm_movemask_ps(cond(_mm_loadu_ps(x + l), _mm_loadu_ps(y + l),
+                                               _mm_loadu_ps(z + l), _mm_loadu_ps(r2 + l))) << l;
+      return hits;
+    }
+    unsigned overlap(const TV &mi, const TV &ma) const noexcept {
+      return lanes([&](__m128 px, __m128 py, __m128 pz, __m128) {
+        __m128 in = _mm_and_ps(_mm_cmpge_ps(px, _mm_set1_ps(mi[0])),
+                               _mm_cmple_ps(px, _mm_set1_ps(ma[0])));
+        in = _mm_and_ps(in, _mm_and_ps(_mm_cmpge_ps(py, _mm_set1_ps(mi[1])),
+                                       _mm_cmple_ps(py, _mm_set1_ps(ma[1]))));
+        return _mm_and_ps(in, _mm_and_ps(_mm_cmpge_ps(pz, _mm_set1_ps(mi[2])),
+                                         _mm_cmple_ps(pz, _mm_set1_ps(ma[2]))));
+      });
+    }
+    unsigned overlap_radius(const TV &mi, const TV &ma) const noexcept {
+      return lanes([&](__m128 px, __m128 py, __m128 pz, __m128 pr2) {
+        auto sqdist = [](__m128 p, float lo, float hi) {
+          __m128 d = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(lo), p),
+                                           _mm_sub_ps(p, _mm_set1_ps(hi))),
+                                _mm_setzero_ps());
+          return _mm_mul_ps(d, d);
+        };
+        __m128 d2 = _mm_add_ps(_mm_add_ps(sqdist(px, mi[0], ma[0]), sqdist(py, mi[1], ma[1])),
+                               sqdist(pz, mi[2], ma[2]));
+        return _mm_cmple_ps(d2, pr2);
+      });
+    }
+#else
+    unsigned overlap(const TV &mi, const TV &ma) const noexcept {
+      unsigned hits = 0;
+      for (int l = 0; l != packet_size; ++l)
+        hits |= (unsigned)((x[l] >= mi[0]) & (x[l] <= ma[0]) & (y[l] >= mi[1]) &
+                           (y[l] <= ma[1]) & (z[l] >= mi[2]) & (z[l] <= ma[2])) << l;
+      return hits;
+    }
+    unsigned overlap_radius(const TV &mi, const TV &ma) const noexcept {
+      unsigned hits = 0;
+      for (int l = 0; l != packet_size; ++l) {
+        float dx = std::max(std::max(mi[0] - x[l], x[l] - ma[0]), 0.f);
+        float dy = std::max(std::max(mi[1] - y[l], y[l] - ma[1]), 0.f);
+        float dz = std::max(std::max(mi[2] - z[l], z[l] - ma[2]), 0.f);
+        hits |= (unsigned)(dx * dx + dy * dy + dz * dz <= r2[l]) << l;
+      }
+      return hits;
+    }
+#endif
+  };
+
+  /// packet version of iter_neighbors, f(lane, eid)
+  template <class F> void iter_neighbors_packet(TV const *pos, int npos, F &&f) const {
+    const Packet pk(pos, nullptr, npos);
+    iter_packet(npos, [&pk](const TV &mi, const TV &ma) { return pk.overlap(mi, ma); }, f);
+  }
+
+  /// packet version of iter_neighbors_radius with one radius per lane, f(lane, eid)
+  template <class F>
+  void iter_neighbors_radius_packet(TV const *pos, const float *radius, int npos, F &&f) const {
+    const Packet pk(pos, radius, npos);
+    iter_packet(npos, [&pk](const TV &mi, const TV &ma) { return pk.overlap_radius(mi, ma); }, f);
+  }
+
+  /// indices of pos[0, n) sorted along the morton curve over the tree bounds,
+  /// so that consecutive queries are spatially coherent
+  std::vector<Ti> coherentOrder(TV const *pos, std::size_t n) const;
+
+  /// iter_neighbors for all of pos[0, n), packed into packets of nearby queries
+  /// and run in parallel; f(qid, eid) may be called concurrently for different
+  /// qid, for each qid the leaves come in the same order as from iter_neighbors
+  template <class F> void iter_neighbors_batch(TV const *pos, std::size_t n, F &&f) const {
+    const auto order = coherentOrder(pos, n);
+#if defined(_OPENMP)
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+    for (intptr_t base = 0; base < (intptr_t)n; base += packet_size) {
+      int npos = std::min<intptr_t>(packet_size, (intptr_t)n - base);
+      TV qs[packet_size];
+      for (int l = 0; l != npos; ++l)
+        qs[l] = pos[order[base + l]];
+      iter_neighbors_packet(qs, npos, [&](int l, Ti eid) { f(order[base + l], eid); });
+    }
+  }
 };
 
 } // namespace zeno
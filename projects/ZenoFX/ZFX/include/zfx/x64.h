@@ -3,6 +3,7 @@
 #include <memory>
 #include <cstring>
 #include <string>
+#include <vector>
 #include <map>
 
 namespace zfx::x64 {
@@ -13,19 +14,50 @@ struct Executable {
     float consts[1024];
     void **functable = nullptr;
 
-    static constexpr size_t SimdWidth = 4;
+    // lanes processed by each execute(), chosen at assemble time from the host ISA:
+    // 16 with AVX-512F, 8 with AVX, can be lowered by ZENO_ZFX_SIMD_WIDTH=4/8
+    static constexpr size_t MaxSimdWidth = 16;
+    size_t SimdWidth = 4;
+    size_t nlocals = 256;  // local slots used by the program
+
+    // set for programs compiled with global_localize off, which read and write
+    // the channels in place instead of through the locals of a context
+    bool blocked = false;
+    std::vector<bool> globals_stored;  // channels written by a blocked program
+
+    struct BlockArgs {
+        float *const *globals;
+        size_t nbatches;
+    };
 
     struct Context {
         Executable *exec;
-        float locals[SimdWidth * 256];
+        alignas(64) float locals[MaxSimdWidth * 256];
 
         void execute() {
             auto entry = (void(*)(void *, void *, void *))exec->mem;
             entry((void *)locals, (void *)exec->consts, (void *)exec->functable);
         }
 
+        // runs nbatches batches of a blocked program, batch b accessing the
+        // SimdWidth floats at globals[chid] + b * SimdWidth for each channel
+        void execute_block(float *const *globals, size_t nbatches) {
+            BlockArgs args{globals, nbatches};
+            auto entry = (void(*)(void *, void *, void *, void *))exec->mem;
+            entry((void *)locals, (void *)exec->consts, (void *)exec->functable, (void *)&args);
+        }
+
+        bool stores_channel(int chid) const {
+            return chid < exec->globals_stored.size() && exec->globals_stored[chid];
+        }
+
         float *channel(int chid) {
-            return locals + SimdWidth * chid;
+            return locals + exec->SimdWidth * chid;
+        }
+
+        // zero the locals and temporaries, as for a freshly made context
+        void reset() {
+            std::memset(locals, 0, exec->nlocals * exec->SimdWidth * sizeof(float));
         }
     };
 
@@ -34,7 +66,10 @@ struct Executable {
     }
 
     inline Context make_context() {
-        return {this};
+        Context ctx;
+        ctx.exec = this;
+        ctx.reset();
+        return ctx;
     }
 
     Executable() = default;
@@ -44,6 +79,8 @@ struct Executable {
     static std::unique_ptr<Executable> assemble
         ( std::string const &lines
         );
+
+    static size_t hostSimdWidth();
 };
 
 struct Assembler {
@@ -5,7 +5,11 @@
 #include <zfx/x64.h>
 #include <algorithm>
 #include <sstream>
+#include <cstdlib>
 #include <map>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace zfx::x64 {
 
@@ -15,6 +19,45 @@ namespace zfx::x64 {
     } \
 } while (0)
 
+static bool cpuHasAvx() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    return osxsave && avx && (_xgetbv(0) & 0x06) == 0x06;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx");
+#endif
+}
+
+static bool cpuHasAvx512f() {
+#if defined(_MSC_VER)
+    if (!cpuHasAvx())
+        return false;
+    int info[4];
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 16)) && (_xgetbv(0) & 0xe6) == 0xe6;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+#endif
+}
+
+size_t Executable::hostSimdWidth() {
+    static size_t width = [] {
+        size_t w = cpuHasAvx512f() ? 16 : cpuHasAvx() ? 8 : 4;
+        if (auto env = std::getenv("ZENO_ZFX_SIMD_WIDTH")) {
+            size_t limit = std::atoi(env);
+            while (w > 4 && w > limit)
+                w /= 2;
+        }
+        return w;
+    }();
+    return width;
+}
+
 struct ImplAssembler {
     int simdkind = simdtype::xmmps;
 
@@ -22,6 +65,12 @@ struct ImplAssembler {
     std::unique_ptr<Executable> exec = std::make_unique<Executable>();
     static inline std::unique_ptr<FuncTable> functable;
 
+    ImplAssembler() {
+        exec->SimdWidth = Executable::hostSimdWidth();
+        simdkind = exec->SimdWidth == 16 ? simdtype::zmmps
+            : exec->SimdWidth == 8 ? simdtype::ymmps : simdtype::xmmps;
+    }
+
     int nconsts = 0;
     int nlocals = 0;
     //int nglobals = 0;
@@ -39,6 +88,33 @@ struct ImplAssembler {
     }
 
     void parse(std::string const &lines) {
+        // programs accessing globals directly are run over a whole block of
+        // batches per call, see Executable::Context::execute_block
+        for (auto line: split_str(lines, '\n')) {
+            auto cmd = line.substr(0, line.find(' '));
+            if (cmd == "ldg" || cmd == "stg") {
+                exec->blocked = true;
+                break;
+            }
+        }
+
+        size_t loopbegin = 0, loopskip = 0;
+        if (exec->blocked) {
+            // rbx, r12, r14 are callee-saved, and so not touched by math function calls
+            builder->addPushReg(opreg::rbx);
+            builder->addPushReg(opreg::r12);
+            builder->addPushReg(opreg::r14);
+            builder->addAdjStackTop(-8);  // keep rsp 16-byte aligned for calls
+            builder->addRegularLoadOp(opreg::rbx,
+                {opreg::a4, memflag::reg_imm8, 0});
+            builder->addRegularLoadOp(opreg::r12,
+                {opreg::a4, memflag::reg_imm8, sizeof(void *)});
+            builder->addRegularArithOp(0x31, opreg::r14, opreg::r14);
+            builder->addRegularArithOp(0x85, opreg::r12, opreg::r12);
+            loopskip = builder->addCondJumpOp(jmpcode::je);
+            loopbegin = builder->res.size();
+        }
+
         for (auto line: split_str(lines, '\n')) {
             if (!line.size()) continue;
 
@@ -80,15 +156,15 @@ struct ImplAssembler {
                 builder->addAvxMemoryOp(simdkind, opcode::storeu,
                     dst, {opreg::a1, memflag::reg_imm8, offset});
 
-            /*} else if (cmd == "ldg") {
-                // rdx points to an array of pointers
+            } else if (cmd == "ldg") {
+                // rbx points to an array of channel pointers, r14 is the batch offset
                 ERROR_IF(linesep.size() < 2);
                 auto dst = from_string<int>(linesep[1]);
                 auto id = from_string<int>(linesep[2]);
-                nglobals = std::max(nglobals, id + 1);
                 int offset = id * sizeof(void *);
                 builder->addRegularLoadOp(opreg::rax,
-                    {opreg::rdx, memflag::reg_imm8, offset});
+                    {opreg::rbx, memflag::reg_imm8, offset});
+                builder->addRegularArithOp(0x01, opreg::rax, opreg::r14);
                 builder->addAvxMemoryOp(simdkind, opcode::loadu,
                     dst, opreg::rax);
 
@@ -96,12 +172,15 @@ struct ImplAssembler {
                 ERROR_IF(linesep.size() < 2);
                 auto dst = from_string<int>(linesep[1]);
                 auto id = from_string<int>(linesep[2]);
-                nglobals = std::max(nglobals, id + 1);
                 int offset = id * sizeof(void *);
                 builder->addRegularLoadOp(opreg::rax,
-                    {opreg::rdx, memflag::reg_imm8, offset});
+                    {opreg::rbx, memflag::reg_imm8, offset});
+                builder->addRegularArithOp(0x01, opreg::rax, opreg::r14);
                 builder->addAvxMemoryOp(simdkind, opcode::storeu,
-                    dst, opreg::rax);*/
+                    dst, opreg::rax);
+                if (exec->globals_stored.size() < id + 1)
+                    exec->globals_stored.resize(id + 1);
+                exec->globals_stored[id] = true;
 
             } else if (cmd == "add") {
                 ERROR_IF(linesep.size() < 3);
@@ -296,6 +375,8 @@ struct ImplAssembler {
                     builder->addRegularMoveOp(opreg::a1, opreg::rsp);
                     int id = it - FuncTable::funcnames.begin();
                     int offset = id * sizeof(void *);
+                    if (simdkind != simdtype::xmmps)
+                        builder->addAvxZeroUpperOp();
 #if defined(_WIN32)
                     builder->addAdjStackTop(-64);
 #endif
@@ -327,6 +408,8 @@ struct ImplAssembler {
                     builder->addRegularMoveOp(opreg::a1, opreg::rsp);
                     int id = it - FuncTable::funcnames.begin();
                     int offset = id * sizeof(void *);
+                    if (simdkind != simdtype::xmmps)
+                        builder->addAvxZeroUpperOp();
 #if defined(_WIN32)
                     builder->addAdjStackTop(-64);
 #endif
@@ -347,6 +430,19 @@ struct ImplAssembler {
             }
         }
 
+        if (exec->blocked) {
+            builder->addRegularAddImmOp(opreg::r14,
+                SIMDBuilder::sizeOfType(simdkind));
+            builder->addRegularDecOp(opreg::r12);
+            builder->setJumpTarget(builder->addCondJumpOp(jmpcode::jne), loopbegin);
+            builder->setJumpTarget(loopskip, builder->res.size());
+            builder->addAdjStackTop(8);
+            builder->addPopReg(opreg::r14);
+            builder->addPopReg(opreg::r12);
+            builder->addPopReg(opreg::rbx);
+        }
+        if (simdkind != simdtype::xmmps)
+            builder->addAvxZeroUpperOp();
         builder->addReturn();
         auto const &insts = builder->getResult();
 
@@ -365,8 +461,9 @@ struct ImplAssembler {
 #endif
 
         if (!functable)
-            functable = std::make_unique<FuncTable>();
+            functable = std::make_unique<FuncTable>(exec->SimdWidth);
         exec->functable = functable->funcptrs.data();
+        exec->nlocals = nlocals;
         exec->memsize = (insts.size() + 4095) / 4096 * 4096;
         exec->mem = (uint8_t *)exec_page_allocate(exec->memsize);
         for (int i = 0; i < insts.size(); i++) {
@@ -10,9 +10,12 @@
 
 namespace zfx::x64 {
 
-struct FuncTable {
-#define DEF_FN1(name) static void func_##name(float *a) { vcl::Vec4f x; x.load(a); x = vcl::name(x); x.store(a); }
-#define DEF_FN2(name) static void func_##name(float *a, float *b) { vcl::Vec4f x, y; x.load(a); y.load(b); x = vcl::name(x, y); x.store(a); }
+// Vec is one of vcl::Vec4f, vcl::Vec8f, vcl::Vec16f matching the SIMD width
+template <class Vec>
+struct FuncTableImpl {
+using IVec = decltype(vcl::roundi(Vec()));
+#define DEF_FN1(name) static void func_##name(float *a) { Vec x; x.load(a); x = vcl::name(x); x.store(a); }
+#define DEF_FN2(name) static void func_##name(float *a, float *b) { Vec x, y; x.load(a); y.load(b); x = vcl::name(x, y); x.store(a); }
 DEF_FN1(sin)
 DEF_FN1(cos)
 DEF_FN1(tan)
@@ -25,12 +28,14 @@ DEF_FN1(floor)
 DEF_FN1(ceil)
 DEF_FN2(atan2)
 DEF_FN2(pow)
-static void func_fb2i(float *a) { vcl::Vec4f x; x.load(a); x = vcl::fb2i(x); x.store(a); }
-static void func_ib2f(float *a) { vcl::Vec4f x; x.load(a); x = vcl::ib2f(x); x.store(a); }
-static void func_fmod(float *a, float *b) { vcl::Vec4f x, y; x.load(a); y.load(b); x = x - vcl::floor(x / y) * y; x.store(a); }
+static void func_fb2i(float *a) { Vec x; x.load(a); x = vcl::to_float(IVec(vcl::reinterpret_i(x))); x.store(a); }
+static void func_ib2f(float *a) { Vec x; x.load(a); x = vcl::reinterpret_f(vcl::roundi(x)); x.store(a); }
+static void func_fmod(float *a, float *b) { Vec x, y; x.load(a); y.load(b); x = x - vcl::floor(x / y) * y; x.store(a); }
 #undef DEF_FN1
 #undef DEF_FN2
+};
 
+struct FuncTable {
     static inline std::vector<std::string> funcnames = {
 #define DEF_FN1(name) #name,
 #define DEF_FN2(name) DEF_FN1(name)
@@ -55,10 +60,20 @@ DEF_FN2(fmod)
 
     std::vector<void *> funcptrs;
 
-    FuncTable() {
+    explicit FuncTable(size_t simdwidth) {
+        if (simdwidth == 16)
+            assign<vcl::Vec16f>();
+        else if (simdwidth == 8)
+            assign<vcl::Vec8f>();
+        else
+            assign<vcl::Vec4f>();
+    }
+
+    template <class Vec>
+    void assign() {
         // we have to assign funcptrs at runtime to prevent dll relocation
-        for (int i = 0; i < funcnames.size(); i++) {
-#define DEF_FN1(name) funcptrs.push_back((void *)func_##name);
+        {
+#define DEF_FN1(name) funcptrs.push_back((void *)FuncTableImpl<Vec>::func_##name);
 #define DEF_FN2(name) DEF_FN1(name)
 DEF_FN1(sin)
 DEF_FN1(cos)
@@ -103,10 +103,11 @@ namespace simdtype {
         ymmpd = 0x05,
         ymmss = 0x06,
         ymmsd = 0x07,
+        zmmps = 0x08,  // EVEX encoded, requires AVX-512F
     };
 };
 
-struct SIMDBuilder {   // requires AVX2
+struct SIMDBuilder {   // requires AVX, zmmps requires AVX-512F
     std::vector<uint8_t> res;
 
     struct MemoryAddress {
@@ -156,6 +157,18 @@ struct SIMDBuilder {   // requires AVX2
                 res.push_back(immadr >> 24 & 0xff);
             }
         }
+
+        // EVEX scales 8-bit displacements by the operand size, always use 32-bit ones
+        void dumpDisp32(std::vector<uint8_t> &res, int val) {
+            auto adreg = adr & 0x07;
+            res.push_back(0x80 | val << 3 & 0x38 | adreg);
+            if (adreg == opreg::rsp)
+                res.push_back(0x24);
+            res.push_back(immadr & 0xff);
+            res.push_back(immadr >> 8 & 0xff);
+            res.push_back(immadr >> 16 & 0xff);
+            res.push_back(immadr >> 24 & 0xff);
+        }
     };
 
     static constexpr size_t scalarSizeOfType(int type) {
@@ -166,6 +179,7 @@ struct SIMDBuilder {   // requires AVX2
         case simdtype::xmmsd: return sizeof(double);
         case simdtype::ymmps: return sizeof(float);
         case simdtype::ymmpd: return sizeof(double);
+        case simdtype::zmmps: return sizeof(float);
         default: return 0;
         }
     }
@@ -178,11 +192,67 @@ struct SIMDBuilder {   // requires AVX2
         case simdtype::xmmsd: return 1 * sizeof(double);
         case simdtype::ymmps: return 8 * sizeof(float);
         case simdtype::ymmpd: return 4 * sizeof(double);
+        case simdtype::zmmps: return 16 * sizeof(float);
         default: return 0;
         }
     }
 
+    // EVEX prefix for 512-bit ops, only zmm0-15 and k0-7 are used
+    // map: 1 = 0F, 2 = 0F38, 3 = 0F3A; pp: 0 = none, 1 = 66
+    void addEvexPrefix(int map, int pp, int reg, int vvvv, int rm,
+                       int kmask = 0, bool zeroing = false) {
+        res.push_back(0x62);
+        res.push_back(0x50 | (~reg >> 3 & 1) << 7 | (~rm >> 3 & 1) << 5 | map);
+        res.push_back(0x04 | ~vvvv << 3 & 0x78 | pp);
+        res.push_back((int)zeroing << 7 | 0x48 | kmask);
+    }
+
+    void addEvexRegOp(int map, int pp, int op, int reg, int vvvv, int rm,
+                      int kmask = 0, bool zeroing = false) {
+        addEvexPrefix(map, pp, reg, vvvv, rm, kmask, zeroing);
+        res.push_back(op);
+        res.push_back(0xc0 | reg << 3 & 0x38 | rm & 0x07);
+    }
+
+    void addEvexMemoryOp(int map, int pp, int op, int val, MemoryAddress adr) {
+        addEvexPrefix(map, pp, val, opreg::mm0, adr.adr);
+        res.push_back(op);
+        adr.dumpDisp32(res, val);
+    }
+
+    void addEvexBinaryOp(int op, int dst, int lhs, int rhs) {
+        // vandps and friends need AVX-512DQ, use their integer versions
+        switch (op & 0xff) {
+        case opcode::bit_and:
+            addEvexRegOp(1, 1, 0xdb, dst, lhs, rhs);  // vpandd
+            break;
+        case opcode::bit_andn:
+            addEvexRegOp(1, 1, 0xdf, dst, lhs, rhs);  // vpandnd
+            break;
+        case opcode::bit_or:
+            addEvexRegOp(1, 1, 0xeb, dst, lhs, rhs);  // vpord
+            break;
+        case opcode::bit_xor:
+            addEvexRegOp(1, 1, 0xef, dst, lhs, rhs);  // vpxord
+            break;
+        case opcode::cmp_eq:
+            // compare into k1, then expand k1 into an all-ones lane mask
+            addEvexRegOp(1, 0, opcode::cmp_eq, 1, lhs, rhs);
+            res.push_back(op >> 8);
+            addEvexRegOp(3, 1, 0x25, dst, dst, dst, 1, true);  // vpternlogd
+            res.push_back(0xff);
+            break;
+        default:
+            addEvexRegOp(1, 0, op, dst, lhs, rhs);
+            break;
+        }
+    }
+
     void addAvxBroadcastLoadOp(int type, int val, MemoryAddress adr) {
+        if (type == simdtype::zmmps) {
+            addEvexMemoryOp(2, 1, 0x18, val, adr);
+            return;
+        }
         res.push_back(0xc4);
         res.push_back(0x62 | ~val >> 3 << 7);
         res.push_back(0x79 | type & 0x04);
@@ -200,6 +270,10 @@ struct SIMDBuilder {   // requires AVX2
     }
 
     void addAvxMemoryOp(int type, int op, int val, MemoryAddress adr) {
+        if (type == simdtype::zmmps) {
+            addEvexMemoryOp(1, 0, op, val, adr);
+            return;
+        }
         res.push_back(0xc5);
         res.push_back(type | 0x78 | ~val >> 3 << 7);
         res.push_back(op);
@@ -207,17 +281,58 @@ struct SIMDBuilder {   // requires AVX2
     }
 
     void addRegularLoadOp(int val, MemoryAddress adr) {
-        res.push_back(0x48 | val >> 3);
+        res.push_back(0x48 | val >> 1 & 0x04 | adr.adr >> 3);
         res.push_back(0x8b);
         adr.dump(res, val);
     }
 
     void addRegularStoreOp(int val, MemoryAddress adr) {
-        res.push_back(0x48 | val >> 3);
+        res.push_back(0x48 | val >> 1 & 0x04 | adr.adr >> 3);
         res.push_back(0x89);
         adr.dump(res, val);
     }
 
+    // op: 0x01 = add, 0x29 = sub, 0x31 = xor, 0x85 = test
+    void addRegularArithOp(int op, int dst, int src) {
+        res.push_back(0x48 | dst >> 3 | src >> 1 & 0x04);
+        res.push_back(op);
+        res.push_back(0xc0 | dst & 0x07 | src << 3 & 0x38);
+    }
+
+    void addRegularAddImmOp(int dst, int imm) {
+        res.push_back(0x48 | dst >> 3);
+        res.push_back(0x81);
+        res.push_back(0xc0 | dst & 0x07);
+        res.push_back(imm & 0xff);
+        res.push_back(imm >> 8 & 0xff);
+        res.push_back(imm >> 16 & 0xff);
+        res.push_back(imm >> 24 & 0xff);
+    }
+
+    void addRegularDecOp(int dst) {
+        res.push_back(0x48 | dst >> 3);
+        res.push_back(0xff);
+        res.push_back(0xc8 | dst & 0x07);
+    }
+
+    // emits a conditional jump with 32-bit displacement, returns the position
+    // of the displacement for patching with setJumpTarget
+    size_t addCondJumpOp(int cond) {
+        res.push_back(0x0f);
+        res.push_back(0x80 | cond);
+        size_t pos = res.size();
+        res.resize(pos + 4);
+        return pos;
+    }
+
+    void setJumpTarget(size_t pos, size_t target) {
+        int off = (int)target - (int)(pos + 4);
+        res[pos] = off & 0xff;
+        res[pos + 1] = off >> 8 & 0xff;
+        res[pos + 2] = off >> 16 & 0xff;
+        res[pos + 3] = off >> 24 & 0xff;
+    }
+
     void addRegularMoveOp(int dst, int src) {
         res.push_back(0x48 | dst >> 3 | src >> 1 & 0x04);
         res.push_back(0x89);
@@ -226,9 +341,18 @@ struct SIMDBuilder {   // requires AVX2
 
     void addAdjStackTop(int imm_add) {
         res.push_back(0x48);
-        res.push_back(0x83);
-        res.push_back(0xc4);
-        res.push_back(imm_add);
+        if (-128 <= imm_add && imm_add <= 127) {
+            res.push_back(0x83);
+            res.push_back(0xc4);
+            res.push_back(imm_add & 0xff);
+        } else {
+            res.push_back(0x81);
+            res.push_back(0xc4);
+            res.push_back(imm_add & 0xff);
+            res.push_back(imm_add >> 8 & 0xff);
+            res.push_back(imm_add >> 16 & 0xff);
+            res.push_back(imm_add >> 24 & 0xff);
+        }
     }
 
     void addCallOp(MemoryAddress adr) {
@@ -239,6 +363,10 @@ struct SIMDBuilder {   // requires AVX2
     }
 
     void addAvxBinaryOp(int type, int op, int dst, int lhs, int rhs) {
+        if (type == simdtype::zmmps) {
+            addEvexBinaryOp(op, dst, lhs, rhs);
+            return;
+        }
         if (rhs >= 8) {
             res.push_back(0xc4);
             res.push_back(0x41 | ~dst >> 3 << 7);
@@ -259,6 +387,11 @@ struct SIMDBuilder {   // requires AVX2
     }
 
     void addAvxBlendvOp(int type, int dst, int lhs, int rhs, int mask) {
+        if (type == simdtype::zmmps) {
+            addEvexRegOp(2, 1, 0x27, 1, mask, mask);  // vptestmd k1
+            addEvexRegOp(2, 1, 0x65, dst, lhs, rhs, 1);  // vblendmps
+            return;
+        }
         res.push_back(0xc4);
         res.push_back(0x43 | ~dst >> 3 << 7 | (~rhs >> 3 & 1) << 5);
         res.push_back(0x01 | type & 0x04 | ~lhs << 3 & 0x78);
@@ -268,7 +401,15 @@ struct SIMDBuilder {   // requires AVX2
     }
 
     void addAvxMoveOp(int type, int dst, int src) {
-        addAvxBinaryOp(opcode::loadu, opcode::mov, dst, opreg::mm0, src);
+        addAvxBinaryOp(type, opcode::mov, dst, opreg::mm0, src);
+    }
+
+    // avoids AVX-SSE transition penalties when calling into or returning to
+    // code that wasn't compiled for AVX
+    void addAvxZeroUpperOp() {
+        res.push_back(0xc5);
+        res.push_back(0xf8);
+        res.push_back(0x77);
     }
 
     void addJumpOp(int off) {
@@ -5,6 +5,7 @@
 #include <zeno/types/DictObject.h>
 #include <zeno/extra/GlobalState.h>
 #include <zeno/core/Graph.h>
+#include <zeno/utils/parallel_reduce.h>
 #include <zfx/zfx.h>
 #include <zfx/x64.h>
 #include <cassert>
@@ -37,23 +38,42 @@ struct HashGrid : zeno::IObject {
     float radius_sqr_min;
     std::vector<zeno::vec3f> const &refpos;
 
-    std::vector<std::vector<int>> table;
+    // cells are stored in CSR layout: the particles of cell c are cellParticles[k]
+    // for k in [cellStart[c], cellStart[c + 1]), in ascending order
+    //
+    // in dense mode c is the linear index of the cell in the gridRes box around
+    // refpos; when that box is large and mostly empty (sparse mode) c is a slot
+    // of an open-addressing table instead, holding the linear index in cellKeys
+    zeno::vec3f pMin;
+    zeno::vec3i gridRes;
+    bool sparse = false;
+    std::vector<int> cellStart;
+    std::vector<int> cellParticles;
+    std::vector<int64_t> cellKeys;
 
-//#define DILEI
-#define XUBEN
+    zeno::vec3i cellCoord(zeno::vec3f const &pos) const {
+        return zeno::toint(zeno::floor((pos - pMin) * inv_dx));
+    }
 
-    int hash(int x, int y, int z) {
-#ifdef XUBEN
-        return (x%gridRes[0]+gridRes[0])%gridRes[0] + ((y%gridRes[1]+gridRes[1])%gridRes[1]) * gridRes[0] + ((z%gridRes[2]+gridRes[2])%gridRes[2]) * gridRes[0] * gridRes[1];
-#else
-        return ((73856093 * x) ^ (19349663 * y) ^ (83492791 * z)) % table.size();
-#endif
+    int64_t cellIndex(int x, int y, int z) const {
+        return x + gridRes[0] * ((int64_t)y + (int64_t)gridRes[1] * z);
     }
 
-#ifdef XUBEN
-    zeno::vec3f pMin, pMax;
-    zeno::vec3i gridRes;
-#endif
+    static size_t hashSlot(int64_t key, size_t mask) {
+        uint64_t h = (uint64_t)key * 0x9e3779b97f4a7c15ull;
+        return (h ^ h >> 29) & mask;
+    }
+
+    // slot of the cell in sparse mode, -1 if the cell is empty
+    intptr_t findSlot(int64_t key) const {
+        size_t mask = cellKeys.size() - 1;
+        for (size_t s = hashSlot(key, mask);; s = (s + 1) & mask) {
+            if (cellKeys[s] == key)
+                return s;
+            if (cellKeys[s] == -1)
+                return -1;
+        }
+    }
 
     HashGrid(std::vector<zeno::vec3f> const &refpos_,
             float radius_, float radius_min)
@@ -62,76 +82,122 @@ struct HashGrid : zeno::IObject {
         radius = radius_;
         radius_sqr = radius * radius;
         radius_sqr_min = radius_min < 0.f ? -1.f : radius_min * radius_min;
-#ifdef DILEI
-        inv_dx = 0.5f / radius;
-#else
         inv_dx = 1.0f / radius;
-#endif
 
-#ifdef XUBEN
-        pMin = refpos[0];
-        pMax = refpos[0];
-        for (int i = 1; i < refpos.size(); i++) {
-            auto coor = refpos[i];
-            pMin = zeno::min(pMin, coor);
-            pMax = zeno::max(pMax, coor);
+        size_t n = refpos.size();
+        if (!n) {
+            pMin = zeno::vec3f(0);
+            gridRes = zeno::vec3i(0);
+            cellStart.assign(1, 0);
+            return;
         }
+        pMin = parallel_reduce_array<zeno::vec3f>(n, refpos[0], [&] (size_t i) {
+            return refpos[i];
+        }, [] (zeno::vec3f a, zeno::vec3f b) { return zeno::min(a, b); });
+        auto pMax = parallel_reduce_array<zeno::vec3f>(n, refpos[0], [&] (size_t i) {
+            return refpos[i];
+        }, [] (zeno::vec3f a, zeno::vec3f b) { return zeno::max(a, b); });
         pMin -= radius;
         pMax += radius;
         gridRes = zeno::toint(zeno::floor((pMax - pMin) * inv_dx)) + 1;
+        int64_t ncells = (int64_t)gridRes[0] * gridRes[1] * gridRes[2];
+        sparse = ncells > 4 * (int64_t)n + 4096;
+        dbg_printf("grid res: %dx%dx%d%s\n", gridRes[0], gridRes[1], gridRes[2],
+                sparse ? " (sparse)" : "");
 
-        dbg_printf("grid res: %dx%dx%d\n", gridRes[0], gridRes[1], gridRes[2]);
-        table.clear();
-        table.resize(gridRes[0] * gridRes[1] * gridRes[2]);
-#else
-        int table_size = refpos.size() / 8;
-        dbg_printf("table size: %d\n", table_size);
-        table.clear();
-        table.resize(table_size);
-#endif
+        std::vector<int> keys(n);
+        size_t nslots;
+        if (!sparse) {
+            nslots = ncells;
+            #pragma omp parallel for
+            for (intptr_t i = 0; i < n; i++) {
+                auto coor = cellCoord(refpos[i]);
+                keys[i] = cellIndex(coor[0], coor[1], coor[2]);
+            }
+        } else {
+            nslots = 1;
+            while (nslots < 2 * n)
+                nslots <<= 1;
+            std::vector<std::atomic<int64_t>> table(nslots);
+            #pragma omp parallel for
+            for (intptr_t s = 0; s < nslots; s++) {
+                table[s].store(-1, std::memory_order_relaxed);
+            }
+            #pragma omp parallel for
+            for (intptr_t i = 0; i < n; i++) {
+                auto coor = cellCoord(refpos[i]);
+                int64_t key = cellIndex(coor[0], coor[1], coor[2]);
+                for (size_t s = hashSlot(key, nslots - 1);; s = (s + 1) & (nslots - 1)) {
+                    int64_t expected = -1;
+                    if (table[s].compare_exchange_strong(expected, key) || expected == key) {
+                        keys[i] = s;
+                        break;
+                    }
+                }
+            }
+            cellKeys.resize(nslots);
+            #pragma omp parallel for
+            for (intptr_t s = 0; s < nslots; s++) {
+                cellKeys[s] = table[s].load(std::memory_order_relaxed);
+            }
+        }
 
-        for (int i = 0; i < refpos.size(); i++) {
-#ifdef XUBEN
-            auto coor = zeno::toint(zeno::floor((refpos[i] - pMin) * inv_dx));
-#else
-            auto coor = zeno::toint(zeno::floor(refpos[i] * inv_dx));
-#endif
-            auto key = hash(coor[0], coor[1], coor[2]);
-            table[key].push_back(i);
+        // counting sort of the particles by cell
+        std::vector<std::atomic<int>> counts(nslots);
+        #pragma omp parallel for
+        for (intptr_t i = 0; i < n; i++) {
+            counts[keys[i]].fetch_add(1, std::memory_order_relaxed);
+        }
+        cellStart.resize(nslots + 1);
+        cellStart[0] = 0;
+        for (size_t c = 0; c < nslots; c++) {
+            cellStart[c + 1] = cellStart[c] + counts[c].load(std::memory_order_relaxed);
+            counts[c].store(0, std::memory_order_relaxed);
+        }
+        cellParticles.resize(n);
+        #pragma omp parallel for
+        for (intptr_t i = 0; i < n; i++) {
+            int c = keys[i];
+            cellParticles[cellStart[c] + counts[c].fetch_add(1, std::memory_order_relaxed)] = i;
+        }
+        // restore ascending order within cells, to keep neighbor order deterministic
+        #pragma omp parallel for schedule(dynamic, 4096)
+        for (intptr_t c = 0; c < nslots; c++) {
+            if (cellStart[c + 1] - cellStart[c] > 1)
+                std::sort(cellParticles.begin() + cellStart[c],
+                          cellParticles.begin() + cellStart[c + 1]);
         }
     }
 
     template <class F>
-    void iter_neighbors(zeno::vec3f const &pos, F const &f) {
-#ifdef XUBEN
-#ifdef DILEI
-        auto coor = zeno::toint(zeno::floor((pos - pMin) * inv_dx - 0.5f));
-#else
-        auto coor = zeno::toint(zeno::floor((pos - pMin) * inv_dx));
-#endif
-#else
-#ifdef DILEI
-        auto coor = zeno::toint(zeno::floor(pos * inv_dx - 0.5f));
-#else
-        auto coor = zeno::toint(zeno::floor(pos * inv_dx));
-#endif
-#endif
-#ifdef DILEI
-        for (int dz = 0; dz < 2; dz++) {
-            for (int dy = 0; dy < 2; dy++) {
-                for (int dx = 0; dx < 2; dx++) {
-#else
+    void iter_neighbors(zeno::vec3f const &pos, F const &f) const {
+        auto coor = cellCoord(pos);
         for (int dz = -1; dz < 2; dz++) {
+            int z = coor[2] + dz;
+            if (z < 0 || z >= gridRes[2])
+                continue;
             for (int dy = -1; dy < 2; dy++) {
-                for (int dx = -1; dx < 2; dx++) {
-#endif
-                    int key = hash(coor[0] + dx, coor[1] + dy, coor[2] + dz);
-                    for (int pid: table[key]) {
-                        //auto dist = refpos[pid] - pos;
-                        //auto dis2 = zeno::dot(dist, dist);
-                        //if (dis2 <= radius_sqr && dis2 > radius_sqr_min) {
-                            f(pid);
-                        //}
+                int y = coor[1] + dy;
+                if (y < 0 || y >= gridRes[1])
+                    continue;
+                int x0 = std::max(coor[0] - 1, 0);
+                int x1 = std::min(coor[0] + 1, gridRes[0] - 1);
+                if (x0 > x1)
+                    continue;
+                if (!sparse) {
+                    // cells adjacent along x are adjacent in the CSR layout too
+                    int kend = cellStart[cellIndex(x1, y, z) + 1];
+                    for (int k = cellStart[cellIndex(x0, y, z)]; k < kend; k++) {
+                        f(cellParticles[k]);
+                    }
+                } else {
+                    for (int x = x0; x <= x1; x++) {
+                        auto s = findSlot(cellIndex(x, y, z));
+                        if (s < 0)
+                            continue;
+                        for (int k = cellStart[s]; k < cellStart[s + 1]; k++) {
+                            f(cellParticles[k]);
+                        }
                     }
                 }
             }
@@ -145,27 +211,89 @@ static void vectors_wrangle
     , std::vector<Buffer> const &chs2
     , std::vector<zeno::vec3f> const &pos
     , HashGrid *hashgrid
+    , bool radiusFilter
     ) {
     if (chs.size() == 0)
         return;
 
-    #pragma omp parallel for
-    for (int i = 0; i < pos.size(); i++) {
+    // each SIMD lane takes one particle, and all lanes step through their own
+    // neighbor lists together, so every particle still sees its neighbors in
+    // order; a lane that ran out of neighbors is saved right after its last
+    // step and whatever it computes afterwards is discarded; the context is
+    // reset for each batch, so that locals and temporaries start from zero
+    // and only carry over between the neighbors of the same particles
+    size_t width = exec->SimdWidth;
+    size_t nbatches = (pos.size() + width - 1) / width;
+
+    #pragma omp parallel
+    {
         auto ctx = exec->make_context();
-        for (int k = 0; k < chs.size(); k++) {
-            if (!chs[k].which)
-                ctx.channel(k)[0] = chs[k].base[chs[k].stride * i];
-        }
-        hashgrid->iter_neighbors(pos[i], [&] (int pid) {
-            for (int k = 0; k < chs.size(); k++) {
-                if (chs[k].which)
-                    ctx.channel(k)[0] = chs2[k].base[chs2[k].stride * pid];
+        std::vector<std::vector<int>> neighbors(width);
+        std::vector<float> results(chs.size() * width);
+
+        #pragma omp for schedule(dynamic, 16)
+        for (intptr_t b = 0; b < nbatches; b++) {
+            size_t i0 = b * width;
+            size_t n = std::min(pos.size() - i0, width);
+            size_t maxcount = 0;
+            for (size_t k = 0; k < width; k++) {
+                auto &nbs = neighbors[k];
+                nbs.clear();
+                if (k >= n)
+                    continue;
+                auto const &p = pos[i0 + k];
+                hashgrid->iter_neighbors(p, [&] (int pid) {
+                    if (radiusFilter) {
+                        auto dist = hashgrid->refpos[pid] - p;
+                        auto dis2 = zeno::dot(dist, dist);
+                        if (!(dis2 <= hashgrid->radius_sqr && dis2 > hashgrid->radius_sqr_min))
+                            return;
+                    }
+                    nbs.push_back(pid);
+                });
+                maxcount = std::max(maxcount, nbs.size());
+            }
+            if (!maxcount)
+                continue;
+
+            ctx.reset();
+            for (int c = 0; c < chs.size(); c++) {
+                if (chs[c].which)
+                    continue;
+                for (size_t k = 0; k < width; k++)
+                    ctx.channel(c)[k] = chs[c].base[chs[c].stride * (i0 + (k < n ? k : 0))];
+            }
+            for (size_t t = 0; t < maxcount; t++) {
+                int fill = -1;  // idle lanes read any valid neighbor of this step
+                for (size_t k = 0; k < n && fill < 0; k++) {
+                    if (t < neighbors[k].size())
+                        fill = neighbors[k][t];
+                }
+                for (int c = 0; c < chs.size(); c++) {
+                    if (!chs[c].which)
+                        continue;
+                    for (size_t k = 0; k < width; k++) {
+                        int pid = t < neighbors[k].size() ? neighbors[k][t] : fill;
+                        ctx.channel(c)[k] = chs2[c].base[chs2[c].stride * pid];
+                    }
+                }
+                ctx.execute();
+                for (size_t k = 0; k < n; k++) {
+                    if (neighbors[k].size() != t + 1)
+                        continue;
+                    for (int c = 0; c < chs.size(); c++) {
+                        results[c * width + k] = ctx.channel(c)[k];
+                    }
+                }
+            }
+            for (int c = 0; c < chs.size(); c++) {
+                if (chs[c].which)
+                    continue;
+                for (size_t k = 0; k < n; k++) {
+                    if (!neighbors[k].empty())
+                        chs[c].base[chs[c].stride * (i0 + k)] = results[c * width + k];
+                }
             }
-            ctx.execute();
-        });
-        for (int k = 0; k < chs.size(); k++) {
-            if (!chs[k].which)
-                chs[k].base[chs[k].stride * i] = ctx.channel(k)[0];
         }
     }
 }
@@ -359,7 +487,7 @@ struct ParticlesNeighborWrangle : zeno::INode {
                 primPtr = prim.get();
                 iob.which = 0;
             }
-            prim->attr_visit(name, [&, dimid_ = dimid] (auto const &arr) {
+            primPtr->attr_visit(name, [&, dimid_ = dimid] (auto const &arr) {
                 iob.base = (float *)arr.data() + dimid_;
                 iob.count = arr.size();
                 iob.stride = sizeof(arr[0]) / sizeof(float);
@@ -382,7 +510,7 @@ struct ParticlesNeighborWrangle : zeno::INode {
                 primPtr = prim.get();
                 iob.which = 0;
             }
-            primNei->attr_visit(name, [&, dimid_ = dimid] (auto const &arr) {
+            primPtr->attr_visit(name, [&, dimid_ = dimid] (auto const &arr) {
                 iob.base = (float *)arr.data() + dimid_;
                 iob.count = arr.size();
                 iob.stride = sizeof(arr[0]) / sizeof(float);
@@ -390,8 +518,9 @@ struct ParticlesNeighborWrangle : zeno::INode {
             chs2[i] = iob;
         }
 
+        bool radiusFilter = get_input2<bool>("radiusFilter");
         vectors_wrangle(exec, chs, chs2, prim->attr<zeno::vec3f>("pos"),
-                hashgrid.get());
+                hashgrid.get(), radiusFilter);
 
         set_output("prim", std::move(prim));
     }
@@ -399,7 +528,8 @@ struct ParticlesNeighborWrangle : zeno::INode {
 
 ZENDEFNODE(ParticlesNeighborWrangle, {
     {{"PrimitiveObject", "prim"}, {"PrimitiveObject", "primNei"}, {"HashGrid", "hashGrid"},
-     {"string", "zfxCode"}, {"DictObject:NumericObject", "params"}},
+     {"string", "zfxCode"}, {"DictObject:NumericObject", "params"},
+     {"bool", "radiusFilter", "0"}},
     {{"PrimitiveObject", "prim"}},
     {},
     {"zenofx"},
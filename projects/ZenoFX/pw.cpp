@@ -35,27 +35,46 @@ static void vectors_wrangle
         size = std::min(chs[i].count, size);
     }
 
-    #pragma omp parallel for
-    for (int i = 0; i < size - exec->SimdWidth + 1; i += exec->SimdWidth) {
-        auto ctx = exec->make_context();
-        for (int j = 0; j < chs.size(); j++) {
-            for (int k = 0; k < exec->SimdWidth; k++)
-                ctx.channel(j)[k] = chs[j].base[chs[j].stride * (i + k)];
-        }
-        ctx.execute();
-        for (int j = 0; j < chs.size(); j++) {
-            for (int k = 0; k < exec->SimdWidth; k++)
-                 chs[j].base[chs[j].stride * (i + k)] = ctx.channel(j)[k];
-        }
-    }
-    for (int i = size / exec->SimdWidth * exec->SimdWidth; i < size; i++) {
+    // the kernel runs over a whole block per call, reading and writing float
+    // channels in place; strided channels (vec3f components) and the last
+    // partial block go through a per-thread SoA scratch, padded with lane 0
+    constexpr size_t kBlockSize = 1024;
+    size_t width = exec->SimdWidth;
+    size_t nblocks = (size + kBlockSize - 1) / kBlockSize;
+
+    #pragma omp parallel
+    {
         auto ctx = exec->make_context();
-        for (int j = 0; j < chs.size(); j++) {
-            ctx.channel(j)[0] = chs[j].base[chs[j].stride * i];
-        }
-        ctx.execute();
-        for (int j = 0; j < chs.size(); j++) {
-            chs[j].base[chs[j].stride * i] = ctx.channel(j)[0];
+        std::vector<float> scratch(chs.size() * kBlockSize);
+        std::vector<float *> ptrs(chs.size());
+
+        #pragma omp for
+        for (intptr_t b = 0; b < nblocks; b++) {
+            size_t i = b * kBlockSize;
+            size_t n = std::min(size - i, kBlockSize);
+            size_t nbatches = (n + width - 1) / width;
+            for (int j = 0; j < chs.size(); j++) {
+                auto const &ch = chs[j];
+                if (ch.stride == 1 && n % width == 0) {
+                    ptrs[j] = ch.base + i;
+                    continue;
+                }
+                float *buf = scratch.data() + j * kBlockSize;
+                for (size_t k = 0; k < n; k++)
+                    buf[k] = ch.base[ch.stride * (i + k)];
+                for (size_t k = n; k < nbatches * width; k++)
+                    buf[k] = buf[0];
+                ptrs[j] = buf;
+            }
+            ctx.execute_block(ptrs.data(), nbatches);
+            for (int j = 0; j < chs.size(); j++) {
+                auto const &ch = chs[j];
+                if (ptrs[j] == ch.base + i || !ctx.stores_channel(j))
+                    continue;
+                float const *buf = ptrs[j];
+                for (size_t k = 0; k < n; k++)
+                    ch.base[ch.stride * (i + k)] = buf[k];
+            }
         }
     }
 }
@@ -74,6 +93,7 @@ struct ParticlesWrangle : zeno::INode {
 
         zfx::Options opts(zfx::Options::for_x64);
         opts.detect_new_symbols = true;
+        opts.global_localize = false;  // access channels in place, see vectors_wrangle
         prim->foreach_attr([&] (auto const &key, auto const &attr) {
             int dim = ([] (auto const &v) {
                 using T = std::decay_t<decltype(v[0])>;
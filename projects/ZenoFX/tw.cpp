@@ -36,29 +36,21 @@ static void vectors_wrangle
         size = std::min(chs[i].count, size);
     }
 
+    // the last batch is padded with copies of its first lane, acting as a masked tail
     #pragma omp parallel for
-    for (int i = 0; i < size - exec->SimdWidth + 1; i += exec->SimdWidth) {
+    for (size_t i = 0; i < size; i += exec->SimdWidth) {
+        size_t n = std::min(size - i, exec->SimdWidth);
         auto ctx = exec->make_context();
         for (int j = 0; j < chs.size(); j++) {
             for (int k = 0; k < exec->SimdWidth; k++)
-                ctx.channel(j)[k] = chs[j].base[chs[j].stride * (i + k)];
+                ctx.channel(j)[k] = chs[j].base[chs[j].stride * (k < n ? i + k : i)];
         }
         ctx.execute();
         for (int j = 0; j < chs.size(); j++) {
-            for (int k = 0; k < exec->SimdWidth; k++)
+            for (int k = 0; k < n; k++)
                  chs[j].base[chs[j].stride * (i + k)] = ctx.channel(j)[k];
         }
     }
-    for (int i = size / exec->SimdWidth * exec->SimdWidth; i < size; i++) {
-        auto ctx = exec->make_context();
-        for (int j = 0; j < chs.size(); j++) {
-            ctx.channel(j)[0] = chs[j].base[chs[j].stride * i];
-        }
-        ctx.execute();
-        for (int j = 0; j < chs.size(); j++) {
-            chs[j].base[chs[j].stride * i] = ctx.channel(j)[0];
-        }
-    }
 }
 
 struct TrianglesWrangle : zeno::INode {
@@ -13,8 +13,21 @@
 #include <zeno/extra/EventCallbacks.h>
 #include <zeno/extra/assetDir.h>
 #include <zeno/funcs/ObjectCodec.h>
+#include <zeno/utils/SharedMemory.h>
+#include <zeno/utils/FrameHeap.h>
+#include <zeno/utils/envconfig.h>
 #include <zeno/zeno.h>
 #include <string>
+#include <mutex>
+#include <algorithm>
+#include <future>
+#include <cerrno>
+#ifndef _WIN32
+#include <sys/uio.h>
+#include <limits.h>
+#include <unistd.h>
+#endif
+#include <vector>
 #ifdef ZENO_IPC_USE_TCP
 #include <QTcpServer>
 #include <QtWidgets>
@@ -47,7 +60,35 @@ struct Header { // sync with viewdecode.cpp
     }
 };
 
+#if !defined(ZENO_IPC_USE_TCP) && !defined(_WIN32)
+// scatter/gather write of all the given buffers, resuming after partial writes
+static bool write_all(int fd, struct iovec *iov, int iovcnt) {
+    while (iovcnt > 0) {
+        ssize_t n = ::writev(fd, iov, std::min(iovcnt, IOV_MAX));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+#endif
+
+// packets may also be sent from the cache writer thread, see runner_start
+static std::mutex sendMtx;
+
 static void send_packet(std::string_view info, const char *buf, size_t len) {
+    std::lock_guard lck(sendMtx);
     Header header;
     header.total_size = info.size() + len;
     header.info_size = info.size();
@@ -63,21 +104,36 @@ static void send_packet(std::string_view info, const char *buf, size_t len) {
 
     zeno::log_debug("runner tx head-buffer {} data-buffer {}", headbuffer.size(), len);
 #ifdef ZENO_IPC_USE_TCP
-    for (char c: headbuffer) {
-        clientSocket->write(&c, 1);
+    // the socket copies everything written into its own buffer, so big payloads are
+    // fed in chunks to keep that copy bounded
+    constexpr size_t kChunkSize = 4 << 20;
+    clientSocket->write(headbuffer.data(), headbuffer.size());
+    for (size_t off = 0; off < len; off += kChunkSize) {
+        clientSocket->write(buf + off, std::min(kChunkSize, len - off));
+        while (clientSocket->bytesToWrite() > kChunkSize) {
+            clientSocket->waitForBytesWritten();
+        }
     }
-    clientSocket->write(buf, len);
     while (clientSocket->bytesToWrite() > 0) {
         clientSocket->waitForBytesWritten();
     }
 #else
-    for (char c : headbuffer) {
-        fputc(c, ourfp);
-    }
-    for (size_t i = 0; i < len; i++) {
-        fputc(buf[i], ourfp);
-    }
+#ifndef _WIN32
+    // logs share the same stream, flush them before bypassing the stdio buffer
     fflush(ourfp);
+    struct iovec iov[2];
+    iov[0].iov_base = headbuffer.data();
+    iov[0].iov_len = headbuffer.size();
+    iov[1].iov_base = const_cast<char *>(buf);
+    iov[1].iov_len = len;
+    if (!write_all(fileno(ourfp), iov, len ? 2 : 1))
+        zeno::log_error("runner failed to send packet: {}", std::strerror(errno));
+#else
+    fwrite(headbuffer.data(), 1, headbuffer.size(), ourfp);
+    if (len)
+        fwrite(buf, 1, len, ourfp);
+    fflush(ourfp);
+#endif
 #endif
 }
 
@@ -121,7 +177,15 @@ static int runner_start(std::string const &progJson, int sessionid, bool bZenCac
     if (session->globalStatus->failed())
         return onfail();
 
-    std::vector<char> buffer;
+    std::vector<char> buffers[2];
+    constexpr size_t kShmMinSize = 1 << 20;
+    const bool bUseShm = zeno::envconfig::getBool("IPC_SHM") && zeno::SharedMemory::supported();
+    // on any exit give the editor time to pick up what is still in flight, then remove
+    // the leftovers, so that segments are not leaked when the editor stopped reading
+    zeno::scope_exit spShm([=]() {
+        if (bUseShm)
+            zeno::SharedMemory::releasePublished(5000);
+    });
 
     session->globalComm->initFrameRange(graph->beginFrameNumber, graph->endFrameNumber);
     send_packet("{\"action\":\"frameRange\",\"key\":\""
@@ -129,6 +193,28 @@ static int runner_start(std::string const &progJson, int sessionid, bool bZenCac
                 + ":" + std::to_string(graph->endFrameNumber)
                 + "\"}", "", 0);
 
+    // frames dumped to cache are written in background, finishFrame is only reported
+    // to the editor once the frame is on disk: the pipe is written right from the cache
+    // writer thread, while the tcp socket lives in this thread, which drains the written
+    // frames between substeps
+    std::mutex writtenMtx;
+    std::vector<int> writtenFrames;
+    auto onFrameWritten = [&](int frame) {
+#ifdef ZENO_IPC_USE_TCP
+        std::lock_guard lck(writtenMtx);
+        writtenFrames.push_back(frame);
+#else
+        send_packet("{\"action\":\"finishFrame\",\"key\":\"" + std::to_string(frame) + "\"}", "", 0);
+#endif
+    };
+    auto sendWrittenFrames = [&] {
+        std::lock_guard lck(writtenMtx);
+        for (int frame : writtenFrames)
+            send_packet("{\"action\":\"finishFrame\",\"key\":\"" + std::to_string(frame) + "\"}", "", 0);
+        writtenFrames.clear();
+    };
+    zeno::scope_exit spFlush([=]() { session->globalComm->flushFrameCache(); });
+
     for (int frame = graph->beginFrameNumber; frame <= graph->endFrameNumber; frame++)
     {
         zeno::scope_exit sp([=]() { std::cout.flush(); });
@@ -144,6 +230,7 @@ static int runner_start(std::string const &progJson, int sessionid, bool bZenCac
                 graph->applyNodesToExec();
             }, *session->globalStatus);
             session->globalState->substepEnd();
+            sendWrittenFrames();
             if (session->globalStatus->failed())
                 return onfail();
         }
@@ -156,26 +243,71 @@ static int runner_start(std::string const &progJson, int sessionid, bool bZenCac
         if (bZenCache) {
             //construct cache lock.
             std::string sLockFile = cachedir + "/" + zeno::iotags::sZencache_lockfile_prefix + std::to_string(frame) + ".lock";
-            QLockFile lckFile(QString::fromStdString(sLockFile));
-            bool ret = lckFile.tryLock();
-            //dump cache to disk.
-            session->globalComm->dumpFrameCache(frame, cacheLightCameraOnly, cacheMaterialOnly);
+            auto lckFile = std::make_shared<QLockFile>(QString::fromStdString(sLockFile));
+            bool ret = lckFile->tryLock();
+            //dump cache to disk, the lock is held until the writer is done with this frame.
+            session->globalComm->dumpFrameCache(frame, cacheLightCameraOnly, cacheMaterialOnly, [&, frame, lckFile]() {
+                lckFile->unlock();
+                onFrameWritten(frame);
+            });
         } else {
             auto const& viewObjs = session->globalComm->getViewObjects();
             zeno::log_debug("runner got {} view objects", viewObjs.size());
-            for (auto const& [key, obj] : viewObjs) {
-                if (zeno::encodeObject(obj.get(), buffer))
-                    send_packet("{\"action\":\"viewObject\",\"key\":\"" + key + "\"}",
+            // encode the next object while the current one is being sent; big objects are
+            // encoded right into a shared memory segment, only its name goes through the pipe
+            std::vector<std::pair<std::string, zeno::IObject const *>> items;
+            for (auto const& [key, obj] : viewObjs)
+                items.emplace_back(key, obj.get());
+            struct Encoded {
+                bool ok = false;
+                std::string shmName;
+            };
+            auto encodeAt = [&](size_t i) {
+                return std::async(std::launch::async, [&buffers, &items, i, bUseShm]() {
+                    Encoded res;
+                    size_t size = 0;
+                    auto write = zeno::encodeObjectDeferred(items[i].second, size);
+                    if (!write)
+                        return res;
+                    res.ok = true;
+                    if (bUseShm && size >= kShmMinSize)
+                        res.shmName = zeno::SharedMemory::publish(size, write);
+                    if (res.shmName.empty()) {
+                        auto &buffer = buffers[i % 2];
+                        buffer.resize(size);
+                        write(buffer.data());
+                    }
+                    return res;
+                });
+            };
+            std::future<Encoded> encoded;
+            if (!items.empty())
+                encoded = encodeAt(0);
+            for (size_t i = 0; i < items.size(); i++) {
+                auto [ok, shmName] = encoded.get();
+                if (i + 1 < items.size())
+                    encoded = encodeAt(i + 1);
+                if (!ok)
+                    continue;
+                auto const &buffer = buffers[i % 2];
+                if (!shmName.empty())
+                    send_packet("{\"action\":\"viewObjectShm\",\"key\":\"" + items[i].first + "\"}",
+                        shmName.data(), shmName.size());
+                else
+                    send_packet("{\"action\":\"viewObject\",\"key\":\"" + items[i].first + "\"}",
                         buffer.data(), buffer.size());
-                buffer.clear();
             }
+            send_packet("{\"action\":\"finishFrame\",\"key\":\"" + std::to_string(frame) + "\"}", "", 0);
+            if (bUseShm)
+                zeno::log_debug("{} shared memory segments not consumed yet", zeno::SharedMemory::pendingPublished());
         }
-
-        send_packet("{\"action\":\"finishFrame\",\"key\":\"" + std::to_string(frame) + "\"}", "", 0);
+        sendWrittenFrames();
 
         if (session->globalStatus->failed())
             return onfail();
     }
+    session->globalComm->flushFrameCache();
+    sendWrittenFrames();
     return 0;
 }
 
@@ -239,6 +371,10 @@ int runner_main(const QCoreApplication& app) {
 
     zeno::set_log_stream(std::clog);
 
+    // ZENO_FRAME_HEAP=1 reuses the attribute arrays from frame to frame, see FrameHeap.h
+    if (zeno::envconfig::getBool("FRAME_HEAP"))
+        zeno::frame_heap::enable((std::size_t)zeno::envconfig::getInt("FRAME_HEAP_MB", 1024) << 20);
+
 #ifdef ZENO_IPC_USE_TCP
     zeno::log_debug("connecting to port {}", port);
     clientSocket = std::make_unique<QTcpSocket>();
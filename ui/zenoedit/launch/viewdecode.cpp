@@ -10,6 +10,7 @@
 #include <zeno/extra/GlobalComm.h>
 #include <zeno/extra/GlobalStatus.h>
 #include <zeno/funcs/ObjectCodec.h>
+#include <zeno/utils/SharedMemory.h>
 #ifdef ZENO_WITH_UnrealBridge
 #include "unrealhook.h"
 #endif
@@ -73,9 +74,17 @@ struct PacketProc {
 
     bool processPacket(std::string const &action, std::string const &objKey, const char *buf, size_t len) {
 
-        if (action == "viewObject") {
+        if (action == "viewObject" || action == "viewObjectShm") {
             zeno::log_debug("decoding object");
-            auto object = zeno::decodeObject(buf, len);
+            std::shared_ptr<zeno::IObject> object;
+            if (action == "viewObjectShm") {
+                // payload is the name of a shared memory segment holding the encoded object
+                zeno::SharedMemory::consume(std::string(buf, len), [&] (const char *data, size_t size) {
+                    object = zeno::decodeObject(data, size);
+                });
+            } else {
+                object = zeno::decodeObject(buf, len);
+            }
             //zeno::log_debug("object ident=[{}]", object->userData().get("ident"));
             if (!object) {
                 zeno::log_warn("failed to decode view object");
@@ -312,6 +321,8 @@ void viewDecodeFinish()
 {
     viewDecodeData.finish();
     packetProc.onFinish();
+    // segments of a killed or crashed runner are never consumed
+    zeno::SharedMemory::removeOrphans();
     auto mainWin = zenoApp->getMainWindow();
     if (mainWin)
         mainWin->onRunFinished();
@@ -328,6 +339,7 @@ void viewDecodeClear()
     zeno::log_debug("viewDecodeClear");
     viewDecodeData.clear();
     packetProc.onStart();
+    zeno::SharedMemory::removeOrphans();
 }
 
 void viewDecodeAppend(const char *buf, size_t n)
@@ -11,6 +11,7 @@
 #include <set>
 #include <any>
 #include <map>
+#include <mutex>
 
 namespace zeno {
 
@@ -21,6 +22,7 @@ struct INode;
 
 struct Context {
     std::set<std::string> visited;
+    std::mutex mtx;  // guards visited during parallel execution
 
     inline void mergeVisited(Context const &other) {
         visited.insert(other.visited.begin(), other.visited.end());
@@ -33,6 +33,7 @@ public:
     std::set<std::string> kframes;
     std::set<std::string> formulas;
     zany muted_output;
+    mutable bool frame_dependent = false;  // set once the node reads the global state
 
     ZENO_API INode();
     ZENO_API virtual ~INode();
@@ -14,6 +14,7 @@ struct INode;
 
 struct INodeClass {
     std::unique_ptr<Descriptor> desc;
+    bool memoizable = false;  // outputs depend only on the inputs, see DirtyChecker
 
     ZENO_API INodeClass(Descriptor const &desc);
     ZENO_API virtual ~INodeClass();
@@ -5,11 +5,15 @@
 #include <zeno/utils/safe_dynamic_cast.h>
 #include <zeno/funcs/ObjectCodec.h>
 #include <zeno/types/UserData.h>
+#include <mutex>
 #include <set>
+#include <map>
 #include <string>
 
 namespace zeno {
 
+struct INode;
+
 struct DirtyChecker {
     std::set<std::string> dirts;
 
@@ -20,6 +24,40 @@ struct DirtyChecker {
     bool amIDirty(std::string const &ident) const {
         return dirts.find(ident) != dirts.end();
     }
+
+    // output memoization across frames, enabled by ZENO_MEMOIZE=1
+    //
+    // only node classes known to be pure are memoized: the builtin primitive creators,
+    // plus those listed in ZENO_MEMOIZE_NODES (comma separated), as nodes may read the
+    // frame, draw random numbers or touch files without the checker noticing
+    //
+    // a node is static when it is of such a class, its outputs depend only on its
+    // parameters and on other static nodes, it never read the global state, and it
+    // has no keyframes or formulas; static nodes whose parameters (hashed by content)
+    // and upstream did not change get their outputs restored from a pristine copy
+    // instead of being applied again
+    struct NodeMemo {
+        std::size_t paramsHash = 0;
+        int changedEpoch = -1;        // epoch in which the outputs were last recomputed
+        bool upstreamStatic = false;  // all producers were static when last checked
+        bool isStatic = false;
+        std::map<std::string, zany> outputs;
+    };
+
+    std::map<std::string, NodeMemo> memos;
+    int epoch = 0;  // bumped by each Graph::applyNodes
+    std::mutex mtx;  // guards dirts, memos and epoch during parallel execution
+
+    ZENO_API static bool memoizeEnabled();
+    ZENO_API static bool isMemoizableClass(std::string const &cls);
+    // false when some parameter can't be hashed, which makes the node not static
+    ZENO_API static bool hashParams(INode *node, std::size_t &hash);
+
+    ZENO_API void beginEpoch();
+    ZENO_API bool tryReuseOutputs(INode *node);
+    ZENO_API void updateOutputs(INode *node);
+    ZENO_API void invalidate(std::string const &ident);
+    ZENO_API void invalidateAll();
 };
 
 }
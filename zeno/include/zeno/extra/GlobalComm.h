@@ -1,6 +1,7 @@
 #pragma once
 
 #include <zeno/core/IObject.h>
+#include <zeno/funcs/ObjectCodec.h>
 #include <zeno/utils/PolymorphicMap.h>
 #include <memory>
 #include <string>
@@ -12,9 +13,25 @@
 
 namespace zeno {
 
+struct MappedFile;
+
 struct GlobalComm {
     using ViewObjects = PolymorphicMap<std::map<std::string, std::shared_ptr<IObject>>>;
 
+    // objects of a frame loaded back from an indexed zencache, decoded on first use
+    struct LazyViewObjects {
+        struct Entry {
+            std::shared_ptr<MappedFile> file;
+            size_t offset = 0;
+            size_t size = 0;
+        };
+        std::map<std::string, Entry> entries;
+        ObjectCodecOptions codecOptions;
+
+        ZENO_API void clear();
+        ZENO_API std::shared_ptr<IObject> decode(std::string const &key);
+    };
+
     enum FRAME_STATE {
         FRAME_UNFINISH,
         FRAME_COMPLETED,
@@ -23,6 +40,7 @@ struct GlobalComm {
 
     struct FrameData {
         ViewObjects view_objects;
+        LazyViewObjects lazy_objects;
         FRAME_STATE frame_state = FRAME_UNFINISH;
     };
     std::vector<FrameData> m_frames;
@@ -35,11 +53,18 @@ struct GlobalComm {
     int maxCachedFrames = 1;
     std::string cacheFramePath;
 
+    ZENO_API GlobalComm();
+    ZENO_API ~GlobalComm();
+
     ZENO_API void frameCache(std::string const &path, int gcmax);
     ZENO_API void initFrameRange(int beg, int end);
     ZENO_API void newFrame();
     ZENO_API void finishFrame();
-    ZENO_API void dumpFrameCache(int frameid, bool cacheLightCameraOnly = false, bool cacheMaterialOnly = false);
+    // the frame is handed to a background writer (queue size set by ZENO_CACHE_QUEUE,
+    // 0 writes synchronously), onFinish is called from the writer thread once written
+    ZENO_API void dumpFrameCache(int frameid, bool cacheLightCameraOnly = false, bool cacheMaterialOnly = false,
+                std::function<void()> onFinish = nullptr);
+    ZENO_API void flushFrameCache();
     ZENO_API void addViewObject(std::string const &key, std::shared_ptr<IObject> object);
     ZENO_API int maxPlayFrames();
     ZENO_API int numOfFinishedFrame();
@@ -51,7 +76,8 @@ struct GlobalComm {
     ZENO_API ViewObjects const &getViewObjects();
     ZENO_API bool load_objects(const int frameid, 
                 const std::function<bool(std::map<std::string, std::shared_ptr<zeno::IObject>> const& objs)>& cb,
-                bool& isFrameValid);
+                bool& isFrameValid,
+                const std::function<bool(std::string const& key)>& needObject = nullptr);
     ZENO_API bool isFrameCompleted(int frameid) const;
     ZENO_API FRAME_STATE getFrameState(int frameid) const;
     ZENO_API bool isFrameBroken(int frameid) const;
@@ -61,6 +87,10 @@ struct GlobalComm {
     ZENO_API void removeCachePath();
 
 private:
+    struct CacheWriter;
+    std::unique_ptr<CacheWriter> m_writer;
+
+    bool _loadFrame(const int frameid);
     ViewObjects const *_getViewObjects(const int frameid);
 };
 
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <zeno/utils/api.h>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+
+namespace zeno {
+
+struct Graph;
+struct INode;
+
+// opt-in parallel executor for Graph::applyNodes, enabled by ZENO_PARALLEL_EXEC=<nthreads>
+//
+// nodes reachable from the requested ids are collected into a dependency DAG from
+// their inputBounds, and the side-effect free part of it is applied concurrently on a
+// work-stealing pool; the rest (control flow, portals, views, subnets and everything
+// downstream of them) is left to the ordinary serial recursion in Graph::applyNodes
+struct GraphScheduler {
+    struct Task {
+        INode *node = nullptr;
+        std::vector<int> producers;   // tasks whose outputs this node consumes
+        std::vector<int> consumers;   // tasks consuming outputs of this node
+        std::vector<int> successors;  // consumers plus serial-order edges between tasks an object may reach
+    };
+
+    Graph *graph;
+    std::vector<Task> tasks;
+
+    explicit GraphScheduler(Graph *graph) : graph(graph) {}
+
+    ZENO_API static int numWorkers();
+    ZENO_API static bool isWorkerThread();
+
+    ZENO_API void buildTasks(std::set<std::string> const &ids);
+    ZENO_API void applyTasks();
+
+    ZENO_API static bool isLazyNode(INode *node);
+    ZENO_API static bool isSerialNode(INode *node);
+
+private:
+    std::map<std::string, int> m_lut;  // node name -> task index, -1 for serial nodes
+
+    bool collect(std::string const &id);
+};
+
+}
@@ -1,13 +1,34 @@
 #pragma once
 
 #include <zeno/core/IObject.h>
+#include <functional>
 #include <vector>
 #include <string>
 #include <memory>
 
 namespace zeno {
 
+// options for the packed encoding of primitives: attribute arrays are byte-shuffled and
+// block compressed, and big arrays may be stored out of line by content hash, so that
+// arrays which don't change between frames (usually the topology) are stored only once
+struct ObjectCodecOptions {
+    bool compress = false;
+    std::size_t blobMinSize = 0;  // arrays of at least this many bytes go to blobs, 0 to disable
+    std::function<void(std::string const &name, const char *data, std::size_t size)> storeBlob;
+    // asked first, true when a blob of that name is already stored: the array is then
+    // neither packed nor passed to storeBlob
+    std::function<bool(std::string const &name)> reuseBlob;
+    std::function<bool(std::string const &name, std::vector<char> &data)> loadBlob;
+};
+
 ZENO_API std::shared_ptr<IObject> decodeObject(const char *buf, size_t len);
 ZENO_API bool encodeObject(IObject const *object, std::vector<char> &buf);
+ZENO_API std::shared_ptr<IObject> decodeObject(const char *buf, size_t len, ObjectCodecOptions const &opts);
+ZENO_API bool encodeObject(IObject const *object, std::vector<char> &buf, ObjectCodecOptions const &opts);
+
+// encodes in two steps, to write straight into memory of the exact size (a shared memory
+// segment...) rather than a vector: sets size and returns the function writing the size
+// bytes there, null on failure; the object must stay unchanged until it is called
+ZENO_API std::function<void(char *)> encodeObjectDeferred(IObject const *object, std::size_t &size);
 
 }
@@ -32,7 +32,7 @@ ZENO_API void primLineDistance(PrimitiveObject *prim, std::string resAttr, int s
 
 ZENO_API void primFilterVerts(PrimitiveObject *prim, std::string tagAttr, int tagValue, bool isInversed = false, std::string revampAttrO = {}, std::string method = "verts");
 
-ZENO_API void primMarkIsland(PrimitiveObject *prim, std::string tagAttr);
+ZENO_API std::vector<int> primMarkIsland(PrimitiveObject *prim, std::string tagAttr, bool compact = false);
 ZENO_API std::vector<std::shared_ptr<PrimitiveObject>> primUnmergeVerts(PrimitiveObject *prim, std::string tagAttr);
 
 ZENO_API void primSimplifyTag(PrimitiveObject *prim, std::string tagAttr);
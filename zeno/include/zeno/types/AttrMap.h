@@ -0,0 +1,354 @@
+#pragma once
+
+#include <string_view>
+#include <type_traits>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace zeno {
+
+// attribute name with its hash computed once, resolve it outside of hot loops (or as
+// a static) and pass it to attr<T>(), has_attr()... so lookups skip hashing the string
+struct AttrName {
+    std::string name;
+    std::size_t hash;
+
+    static std::size_t hash_of(std::string_view s) {
+        std::uint64_t h = 0xcbf29ce484222325ull;  // fnv-1a, attribute names are short
+        for (char c: s) {
+            h ^= (unsigned char)c;
+            h *= 0x100000001b3ull;
+        }
+        return (std::size_t)h;
+    }
+
+    explicit AttrName(std::string name_) : name(std::move(name_)), hash(hash_of(name)) {}
+    explicit AttrName(char const *name_) : AttrName(std::string(name_)) {}
+
+    operator std::string const &() const {
+        return name;
+    }
+};
+
+// drop-in for the std::map<std::string, V> of attribute arrays: entries are kept sorted
+// by name, so iteration order doesn't change, and heap-allocated, so references to the
+// arrays survive adding attributes; lookups go through a flat open-addressing table
+//
+// copying the map copies the arrays; share_from() is the explicit way to share them
+// instead: a shared array is detached (deep-copied) the first time it is reached through
+// a mutable path of either map, i.e. dereferencing a non-const iterator or operator[],
+// while const access never copies. only the first mutable access to a shared array may
+// run concurrently with other accesses to the same array (of any map), so fetch arrays
+// once before a parallel loop; a reference taken before share_from still points into
+// the shared array, writing through it changes both maps: re-fetch it after sharing
+template <class V>
+struct AttrMap {
+    using key_type = std::string;
+    using mapped_type = V;
+    using value_type = std::pair<const std::string, V>;
+    using size_type = std::size_t;
+
+private:
+    // each map owns its entries, only the key-value pairs are shared; the key and hash
+    // are kept aside so that lookups never touch a pair being detached. kv is replaced
+    // under the lock only, accesses read ptr, which always points to the pair of kv (or
+    // to the one it replaced, still alive in the other map). once exclusive is set, kv
+    // is owned by this map alone and no longer changes, so mutable access only has to
+    // check the flag; share_from clears it on both maps
+    struct Entry {
+        std::string key;
+        std::size_t hash;
+        std::shared_ptr<value_type> kv;
+        std::atomic<value_type *> ptr;
+        std::atomic<bool> exclusive;
+
+        Entry(std::string key_, std::size_t hash_, V &&val)
+            : key(key_), hash(hash_), kv(std::make_shared<value_type>(std::move(key_), std::move(val)))
+            , ptr(kv.get()), exclusive(true) {}
+
+        // deep copy
+        Entry(Entry const &that)
+            : key(that.key), hash(that.hash), kv(std::make_shared<value_type>(*that.ptr.load(std::memory_order_acquire)))
+            , ptr(kv.get()), exclusive(true) {}
+
+        // shallow copy
+        Entry(Entry &that, std::shared_ptr<value_type> kv_)
+            : key(that.key), hash(that.hash), kv(std::move(kv_)), ptr(kv.get()), exclusive(false) {
+            that.exclusive.store(false, std::memory_order_release);
+        }
+
+        Entry(Entry &&that) noexcept
+            : key(std::move(that.key)), hash(that.hash), kv(std::move(that.kv)), ptr(kv.get())
+            , exclusive(that.exclusive.load(std::memory_order_relaxed)) {}
+
+        Entry &operator=(Entry &&that) noexcept {
+            key = std::move(that.key);
+            hash = that.hash;
+            kv = std::move(that.kv);
+            ptr.store(kv.get(), std::memory_order_relaxed);
+            exclusive.store(that.exclusive.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
+    std::vector<Entry> m_entries;        // sorted by key
+    std::vector<std::uint32_t> m_slots;  // entry index + 1, 0 for empty
+
+    template <class It, class Ref>
+    struct Iterator {
+        It it;
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = AttrMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = Ref &;
+        using pointer = Ref *;
+
+        reference operator*() const {
+            if constexpr (!std::is_const_v<Ref>)
+                unshare(*it);
+            return *it->ptr.load(std::memory_order_acquire);
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        Iterator &operator++() {
+            ++it;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            return {it++};
+        }
+
+        Iterator &operator--() {
+            --it;
+            return *this;
+        }
+
+        Iterator operator--(int) {
+            return {it--};
+        }
+
+        bool operator==(Iterator const &that) const {
+            return it == that.it;
+        }
+
+        bool operator!=(Iterator const &that) const {
+            return it != that.it;
+        }
+
+        template <class It2, class Ref2, class = std::enable_if_t<std::is_convertible_v<It2, It>>>
+        Iterator(Iterator<It2, Ref2> const &that) : it(that.it) {}
+
+        Iterator(It it_) : it(it_) {}
+    };
+
+    // slow path under a lock picked by slot address, only taken on the first mutable
+    // access after share_from, so the small pool is hardly ever contended; when the other
+    // map detached first, the pair is left to this one and needs no copy
+    static std::mutex &lock_of(Entry const &e) {
+        static std::mutex locks[64];
+        return locks[(reinterpret_cast<std::uintptr_t>(&e) / sizeof(Entry)) % 64];
+    }
+
+    static void unshare(Entry &e) {
+        if (e.exclusive.load(std::memory_order_acquire))
+            return;
+        std::lock_guard lck(lock_of(e));
+        if (e.exclusive.load(std::memory_order_relaxed))
+            return;
+        if (e.kv.use_count() > 1) {
+            auto kv = std::make_shared<value_type>(*e.kv);
+            e.ptr.store(kv.get(), std::memory_order_release);
+            e.kv = std::move(kv);
+        } else {
+            std::atomic_thread_fence(std::memory_order_acquire);  // the other map is done with it
+        }
+        e.exclusive.store(true, std::memory_order_release);
+    }
+
+    void rehash() {
+        std::size_t cap = 8;
+        while (cap < 2 * m_entries.size())
+            cap <<= 1;
+        m_slots.assign(cap, 0);
+        for (std::size_t i = 0; i < m_entries.size(); i++) {
+            std::size_t h = m_entries[i].hash & (cap - 1);
+            while (m_slots[h])
+                h = (h + 1) & (cap - 1);
+            m_slots[h] = (std::uint32_t)(i + 1);
+        }
+    }
+
+    std::ptrdiff_t lookup(std::string_view key, std::size_t hash) const {
+        if (m_entries.empty())
+            return -1;
+        std::size_t mask = m_slots.size() - 1;
+        for (std::size_t h = hash & mask;; h = (h + 1) & mask) {
+            auto s = m_slots[h];
+            if (!s)
+                return -1;
+            auto const &e = m_entries[s - 1];
+            if (e.hash == hash && e.key == key)
+                return s - 1;
+        }
+    }
+
+    std::size_t insert_at(std::string key, std::size_t hash, V &&val) {
+        auto pos = std::lower_bound(m_entries.begin(), m_entries.end(), key, [] (auto const &e, auto const &k) {
+            return e.key < k;
+        });
+        auto idx = pos - m_entries.begin();
+        m_entries.insert(pos, Entry(std::move(key), hash, std::move(val)));
+        rehash();
+        return idx;
+    }
+
+public:
+    using iterator = Iterator<typename std::vector<Entry>::iterator, value_type>;
+    using const_iterator = Iterator<typename std::vector<Entry>::const_iterator, value_type const>;
+
+    AttrMap() = default;
+    AttrMap(AttrMap &&) = default;
+    AttrMap &operator=(AttrMap &&) = default;
+    AttrMap(AttrMap const &) = default;
+    AttrMap &operator=(AttrMap const &that) {
+        if (this != &that)
+            *this = AttrMap(that);
+        return *this;
+    }
+
+    // replace the content with the arrays of that, shared until either map writes them,
+    // O(size()); that is not const as its arrays become shared as well
+    void share_from(AttrMap &that) {
+        if (this == &that)
+            return;
+        std::vector<Entry> entries;
+        entries.reserve(that.m_entries.size());
+        for (auto &e: that.m_entries) {
+            std::shared_ptr<value_type> kv;
+            {
+                std::lock_guard lck(lock_of(e));  // e may be being detached meanwhile
+                kv = e.kv;
+            }
+            entries.emplace_back(e, std::move(kv));
+        }
+        m_entries = std::move(entries);
+        m_slots = that.m_slots;
+    }
+
+    iterator begin() { return {m_entries.begin()}; }
+    iterator end() { return {m_entries.end()}; }
+    const_iterator begin() const { return {m_entries.begin()}; }
+    const_iterator end() const { return {m_entries.end()}; }
+    const_iterator cbegin() const { return {m_entries.begin()}; }
+    const_iterator cend() const { return {m_entries.end()}; }
+
+    std::size_t size() const {
+        return m_entries.size();
+    }
+
+    bool empty() const {
+        return m_entries.empty();
+    }
+
+    void clear() {
+        m_entries.clear();
+        m_slots.clear();
+    }
+
+    // clear, passing the arrays owned by this map alone to f first, so they can be reused
+    template <class F>
+    void release(F const &f) {
+        for (auto &e: m_entries) {
+            if (e.kv.use_count() == 1) {
+                std::atomic_thread_fence(std::memory_order_acquire);  // see unshare
+                f(e.kv->second);
+            }
+        }
+        clear();
+    }
+
+    iterator find(std::string_view key) {
+        return find(key, AttrName::hash_of(key));
+    }
+
+    const_iterator find(std::string_view key) const {
+        return find(key, AttrName::hash_of(key));
+    }
+
+    iterator find(AttrName const &key) {
+        return find(key.name, key.hash);
+    }
+
+    const_iterator find(AttrName const &key) const {
+        return find(key.name, key.hash);
+    }
+
+    iterator find(std::string_view key, std::size_t hash) {
+        auto i = lookup(key, hash);
+        return {i < 0 ? m_entries.end() : m_entries.begin() + i};
+    }
+
+    const_iterator find(std::string_view key, std::size_t hash) const {
+        auto i = lookup(key, hash);
+        return {i < 0 ? m_entries.end() : m_entries.begin() + i};
+    }
+
+    std::size_t count(std::string_view key) const {
+        return lookup(key, AttrName::hash_of(key)) >= 0;
+    }
+
+    V &operator[](std::string const &key) {
+        auto hash = AttrName::hash_of(key);
+        auto i = lookup(key, hash);
+        if (i < 0)
+            i = insert_at(key, hash, V());
+        return iterator{m_entries.begin() + i}->second;
+    }
+
+    // mutable access to an entry found through const lookup or iteration, so callers
+    // can check an array first and only detach it when it really has to change
+    V &unshare(const_iterator pos) {
+        return iterator{m_entries.begin() + (pos.it - m_entries.cbegin())}->second;
+    }
+
+    template <class ...Args>
+    std::pair<iterator, bool> try_emplace(std::string const &key, Args &&...args) {
+        auto hash = AttrName::hash_of(key);
+        auto i = lookup(key, hash);
+        if (i >= 0)
+            return {{m_entries.begin() + i}, false};
+        i = insert_at(key, hash, V(std::forward<Args>(args)...));
+        return {{m_entries.begin() + i}, true};
+    }
+
+    iterator erase(const_iterator pos) {
+        auto it = m_entries.erase(pos.it);
+        auto idx = it - m_entries.begin();
+        rehash();
+        return {m_entries.begin() + idx};
+    }
+
+    std::size_t erase(std::string_view key) {
+        auto i = lookup(key, AttrName::hash_of(key));
+        if (i < 0)
+            return 0;
+        m_entries.erase(m_entries.begin() + i);
+        rehash();
+        return 1;
+    }
+};
+
+}
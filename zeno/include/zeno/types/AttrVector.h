@@ -3,6 +3,8 @@
 #include <zeno/utils/vec.h>
 #include <zeno/utils/Error.h>
 #include <zeno/utils/type_traits.h>
+#include <zeno/types/AttrMap.h>
+#include <zeno/utils/FrameHeap.h>
 #include <variant>
 #include <vector>
 #include <map>
@@ -52,12 +54,29 @@ struct AttrVector {
     inline static const std::string kpos = "pos"; 
 
     BaseVector values;
-    std::map<std::string, AttrVectorVariant> attrs;
+    AttrMap<AttrVectorVariant> attrs;
 
     AttrVector() = default;
     AttrVector(std::vector<ValT> const &values_) : values(values_) {}
     AttrVector(std::vector<ValT> &&values_) : values(std::move(values_)) {}
-    explicit AttrVector(size_t size) : values(size) {}
+    explicit AttrVector(size_t size) { frame_heap::resize_vector(values, size); }
+    AttrVector(AttrVector const &) = default;
+    AttrVector(AttrVector &&) = default;
+    AttrVector &operator=(AttrVector const &) = default;
+    AttrVector &operator=(AttrVector &&) = default;
+
+    // the arrays go back to the frame heap, to be reused by the next frame
+    ~AttrVector() {
+        frame_heap::give_vector(std::move(values));
+        clear_attrs();
+    }
+
+    // become a copy of that sharing its attribute arrays until either side writes them,
+    // see AttrMap::share_from; values is a plain vector and always gets copied
+    void share_from(AttrVector &that) {
+        values = that.values;
+        attrs.share_from(that.attrs);
+    }
 
     decltype(auto) begin() const {
         return values.begin();
@@ -106,9 +125,12 @@ struct AttrVector {
     //}
 
     void update() {
-        for (auto &[key, val] : attrs) {
-            std::visit([&](auto &val) { val.resize(this->size()); }, val);
-        }
+        size_t n = size();
+        modify_attrs([&] (auto const &val) {
+            return val.size() != n;
+        }, [&] (auto &val) {
+            frame_heap::resize_vector(val, n);
+        });
     }
 
     decltype(auto) operator[](size_t idx) const {
@@ -327,7 +349,7 @@ struct AttrVector {
         }
         attrIndex++;
         // attr
-        // attr is std::map, it's sorted, so here attrIndex++ is right.
+        // attrs are kept sorted by name, so here attrIndex++ is right.
         for (auto& [key, arr] : attrs) {
             auto const& k = key;
             std::visit([&](auto& arr) {
@@ -378,7 +400,14 @@ struct AttrVector {
     template <class T>
     auto &add_attr(std::string const &name) {
         if (!attr_is<T>(name))
-            attrs[name] = std::vector<T>(size());
+            attrs[name] = new_array<T>(size());
+        return attr<T>(name);
+    }
+
+    template <class T>
+    auto &add_attr(AttrName const &name) {
+        if (!attr_is<T>(name))
+            attrs[name] = new_array<T>(size());
         return attr<T>(name);
     }
 
@@ -386,7 +415,7 @@ struct AttrVector {
     template <class T>
     auto &add_attr(std::string const &name, T const &val) {
         if (!attr_is<T>(name))
-            attrs[name] = std::vector<T>(size(), val);
+            attrs[name] = new_array<T>(size(), val);
         return attr<T>(name);
     }
 
@@ -397,34 +426,75 @@ struct AttrVector {
         //return attr<T>(name);
     //}
 
-    template <class T>
-    auto const &attr(std::string const &name) const {
-        if (name == "pos") {
+private:
+    // attrs may be shared (see share_from) until written, so look before touching: only
+    // the arrays for which pred holds get detached and passed to f
+    template <class Pred, class F>
+    void modify_attrs(Pred const &pred, F const &f) {
+        for (auto it = attrs.cbegin(); it != attrs.cend(); ++it) {
+            if (std::visit(pred, it->second))
+                std::visit(f, attrs.unshare(it));
+        }
+    }
+
+    template <class T, class ...Args>
+    static std::vector<T> new_array(size_t size, Args const &...val) {
+        std::vector<T> arr;
+        frame_heap::resize_vector(arr, size, val...);
+        return arr;
+    }
+
+    static std::string const &name_of(std::string const &name) {
+        return name;
+    }
+
+    static std::string const &name_of(AttrName const &name) {
+        return name.name;
+    }
+
+    static bool is_pos(std::string const &name) {
+        return name.size() == 3 && name[0] == 'p' && name[1] == 'o' && name[2] == 's';
+    }
+
+    template <class T, class Self, class Key>
+    static auto &typed_attr(Self &self, Key const &name) {
+        if (is_pos(name_of(name))) {
             if constexpr (!std::is_same_v<T, ValT>) {
                 throw makeError<TypeError>(typeid(T), typeid(ValT), "type of primitive attribute pos");
             } else {
-                return values;
+                return self.values;
             }
         }
-        auto const &arr = attr(name);
-        if (!std::holds_alternative<std::vector<T>>(arr))
-            throw makeError<TypeError>(typeid(T), std::visit([&] (auto const &t) -> std::type_info const & { return typeid(std::decay_t<decltype(t[0])>); }, arr), "type of primitive attribute " + name);
-        return std::get<std::vector<T>>(arr);
+        auto it = self.attrs.find(name);
+        if (it == self.attrs.end())
+            throw makeError<KeyError>(name_of(name), "attribute name of primitive");
+        auto &arr = it->second;
+        auto *ptr = std::get_if<std::vector<T>>(&arr);
+        if (!ptr)
+            throw makeError<TypeError>(typeid(T), std::visit([&] (auto const &t) -> std::type_info const & { return typeid(std::decay_t<decltype(t[0])>); }, arr), "type of primitive attribute " + name_of(name));
+        return *ptr;
+    }
+
+public:
+    template <class T>
+    auto const &attr(std::string const &name) const {
+        return typed_attr<T>(*this, name);
     }
 
     template <class T>
     auto &attr(std::string const &name) {
-        if (name == "pos") {
-            if constexpr (!std::is_same_v<T, ValT>) {
-                throw makeError<TypeError>(typeid(T), typeid(ValT), "type of primitive attribute pos");
-            } else {
-                return values;
-            }
-        }
-        auto &arr = attr(name);
-        if (!std::holds_alternative<std::vector<T>>(arr))
-            throw makeError<TypeError>(typeid(T), std::visit([&] (auto const &t) -> std::type_info const & { return typeid(std::decay_t<decltype(t[0])>); }, arr), "type of primitive attribute " + name);
-        return std::get<std::vector<T>>(arr);
+        return typed_attr<T>(*this, name);
+    }
+
+    // name hashed once by the caller, for lookups in hot loops
+    template <class T>
+    auto const &attr(AttrName const &name) const {
+        return typed_attr<T>(*this, name);
+    }
+
+    template <class T>
+    auto &attr(AttrName const &name) {
+        return typed_attr<T>(*this, name);
     }
 
     // deprecated:
@@ -453,7 +523,12 @@ struct AttrVector {
     }
 
     bool has_attr(std::string const &name) const {
-        if (name == "pos") return true;
+        if (is_pos(name)) return true;
+        return attrs.find(name) != attrs.end();
+    }
+
+    bool has_attr(AttrName const &name) const {
+        if (is_pos(name.name)) return true;
         return attrs.find(name) != attrs.end();
     }
 
@@ -463,13 +538,22 @@ struct AttrVector {
 
     template <class T>
     bool attr_is(std::string const &name) const {
-        if (name == "pos") return std::is_same_v<T, ValT>;
+        if (is_pos(name)) return std::is_same_v<T, ValT>;
+        auto it = attrs.find(name);
+        return it != attrs.end() && std::holds_alternative<std::vector<T>>(it->second);
+    }
+
+    template <class T>
+    bool attr_is(AttrName const &name) const {
+        if (is_pos(name.name)) return std::is_same_v<T, ValT>;
         auto it = attrs.find(name);
         return it != attrs.end() && std::holds_alternative<std::vector<T>>(it->second);
     }
 
     void clear_attrs() {
-        attrs.clear();
+        attrs.release([] (auto &val) {
+            std::visit([] (auto &val) { frame_heap::give_vector(std::move(val)); }, val);
+        });
     }
 
     size_t size() const {
@@ -478,30 +562,26 @@ struct AttrVector {
 
     void reserve(size_t size) {
         values.reserve(size);
-        for (auto &[key, val] : attrs) {
-            std::visit([&](auto &val) { val.reserve(size); }, val);
-        }
+        modify_attrs([&](auto const &val) { return val.capacity() < size; },
+                     [&](auto &val) { val.reserve(size); });
     }
 
     void shrink_to_fit() {
         values.shrink_to_fit();
-        for (auto &[key, val] : attrs) {
-            std::visit([&](auto &val) { val.shrink_to_fit(); }, val);
-        }
+        modify_attrs([&](auto const &val) { return val.capacity() != val.size(); },
+                     [&](auto &val) { val.shrink_to_fit(); });
     }
 
     void resize(size_t size) {
-        values.resize(size);
-        for (auto &[key, val] : attrs) {
-            std::visit([&](auto &val) { val.resize(size); }, val);
-        }
+        frame_heap::resize_vector(values, size);
+        modify_attrs([&](auto const &val) { return val.size() != size; },
+                     [&](auto &val) { frame_heap::resize_vector(val, size); });
     }
 
     void clear() {
         values.clear();
-        for (auto &[key, val] : attrs) {
-            std::visit([&](auto &val) { val.clear(); }, val);
-        }
+        modify_attrs([&](auto const &val) { return !val.empty(); },
+                     [&](auto &val) { val.clear(); });
     }
 };
 
@@ -143,6 +143,25 @@ struct PrimitiveObject : IObjectClone<PrimitiveObject> {
     std::shared_ptr<MaterialObject> mtl;
     std::shared_ptr<InstancingObject> inst;
 
+    // clone sharing the attribute arrays with this prim until either side writes them,
+    // for copies mostly read afterwards; see AttrMap::share_from for the rules
+    std::shared_ptr<PrimitiveObject> share_clone() {
+        auto prim = std::make_shared<PrimitiveObject>();
+        static_cast<IObject &>(*prim) = *this;
+        prim->verts.share_from(verts);
+        prim->points.share_from(points);
+        prim->lines.share_from(lines);
+        prim->tris.share_from(tris);
+        prim->quads.share_from(quads);
+        prim->loops.share_from(loops);
+        prim->polys.share_from(polys);
+        prim->edges.share_from(edges);
+        prim->uvs.share_from(uvs);
+        prim->mtl = mtl;
+        prim->inst = inst;
+        return prim;
+    }
+
     // deprecated:
     template <class Accept = std::variant<vec3f, float>, class F>
     void foreach_attr(F &&f) {
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <zeno/utils/api.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace zeno {
+
+// bundled LZ77 block codec in the spirit of LZ4 (token, literals, 16-bit offset, match),
+// tuned for speed rather than ratio, no external dependency needed
+
+// worst-case size of the compressed output for n bytes of input
+ZENO_API std::size_t blockCompressBound(std::size_t n);
+// returns the compressed size, dst must hold at least blockCompressBound(n) bytes
+ZENO_API std::size_t blockCompress(const char *src, std::size_t n, char *dst);
+// returns false if the input is corrupted or doesn't decode to exactly rawSize bytes
+ZENO_API bool blockDecompress(const char *src, std::size_t n, char *dst, std::size_t rawSize);
+
+// group the k-th bytes of all stride-sized elements together, which makes arrays of
+// floats and ints much more compressible; n must be a multiple of stride
+ZENO_API void byteShuffle(const char *src, char *dst, std::size_t n, std::size_t stride);
+ZENO_API void byteUnshuffle(const char *src, char *dst, std::size_t n, std::size_t stride);
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <zeno/utils/api.h>
+#include <typeinfo>
+#include <cstddef>
+#include <utility>
+#include <memory>
+#include <vector>
+
+namespace zeno::frame_heap {
+
+// pool of big arrays for a process evaluating frame after frame (the runner): the
+// attribute and topology arrays are about the same size every frame, so AttrVector
+// hands the buffers of the arrays it drops to the pool and grows its arrays into pooled
+// buffers, instead of freeing them and page-faulting fresh ones in on first touch;
+// recycle(), called by GlobalState::frameEnd, frees the buffers which were not reused
+// during the whole last frame, and the oldest ones while more than budget bytes are idle
+//
+// process-wide, so it is opt-in: call enable() from main, before any frame is run;
+// until then nothing is pooled
+
+// a std::vector<T> buffer with its type erased
+struct Buffer {
+    virtual ~Buffer() = default;
+};
+
+template <class T>
+struct VectorBuffer : Buffer {
+    std::vector<T> vec;
+};
+
+constexpr std::size_t kMinPooled = 1 << 20;  // smaller buffers are cheap enough for malloc
+
+#ifndef ZENO_APIFREE
+ZENO_API void enable(std::size_t budget);
+ZENO_API bool enabled();
+
+// capacity in bytes, buf is freed right away unless enabled
+ZENO_API void give(std::type_info const &type, std::size_t capacity, std::unique_ptr<Buffer> buf);
+
+// the pooled buffer of that type best fitting at least size bytes, null if none does
+ZENO_API std::unique_ptr<Buffer> take(std::type_info const &type, std::size_t size);
+
+ZENO_API void recycle();
+#else
+inline bool enabled() { return false; }
+inline void give(std::type_info const &, std::size_t, std::unique_ptr<Buffer>) {}
+inline std::unique_ptr<Buffer> take(std::type_info const &, std::size_t) { return nullptr; }
+#endif
+
+template <class T>
+void give_vector(std::vector<T> &&vec) {
+    std::size_t capacity = vec.capacity() * sizeof(T);
+    if (capacity < kMinPooled || !enabled())
+        return;
+    auto buf = std::make_unique<VectorBuffer<T>>();
+    buf->vec = std::move(vec);
+    buf->vec.clear();
+    give(typeid(T), capacity, std::move(buf));
+}
+
+// resize as std::vector::resize does, moving into a pooled buffer when vec has to grow
+template <class T, class ...Args>
+void resize_vector(std::vector<T> &vec, std::size_t n, Args const &...val) {
+    if (n > vec.capacity() && n * sizeof(T) >= kMinPooled && enabled()) {
+        if (auto buf = take(typeid(T), n * sizeof(T))) {
+            auto &pooled = static_cast<VectorBuffer<T> &>(*buf).vec;
+            pooled.assign(vec.begin(), vec.end());
+            give_vector(std::move(vec));
+            vec = std::move(pooled);
+        }
+    }
+    vec.resize(n, val...);
+}
+
+}
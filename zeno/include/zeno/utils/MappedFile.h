@@ -0,0 +1,43 @@
+#pragma once
+
+#include <zeno/utils/api.h>
+#include <string>
+#include <cstddef>
+
+namespace zeno {
+
+// read-only memory mapping of a whole file, pages are loaded by the OS on first touch
+struct MappedFile {
+    ZENO_API explicit MappedFile(std::string const &path);
+    ZENO_API ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+    MappedFile(MappedFile &&) = delete;
+    MappedFile &operator=(MappedFile &&) = delete;
+
+    bool valid() const {
+        return m_valid;
+    }
+
+    char const *data() const {
+        return m_data;
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+private:
+    char const *m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_valid = false;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <zeno/utils/api.h>
+#include <functional>
+#include <string>
+#include <cstddef>
+
+namespace zeno {
+
+// named shared memory segments, to hand big buffers over to another process on the
+// same machine without pushing them through a pipe or socket (POSIX only for now)
+struct SharedMemory {
+    ZENO_API static bool supported();
+
+    // create a segment of size bytes and let fill write them in place, returns its name,
+    // or empty on failure; the name is remembered until the segment is consumed or released
+    ZENO_API static std::string publish(std::size_t size, std::function<void(char *)> const &fill);
+
+    // same, holding a copy of data
+    ZENO_API static std::string publish(const char *data, std::size_t size);
+
+    // map the segment, pass its content to func, then remove the segment
+    ZENO_API static bool consume(std::string const &name, std::function<void(const char *, std::size_t)> const &func);
+
+    // number of segments published by this process which were not consumed yet
+    ZENO_API static std::size_t pendingPublished();
+
+    // wait for the consumer as long as it keeps consuming the published segments, then
+    // remove those still left, to be called before the publishing process exits
+    ZENO_API static void releasePublished(int idleTimeoutMs);
+
+    // remove the segments left behind by publishers which no longer exist (killed or
+    // crashed ones), only on linux, where the segments can be listed
+    ZENO_API static void removeOrphans();
+};
+
+}
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <mutex>
 
 namespace zeno {
 
@@ -20,8 +21,9 @@ public:
     };
 
 private:
-    static Timer *current;
+    static thread_local Timer *current;
     static std::vector<Record> records;
+    static std::mutex records_mtx;
 
     Timer *parent = nullptr;
     ClockType::time_point beg;
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <zeno/utils/vec.h>
+#include <zeno/utils/Error.h>
+#include <zeno/utils/format.h>
+#include <type_traits>
+#include <string_view>
+#include <algorithm>
+#include <charconv>
+#include <ostream>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace zeno {
+inline namespace chunked_write_h {
+
+// append-only output buffer; floats are printed in their shortest round-trip form
+struct ChunkBuffer {
+    std::string buf;
+
+    ChunkBuffer &operator<<(char c) {
+        buf.push_back(c);
+        return *this;
+    }
+
+    ChunkBuffer &operator<<(std::string_view s) {
+        buf.append(s);
+        return *this;
+    }
+
+    template <class T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    ChunkBuffer &operator<<(T v) {
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf.append(tmp, res.ptr - tmp);
+        return *this;
+    }
+
+    template <class T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    ChunkBuffer &operator<<(T v) {
+        char tmp[32];
+#if defined(__cpp_lib_to_chars)
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf.append(tmp, res.ptr - tmp);
+#else
+        buf.append(tmp, std::snprintf(tmp, sizeof(tmp), "%.9g", (double)v));
+#endif
+        return *this;
+    }
+
+    template <std::size_t N, class T>
+    ChunkBuffer &operator<<(vec<N, T> const &v) {
+        *this << v[0];
+        for (std::size_t i = 1; i < N; i++)
+            *this << ' ' << v[i];
+        return *this;
+    }
+
+    // raw bytes, for binary formats
+    template <class T>
+    ChunkBuffer &put(T const &v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buf.append((char const *)&v, sizeof(T));
+        return *this;
+    }
+};
+
+// formats items [0, n) into the stream: a batch of chunks is formatted concurrently,
+// each chunk into its own buffer, then written out in order with one call per chunk;
+// buffers are reused across batches so memory stays bounded on huge primitives.
+// throws as soon as the stream fails, rather than formatting the rest for nothing
+template <class F>
+void write_chunked(std::ostream &out, std::size_t n, F const &format, std::size_t chunk = 16384) {
+    std::vector<ChunkBuffer> bufs(32);
+    for (std::size_t base = 0; base < n; base += chunk * bufs.size()) {
+        intptr_t nb = std::min(bufs.size(), (n - base + chunk - 1) / chunk);
+#pragma omp parallel for
+        for (intptr_t b = 0; b < nb; b++) {
+            auto &cb = bufs[b];
+            cb.buf.clear();
+            std::size_t beg = base + b * chunk, end = std::min(n, beg + chunk);
+            for (std::size_t i = beg; i < end; i++) {
+                format(cb, i);
+            }
+        }
+        for (intptr_t b = 0; b < nb; b++) {
+            out.write(bufs[b].buf.data(), bufs[b].buf.size());
+        }
+        if (!out)
+            throw makeError("write_chunked: failed to write to the stream");
+    }
+}
+
+inline std::ofstream open_chunked(std::string const &path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+        throw makeError(format("cannot open file for write: {}", path));
+    return out;
+}
+
+// flushes what is still buffered, a full disk often only shows up here
+inline void close_chunked(std::ofstream &out, std::string const &path) {
+    out.close();
+    if (!out)
+        throw makeError(format("failed to write file: {}", path));
+}
+
+}
+}
@@ -12,6 +12,7 @@
 #include <zeno/extra/GlobalStatus.h>
 #include <zeno/extra/SubnetNode.h>
 #include <zeno/extra/DirtyChecker.h>
+#include <zeno/extra/GraphScheduler.h>
 #include <zeno/utils/Error.h>
 #include <zeno/utils/log.h>
 #include <iostream>
@@ -38,6 +39,8 @@ ZENO_API zany const &Graph::getNodeOutput(
 
 ZENO_API void Graph::clearNodes() {
     nodes.clear();
+    if (dirtyChecker)
+        dirtyChecker->invalidateAll();
 }
 
 ZENO_API void Graph::addNode(std::string const &cls, std::string const &id) {
@@ -75,27 +78,38 @@ ZENO_API void Graph::completeNode(std::string const &id) {
 }
 
 ZENO_API bool Graph::applyNode(std::string const &id) {
-    if (ctx->visited.find(id) != ctx->visited.end()) {
-        return false;
+    {
+        std::lock_guard lck(ctx->mtx);
+        if (!ctx->visited.insert(id).second) {
+            return false;
+        }
     }
-    ctx->visited.insert(id);
     auto node = safe_at(nodes, id, "node name").get();
     GraphException::translated([&] {
         node->doApply();
     }, node->myname);
-    if (dirtyChecker && dirtyChecker->amIDirty(id)) {
-        return true;
+    if (dirtyChecker) {
+        std::lock_guard lck(dirtyChecker->mtx);
+        return dirtyChecker->amIDirty(id);
     }
     return false;
 }
 
 ZENO_API void Graph::applyNodes(std::set<std::string> const &ids) {
     ctx = std::make_unique<Context>();
+    getDirtyChecker().beginEpoch();
 
     scope_exit _{[&] {
         ctx = nullptr;
     }};
 
+    if (GraphScheduler::numWorkers() > 0 && !GraphScheduler::isWorkerThread()) {
+        GraphScheduler sched(this);
+        sched.buildTasks(ids);
+        sched.applyTasks();
+    }
+
+    // nodes already applied by the scheduler are skipped as visited
     for (auto const &id: ids) {
         applyNode(id);
     }
@@ -109,21 +123,29 @@ ZENO_API void Graph::applyNodesToExec() {
 ZENO_API void Graph::bindNodeInput(std::string const &dn, std::string const &ds,
         std::string const &sn, std::string const &ss) {
     safe_at(nodes, dn, "node name")->inputBounds[ds] = std::pair(sn, ss);
+    if (dirtyChecker)
+        dirtyChecker->invalidate(dn);
 }
 
 ZENO_API void Graph::setNodeInput(std::string const &id, std::string const &par,
         zany const &val) {
     safe_at(nodes, id, "node name")->inputs[par] = val;
+    if (dirtyChecker)
+        dirtyChecker->invalidate(id);
 }
 
 ZENO_API void Graph::setKeyFrame(std::string const &id, std::string const &par, zany const &val) {
     safe_at(nodes, id, "node name")->inputs[par] = val;
     safe_at(nodes, id, "node name")->kframes.insert(par);
+    if (dirtyChecker)
+        dirtyChecker->invalidate(id);
 }
 
 ZENO_API void Graph::setFormula(std::string const &id, std::string const &par, zany const &val) {
     safe_at(nodes, id, "node name")->inputs[par] = val;
     safe_at(nodes, id, "node name")->formulas.insert(par);
+    if (dirtyChecker)
+        dirtyChecker->invalidate(id);
 }
 
 
@@ -30,6 +30,7 @@ ZENO_API Session *INode::getThisSession() const {
 }
 
 ZENO_API GlobalState *INode::getGlobalState() const {
+    frame_dependent = true;
     return graph->session->globalState.get();
 }
 
@@ -73,6 +74,12 @@ ZENO_API void INode::preApply() {
         requireInput(ds);
     }
 
+    auto &dc = graph->getDirtyChecker();
+    if (dc.tryReuseOutputs(this)) {
+        log_debug("==> reuse {}", myname);
+        return;
+    }
+
     log_debug("==> enter {}", myname);
     {
 #ifdef ZENO_BENCHMARKING
@@ -81,6 +88,7 @@ ZENO_API void INode::preApply() {
         apply();
     }
     log_debug("==> leave {}", myname);
+    dc.updateOutputs(this);
 }
 
 ZENO_API bool INode::requireInput(std::string const &ds) {
@@ -90,6 +98,7 @@ ZENO_API bool INode::requireInput(std::string const &ds) {
     auto [sn, ss] = it->second;
     if (graph->applyNode(sn)) {
         auto &dc = graph->getDirtyChecker();
+        std::lock_guard lck(dc.mtx);
         dc.taintThisNode(myname);
     }
     auto ref = graph->getNodeOutput(sn, ss);
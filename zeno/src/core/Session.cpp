@@ -4,6 +4,7 @@
 #include <zeno/extra/GlobalComm.h>
 #include <zeno/extra/GlobalStatus.h>
 #include <zeno/extra/EventCallbacks.h>
+#include <zeno/extra/DirtyChecker.h>
 #include <zeno/types/UserData.h>
 #include <zeno/core/Graph.h>
 #include <zeno/core/INode.h>
@@ -47,6 +48,7 @@ ZENO_API void Session::defNodeClass(std::unique_ptr<INode>(*ctor)(), std::string
         log_error("node class redefined: `{}`\n", id);
     }
     auto cls = std::make_unique<ImplNodeClass>(ctor, desc);
+    cls->memoizable = DirtyChecker::isMemoizableClass(id);
     nodeClasses.emplace(id, std::move(cls));
 }
 
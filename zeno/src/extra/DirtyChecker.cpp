@@ -0,0 +1,178 @@
+#include <zeno/extra/DirtyChecker.h>
+#include <zeno/extra/GraphScheduler.h>
+#include <zeno/types/NumericObject.h>
+#include <zeno/types/StringObject.h>
+#include <zeno/core/Graph.h>
+#include <zeno/core/INode.h>
+#include <zeno/core/Session.h>
+#include <zeno/utils/envconfig.h>
+#include <zeno/utils/log.h>
+#include <zeno/utils/string.h>
+#include <string_view>
+#include <functional>
+
+namespace zeno {
+
+namespace {
+
+inline void hashCombine(std::size_t &seed, std::size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+inline std::size_t hashBytes(void const *p, std::size_t n) {
+    return std::hash<std::string_view>{}(std::string_view((char const *)p, n));
+}
+
+}
+
+ZENO_API bool DirtyChecker::memoizeEnabled() {
+    static bool enabled = [] {
+        bool on = envconfig::getBool("MEMOIZE", false);
+        if (on)
+            log_info("node output memoization enabled");
+        return on;
+    }();
+    return enabled;
+}
+
+ZENO_API bool DirtyChecker::isMemoizableClass(std::string const &cls) {
+    static std::set<std::string> const classes = [] {
+        std::set<std::string> res{
+            "CreateCube", "CreateDisk", "CreatePlane", "CreateTube",
+            "CreateTorus", "CreateSphere", "CreateCone", "CreateCylinder",
+        };
+        for (auto const &name: split_str(envconfig::getStr("MEMOIZE_NODES"), ',')) {
+            if (!name.empty())
+                res.insert(name);
+        }
+        return res;
+    }();
+    return classes.find(cls) != classes.end();
+}
+
+ZENO_API bool DirtyChecker::hashParams(INode *node, std::size_t &hash) {
+    std::size_t seed = 0;
+    std::vector<char> buf;
+    for (auto const &[key, obj]: node->inputs) {
+        if (node->inputBounds.find(key) != node->inputBounds.end())
+            continue;  // bound inputs are covered by upstream tracking
+        hashCombine(seed, std::hash<std::string>{}(key));
+        if (auto num = dynamic_cast<NumericObject *>(obj.get())) {
+            std::visit([&] (auto const &val) {
+                hashCombine(seed, hashBytes(&val, sizeof(val)));
+            }, num->value);
+            hashCombine(seed, num->value.index());
+        } else if (auto str = dynamic_cast<StringObject *>(obj.get())) {
+            hashCombine(seed, std::hash<std::string>{}(str->value));
+        } else if (obj) {
+            buf.clear();
+            if (!encodeObject(obj.get(), buf))
+                return false;
+            hashCombine(seed, hashBytes(buf.data(), buf.size()));
+        }
+    }
+    hash = seed;
+    return true;
+}
+
+ZENO_API void DirtyChecker::beginEpoch() {
+    std::lock_guard lck(mtx);
+    epoch++;
+}
+
+// called on graph edits, the node gets applied again in the next epoch, which in
+// turn makes its consumers recompute as well
+ZENO_API void DirtyChecker::invalidate(std::string const &ident) {
+    std::lock_guard lck(mtx);
+    if (auto it = memos.find(ident); it != memos.end()) {
+        it->second.isStatic = false;
+        it->second.outputs.clear();
+    }
+}
+
+ZENO_API void DirtyChecker::invalidateAll() {
+    std::lock_guard lck(mtx);
+    memos.clear();
+}
+
+ZENO_API bool DirtyChecker::tryReuseOutputs(INode *node) {
+    if (!memoizeEnabled() || !node->nodeClass || !node->nodeClass->memoizable)
+        return false;
+    std::size_t hash;
+    if (!hashParams(node, hash))
+        return false;
+
+    std::map<std::string, zany> outputs;
+    {
+        std::lock_guard lck(mtx);
+        auto &memo = memos[node->myname];  // std::map never invalidates references on insert
+
+        // producers have been applied at this point, so their memos are up to date
+        memo.upstreamStatic = true;
+        bool upstreamChanged = false;
+        for (auto const &[ds, bound]: node->inputBounds) {
+            auto &pmemo = memos[bound.first];
+            if (!pmemo.isStatic)
+                memo.upstreamStatic = false;
+            if (pmemo.changedEpoch > memo.changedEpoch)
+                upstreamChanged = true;
+        }
+
+        if (!memo.isStatic || !memo.upstreamStatic || upstreamChanged)
+            return false;
+        if (hash != memo.paramsHash)
+            return false;
+        if (amIDirty(node->myname))
+            return false;
+        outputs = memo.outputs;
+    }
+
+    for (auto const &[key, obj]: outputs) {
+        node->outputs[key] = obj ? obj->clone() : nullptr;
+    }
+    return true;
+}
+
+ZENO_API void DirtyChecker::updateOutputs(INode *node) {
+    if (!memoizeEnabled())
+        return;
+    std::size_t hash = 0;
+    bool isStatic = node->nodeClass && node->nodeClass->memoizable
+        && !node->frame_dependent && node->kframes.empty() && node->formulas.empty()
+        && !GraphScheduler::isSerialNode(node) && hashParams(node, hash);
+    {
+        std::lock_guard lck(mtx);
+        auto &memo = memos[node->myname];
+        isStatic = isStatic && memo.upstreamStatic;
+        if (!isStatic) {
+            memo.changedEpoch = epoch;
+            memo.outputs.clear();
+            memo.isStatic = false;
+            return;
+        }
+    }
+
+    // keep pristine copies, as downstream nodes may modify the outputs in place
+    std::map<std::string, zany> outputs;
+    for (auto const &[key, obj]: node->outputs) {
+        if (!obj) {
+            outputs.emplace(key, nullptr);
+        } else if (auto newobj = obj->clone()) {
+            outputs.emplace(key, std::move(newobj));
+        } else {
+            log_debug("node {} output {} doesn't support clone, not memoized", node->myname, key);
+            outputs.clear();
+            isStatic = false;
+            break;
+        }
+    }
+
+    std::lock_guard lck(mtx);
+    auto &memo = memos[node->myname];
+    memo.changedEpoch = epoch;
+    memo.isStatic = isStatic;
+    memo.paramsHash = hash;
+    memo.outputs = std::move(outputs);
+}
+
+}
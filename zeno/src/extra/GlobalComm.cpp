@@ -2,10 +2,19 @@
 #include <zeno/extra/GlobalState.h>
 #include <zeno/funcs/ObjectCodec.h>
 #include <zeno/utils/log.h>
+#include <zeno/utils/MappedFile.h>
+#include <zeno/utils/envconfig.h>
 #include <filesystem>
 #include <algorithm>
 #include <fstream>
 #include <cassert>
+#include <cstring>
+#include <cctype>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <deque>
+#include <atomic>
 #include <zeno/types/UserData.h>
 #include <unordered_set>
 #include <zeno/types/MaterialObject.h>
@@ -18,88 +27,239 @@
 
 namespace zeno {
 
-std::vector<std::filesystem::path> cachepath(3);
 std::unordered_set<std::string> lightCameraNodes({
     "CameraEval", "CameraNode", "CihouMayaCameraFov", "ExtractCameraData", "GetAlembicCamera","MakeCamera",
     "LightNode", "BindLight", "ProceduralSky", "HDRSky",
     });
 std::string matlNode = "ShaderFinalize";
 
+namespace {
+
+// zencache v2 layout: header, entry table, key blob, then the encoded objects, each
+// aligned to kZencacheAlign so that they can be decoded straight from a mapped file
+constexpr size_t kZencacheAlign = 64;
+constexpr uint32_t kZencacheVersion = 2;
+
+struct ZencacheHeader {
+    char magic[8];          // "ZENCACHE", v1 files follow it by the key count in ascii
+    uint32_t version;
+    uint32_t numEntries;
+    uint64_t keysOffset;    // offsets are from the beginning of file
+    uint64_t dataOffset;
+    uint64_t fileSize;
+    uint64_t reserved[3];
+};
+
+struct ZencacheEntry {
+    uint64_t keyOffset;     // relative to keysOffset
+    uint64_t keySize;
+    uint64_t dataOffset;    // relative to dataOffset
+    uint64_t dataSize;
+};
+
+static_assert(sizeof(ZencacheHeader) == 64);
+
+inline size_t alignZencache(size_t n) {
+    return (n + kZencacheAlign - 1) / kZencacheAlign * kZencacheAlign;
+}
+
+// the entry table only needs the buffer sizes, so the buffers are kept as they are and
+// streamed to the file one by one, rather than being gathered into one big blob first
+struct ZencacheWriter {
+    std::vector<ZencacheEntry> entries;
+    std::string keys;
+    std::vector<std::vector<char>> bufs;
+    size_t dataSize = 0;
+
+    void append(std::string const &key, std::vector<char> &&buf) {
+        entries.push_back({keys.size(), key.size(), dataSize, buf.size()});
+        keys.append(key);
+        dataSize = alignZencache(dataSize + buf.size());
+        bufs.push_back(std::move(buf));
+    }
+
+    ZencacheHeader makeHeader() const {
+        ZencacheHeader header{};
+        std::memcpy(header.magic, "ZENCACHE", 8);
+        header.version = kZencacheVersion;
+        header.numEntries = entries.size();
+        header.keysOffset = sizeof(ZencacheHeader) + entries.size() * sizeof(ZencacheEntry);
+        header.dataOffset = alignZencache(header.keysOffset + keys.size());
+        header.fileSize = header.dataOffset + dataSize;
+        return header;
+    }
+
+    void write(std::filesystem::path const &path) {
+        auto header = makeHeader();
+        std::ofstream ofs(path, std::ios::binary);
+        ofs.write((const char *)&header, sizeof(header));
+        ofs.write((const char *)entries.data(), entries.size() * sizeof(ZencacheEntry));
+        ofs.write(keys.data(), keys.size());
+        const char padding[kZencacheAlign] = {};
+        ofs.write(padding, header.dataOffset - header.keysOffset - keys.size());
+        for (auto &buf: bufs) {
+            ofs.write(buf.data(), buf.size());
+            ofs.write(padding, alignZencache(buf.size()) - buf.size());
+            std::vector<char>().swap(buf);  // release as we go
+        }
+        if (!ofs) {
+            log_error("failed to write zencache {}", path);
+        }
+    }
+};
+
+std::filesystem::path frameCacheDir(std::string const &cachedir, int frameid) {
+    return std::filesystem::u8path(cachedir) / std::to_string(1000000 + frameid).substr(1);
+}
+
+// with ZENO_CACHE_COMPRESS=1 primitives are written packed, big arrays go to a blob store
+// shared by all frames of the cache, so that unchanged arrays are only written once.
+// each frame dir holds a hard link to every blob it uses, so the link count of a blob is
+// the number of frames using it plus one, and it is removed along with its last frame
+constexpr size_t kBlobMinSize = 256 << 10;
+constexpr char kBlobLinkExt[] = ".zenblob";
+
+std::filesystem::path blobCacheDir(std::string const &cachedir) {
+    return std::filesystem::u8path(cachedir) / "blobs";
+}
+
+// true when the frame now links to the blob
+bool linkBlob(std::filesystem::path const &blobdir, std::filesystem::path const &framedir, std::string const &name) {
+    std::error_code ec;
+    auto link = framedir / (name + kBlobLinkExt);
+    if (!std::filesystem::exists(link, ec))
+        std::filesystem::create_hard_link(blobdir / name, link, ec);
+    return std::filesystem::exists(link, ec);
+}
+
+// drops the links of a frame dir about to be removed or rewritten, and the blobs no
+// other frame links to anymore
+void unlinkBlobs(std::string const &cachedir, std::filesystem::path const &framedir) {
+    auto blobdir = blobCacheDir(cachedir);
+    std::error_code ec;
+    if (!std::filesystem::exists(framedir, ec))
+        return;
+    for (auto const &entry: std::filesystem::directory_iterator(framedir, ec)) {
+        if (entry.path().extension() != kBlobLinkExt)
+            continue;
+        auto blob = blobdir / entry.path().stem();
+        std::filesystem::remove(entry.path(), ec);
+        if (std::filesystem::exists(blob, ec) && std::filesystem::hard_link_count(blob, ec) == 1)
+            std::filesystem::remove(blob, ec);
+    }
+    if (std::filesystem::exists(blobdir, ec) && std::filesystem::is_empty(blobdir, ec))
+        std::filesystem::remove(blobdir, ec);
+}
+
+// framedir is the frame being written or read, blobs are linked into it when written and
+// looked up there first when read
+ObjectCodecOptions cacheCodecOptions(std::string const &cachedir, std::filesystem::path const &framedir) {
+    static const bool compress = envconfig::getBool("CACHE_COMPRESS");
+    ObjectCodecOptions opts;
+    auto blobdir = blobCacheDir(cachedir);
+    if (compress) {
+        opts.compress = true;
+        opts.blobMinSize = kBlobMinSize;
+        opts.reuseBlob = [blobdir, framedir] (std::string const &name) {
+            // without hard links (FAT...) blobs just stay until the cache is removed
+            return linkBlob(blobdir, framedir, name) || std::filesystem::exists(blobdir / name);
+        };
+        opts.storeBlob = [blobdir, framedir] (std::string const &name, const char *data, size_t size) {
+            auto path = blobdir / name;
+            std::error_code ec;
+            std::filesystem::create_directories(blobdir, ec);
+            // write aside then link, as several encoders may store the same blob: the first
+            // one wins, a blob already linked by some frame is never replaced
+            static std::atomic<unsigned> counter{0};
+            auto tmppath = blobdir / (name + ".tmp" + std::to_string(counter++));
+            {
+                std::ofstream ofs(tmppath, std::ios::binary);
+                ofs.write(data, size);
+                if (!ofs) {
+                    log_error("failed to write zencache blob {}", path);
+                    return;
+                }
+            }
+            std::filesystem::create_hard_link(tmppath, path, ec);
+            if (ec && !std::filesystem::exists(path))
+                std::filesystem::rename(tmppath, path, ec);
+            std::filesystem::remove(tmppath, ec);
+            linkBlob(blobdir, framedir, name);
+        };
+    }
+    // blobs are resolved whatever the current setting, caches may come from another run
+    opts.loadBlob = [blobdir, framedir] (std::string const &name, std::vector<char> &data) {
+        for (auto const &path: {framedir / (name + kBlobLinkExt), blobdir / name}) {
+            if (!std::filesystem::exists(path))
+                continue;
+            MappedFile file(path.u8string());
+            if (file.valid()) {
+                data.assign(file.data(), file.data() + file.size());
+                return true;
+            }
+        }
+        return false;
+    };
+    return opts;
+}
+
+}
+
 static void toDisk(std::string cachedir, int frameid, GlobalComm::ViewObjects &objs, bool cacheLightCameraOnly, bool cacheMaterialOnly) {
     if (cachedir.empty()) return;
-    std::filesystem::path dir = std::filesystem::u8path(cachedir + "/" + std::to_string(1000000 + frameid).substr(1));
+    std::filesystem::path dir = frameCacheDir(cachedir, frameid);
     if (!std::filesystem::exists(dir) && !std::filesystem::create_directories(dir))
     {
         log_critical("can not create path: {}", dir);
     }
-    std::vector<std::vector<char>> bufCaches(3);
-    std::vector<std::vector<size_t>> poses(3);
-    std::vector<std::string> keys(3);
+    // classify first, then encode all objects in parallel before laying out the files
+    std::vector<std::pair<int, std::string>> slots;
+    std::vector<IObject *> slotObjs;
     for (auto const &[key, obj]: objs) {
 
-        size_t bufsize =0;
         std::string nodeName = key.substr(key.find("-") + 1, key.find(":") - key.find("-") -1);
-        if (cacheLightCameraOnly && (lightCameraNodes.count(nodeName) || obj->userData().get2<int>("isL", 0) || std::dynamic_pointer_cast<CameraObject>(obj)))
+        bool isLightCamera = lightCameraNodes.count(nodeName) || obj->userData().get2<int>("isL", 0) || std::dynamic_pointer_cast<CameraObject>(obj);
+        bool isMaterial = matlNode == nodeName || std::dynamic_pointer_cast<MaterialObject>(obj);
+        if (cacheLightCameraOnly && isLightCamera)
         {
-            bufsize = bufCaches[0].size();
-            if (encodeObject(obj.get(), bufCaches[0]))
-            {
-                keys[0].push_back('\a');
-                keys[0].append(key);
-                poses[0].push_back(bufsize);
-            }
+            slots.emplace_back(0, key);
+            slotObjs.push_back(obj.get());
         }
-        if (cacheMaterialOnly && (matlNode == nodeName || std::dynamic_pointer_cast<MaterialObject>(obj)))
+        if (cacheMaterialOnly && isMaterial)
         {
-            bufsize = bufCaches[1].size();
-            if (encodeObject(obj.get(), bufCaches[1]))
-            {
-                keys[1].push_back('\a');
-                keys[1].append(key);
-                poses[1].push_back(bufsize);
-            }
+            slots.emplace_back(1, key);
+            slotObjs.push_back(obj.get());
         }
         if (!cacheLightCameraOnly && !cacheMaterialOnly)
         {
-            if (lightCameraNodes.count(nodeName) || obj->userData().get2<int>("isL", 0) || std::dynamic_pointer_cast<CameraObject>(obj)) {
-                bufsize = bufCaches[0].size();
-                if (encodeObject(obj.get(), bufCaches[0]))
-                {
-                    keys[0].push_back('\a');
-                    keys[0].append(key);
-                    poses[0].push_back(bufsize);
-                }
-            } else if (matlNode == nodeName || std::dynamic_pointer_cast<MaterialObject>(obj)) {
-                bufsize = bufCaches[1].size();
-                if (encodeObject(obj.get(), bufCaches[1]))
-                {
-                    keys[1].push_back('\a');
-                    keys[1].append(key);
-                    poses[1].push_back(bufsize);
-                }
-            } else {
-                bufsize = bufCaches[2].size();
-                if (encodeObject(obj.get(), bufCaches[2]))
-                {
-                    keys[2].push_back('\a');
-                    keys[2].append(key);
-                    poses[2].push_back(bufsize);
-                }
-            }
+            slots.emplace_back(isLightCamera ? 0 : isMaterial ? 1 : 2, key);
+            slotObjs.push_back(obj.get());
         }
     }
+    std::vector<std::vector<char>> bufs(slots.size());
+    std::vector<char> encoded(slots.size());
+    unlinkBlobs(cachedir, dir);  // in case the frame is written again
+    auto opts = cacheCodecOptions(cachedir, dir);
+#pragma omp parallel for
+    for (int k = 0; k < (int)slots.size(); k++) {
+        encoded[k] = encodeObject(slotObjs[k], bufs[k], opts);
+    }
+    std::vector<ZencacheWriter> writers(3);
+    for (size_t k = 0; k < slots.size(); k++) {
+        if (encoded[k])
+            writers[slots[k].first].append(slots[k].second, std::move(bufs[k]));
+    }
+    bufs.clear();
+    std::vector<std::filesystem::path> cachepath(3);
     cachepath[0] = dir / "lightCameraObj.zencache";
     cachepath[1] = dir / "materialObj.zencache";
     cachepath[2] = dir / "normalObj.zencache";
     size_t currentFrameSize = 0;
     for (int i = 0; i < 3; i++)
     {
-        if (poses[i].size() == 0 && (cacheLightCameraOnly && i != 0 || cacheMaterialOnly && i != 1))
+        if (writers[i].entries.size() == 0 && (cacheLightCameraOnly && i != 0 || cacheMaterialOnly && i != 1))
             continue;
-        keys[i].push_back('\a');
-        keys[i] = "ZENCACHE" + std::to_string(poses[i].size()) + keys[i];
-        poses[i].push_back(bufCaches[i].size());
-        currentFrameSize += keys[i].size() + poses[i].size() * sizeof(size_t) + bufCaches[i].size();
+        currentFrameSize += writers[i].makeHeader().fileSize;
     }
     size_t freeSpace = 0;
     #ifdef __linux__
@@ -126,26 +286,53 @@ static void toDisk(std::string cachedir, int frameid, GlobalComm::ViewObjects &o
     }
     for (int i = 0; i < 3; i++)
     {
-        if (poses[i].size() == 0 && (cacheLightCameraOnly && i != 0 || cacheMaterialOnly && i != 1))
+        if (writers[i].entries.size() == 0 && (cacheLightCameraOnly && i != 0 || cacheMaterialOnly && i != 1))
             continue;
         log_critical("dump cache to disk {}", cachepath[i]);
-        std::ofstream ofs(cachepath[i], std::ios::binary);
-        std::ostreambuf_iterator<char> oit(ofs);
-        std::copy(keys[i].begin(), keys[i].end(), oit);
-        std::copy_n((const char *)poses[i].data(), poses[i].size() * sizeof(size_t), oit);
-        std::copy(bufCaches[i].begin(), bufCaches[i].end(), oit);
+        writers[i].write(cachepath[i]);
     }
     objs.clear();
 }
 
-static bool fromDisk(std::string cachedir, int frameid, GlobalComm::ViewObjects &objs) {
+static bool fromDiskLegacy(MappedFile const &dat, GlobalComm::ViewObjects &objs, ObjectCodecOptions const &opts) {
+    size_t pos = std::find(dat.data() + 8, dat.data() + dat.size(), '\a') - dat.data();
+    if (pos == dat.size()) {
+        log_error("zeno cache file broken (2)");
+        return false;
+    }
+    size_t keyscount = std::stoi(std::string(dat.data() + 8, pos - 8));
+    pos = pos + 1;
+    std::vector<std::string> keys;
+    for (int k = 0; k < keyscount; k++) {
+        size_t newpos = std::find(dat.data() + pos, dat.data() + dat.size(), '\a') - dat.data();
+        if (newpos == dat.size()) {
+            log_error("zeno cache file broken (3.{})", k);
+            return false;
+        }
+        keys.emplace_back(dat.data() + pos, newpos - pos);
+        pos = newpos + 1;
+    }
+    std::vector<size_t> poses(keyscount + 1);
+    std::copy_n(dat.data() + pos, (keyscount + 1) * sizeof(size_t), (char *)poses.data());
+    pos += (keyscount + 1) * sizeof(size_t);
+    for (int k = 0; k < keyscount; k++) {
+        if (poses[k] > dat.size() - pos || poses[k + 1] < poses[k]) {
+            log_error("zeno cache file broken (4.{})", k);
+        }
+        const char *p = dat.data() + pos + poses[k];
+        objs.try_emplace(keys[k], decodeObject(p, poses[k + 1] - poses[k], opts));
+    }
+    return true;
+}
+
+static bool fromDisk(std::string cachedir, int frameid, GlobalComm::ViewObjects &objs, GlobalComm::LazyViewObjects &lazyObjs) {
     if (cachedir.empty())
         return false;
     objs.clear();
-    cachepath[2] = std::filesystem::u8path(cachedir) / std::to_string(1000000 + frameid).substr(1) / "normalObj.zencache";
-    cachepath[1] = std::filesystem::u8path(cachedir) / std::to_string(1000000 + frameid).substr(1) / "materialObj.zencache";
-    cachepath[0] = std::filesystem::u8path(cachedir) / std::to_string(1000000 + frameid).substr(1) / "lightCameraObj.zencache";
-    for (auto path : cachepath)
+    lazyObjs.clear();
+    auto dir = frameCacheDir(cachedir, frameid);
+    lazyObjs.codecOptions = cacheCodecOptions(cachedir, dir);
+    for (auto path : {dir / "lightCameraObj.zencache", dir / "materialObj.zencache", dir / "normalObj.zencache"})
     {
         if (!std::filesystem::exists(path))
         {
@@ -153,53 +340,159 @@ static bool fromDisk(std::string cachedir, int frameid, GlobalComm::ViewObjects
         }
         log_critical("load cache from disk {}", path);
 
-        auto szBuffer = std::filesystem::file_size(path);
-        std::vector<char> dat(szBuffer);
-        FILE *fp = fopen(path.string().c_str(), "rb");
-        if (!fp) {
+        auto file = std::make_shared<MappedFile>(path.u8string());
+        if (!file->valid()) {
             log_error("zeno cache file does not exist");
             return false;
         }
-        size_t ret = fread(&dat[0], 1, szBuffer, fp);
-        assert(ret == szBuffer);
-        fclose(fp);
-        fp = nullptr;
-
+        auto const &dat = *file;
         if (dat.size() <= 8 || std::string(dat.data(), 8) != "ZENCACHE") {
             log_error("zeno cache file broken (1)");
             return false;
         }
-        size_t pos = std::find(dat.begin() + 8, dat.end(), '\a') - dat.begin();
-        if (pos == dat.size()) {
+        if (std::isdigit((unsigned char)dat.data()[8])) {
+            // v1 cache, written before the indexed layout, decode everything at once
+            if (!fromDiskLegacy(dat, objs, lazyObjs.codecOptions))
+                return false;
+            continue;
+        }
+
+        ZencacheHeader header;
+        if (dat.size() < sizeof(header)) {
             log_error("zeno cache file broken (2)");
             return false;
         }
-        size_t keyscount = std::stoi(std::string(dat.data() + 8, pos - 8));
-        pos = pos + 1;
-        std::vector<std::string> keys;
-        for (int k = 0; k < keyscount; k++) {
-            size_t newpos = std::find(dat.begin() + pos, dat.end(), '\a') - dat.begin();
-            if (newpos == dat.size()) {
+        std::memcpy(&header, dat.data(), sizeof(header));
+        if (header.version != kZencacheVersion || header.fileSize > dat.size()
+            || header.keysOffset < sizeof(header) + header.numEntries * sizeof(ZencacheEntry)
+            || header.dataOffset < header.keysOffset || header.dataOffset > header.fileSize) {
+            log_error("zeno cache file broken or of unsupported version {}", header.version);
+            return false;
+        }
+        auto entries = (ZencacheEntry const *)(dat.data() + sizeof(header));
+        for (uint32_t k = 0; k < header.numEntries; k++) {
+            auto const &ent = entries[k];
+            if (header.keysOffset + ent.keyOffset + ent.keySize > header.dataOffset
+                || header.dataOffset + ent.dataOffset + ent.dataSize > header.fileSize) {
                 log_error("zeno cache file broken (3.{})", k);
                 return false;
             }
-            keys.emplace_back(dat.data() + pos, newpos - pos);
-            pos = newpos + 1;
-        }
-        std::vector<size_t> poses(keyscount + 1);
-        std::copy_n(dat.data() + pos, (keyscount + 1) * sizeof(size_t), (char *)poses.data());
-        pos += (keyscount + 1) * sizeof(size_t);
-        for (int k = 0; k < keyscount; k++) {
-            if (poses[k] > dat.size() - pos || poses[k + 1] < poses[k]) {
-                log_error("zeno cache file broken (4.{})", k);
-            }
-            const char *p = dat.data() + pos + poses[k];
-            objs.try_emplace(keys[k], decodeObject(p, poses[k + 1] - poses[k]));
+            std::string key(dat.data() + header.keysOffset + ent.keyOffset, ent.keySize);
+            lazyObjs.entries.try_emplace(std::move(key), GlobalComm::LazyViewObjects::Entry{
+                file, header.dataOffset + ent.dataOffset, ent.dataSize});
         }
     }
     return true;
 }
 
+ZENO_API void GlobalComm::LazyViewObjects::clear() {
+    entries.clear();
+}
+
+ZENO_API std::shared_ptr<IObject> GlobalComm::LazyViewObjects::decode(std::string const &key) {
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return nullptr;
+    auto const &ent = it->second;
+    auto obj = decodeObject(ent.file->data() + ent.offset, ent.size, codecOptions);
+    entries.erase(it);  // the mapping is released along with the last entry of a file
+    return obj;
+}
+
+// write-behind queue for dumpFrameCache: the simulation hands off a frame and goes on
+// with the next one, it only blocks when the writer falls behind by a full queue
+struct GlobalComm::CacheWriter {
+    struct Job {
+        std::string cachedir;
+        int frameid = 0;
+        ViewObjects objs;
+        bool cacheLightCameraOnly = false;
+        bool cacheMaterialOnly = false;
+        std::function<void()> onFinish;
+    };
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Job> jobs;
+    std::multiset<int> pending;  // queued or being written
+    size_t capacity;
+    bool stopping = false;
+    std::thread thread;
+
+    CacheWriter() : capacity(std::max(envconfig::getInt("CACHE_QUEUE", 2), 0)) {}
+
+    ~CacheWriter() {
+        {
+            std::lock_guard lck(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    static void write(Job &job) {
+        toDisk(job.cachedir, job.frameid, job.objs, job.cacheLightCameraOnly, job.cacheMaterialOnly);
+        if (job.onFinish)
+            job.onFinish();
+    }
+
+    void push(Job job) {
+        if (capacity == 0) {
+            write(job);
+            return;
+        }
+        {
+            std::unique_lock lck(mtx);
+            cv.wait(lck, [&] { return jobs.size() < capacity; });
+            if (!thread.joinable())
+                thread = std::thread([this] { workerLoop(); });
+            pending.insert(job.frameid);
+            jobs.push_back(std::move(job));
+        }
+        cv.notify_all();
+    }
+
+    void workerLoop() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock lck(mtx);
+                cv.wait(lck, [&] { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            cv.notify_all();  // wake up a blocked push
+            try {
+                write(job);
+            } catch (std::exception const &e) {
+                log_error("failed to dump frame {} to cache: {}", job.frameid, e.what());
+            }
+            {
+                std::lock_guard lck(mtx);
+                pending.erase(pending.find(job.frameid));
+            }
+            cv.notify_all();
+        }
+    }
+
+    void waitFrame(int frameid) {
+        std::unique_lock lck(mtx);
+        cv.wait(lck, [&] { return !pending.count(frameid); });
+    }
+
+    void waitAll() {
+        std::unique_lock lck(mtx);
+        cv.wait(lck, [&] { return pending.empty(); });
+    }
+};
+
+ZENO_API GlobalComm::GlobalComm() : m_writer(std::make_unique<CacheWriter>()) {}
+
+ZENO_API GlobalComm::~GlobalComm() = default;
+
 ZENO_API void GlobalComm::newFrame() {
     std::lock_guard lck(m_mtx);
     log_debug("GlobalComm::newFrame {}", m_frames.size());
@@ -214,13 +507,27 @@ ZENO_API void GlobalComm::finishFrame() {
     m_maxPlayFrame += 1;
 }
 
-ZENO_API void GlobalComm::dumpFrameCache(int frameid, bool cacheLightCameraOnly, bool cacheMaterialOnly) {
-    std::lock_guard lck(m_mtx);
-    int frameIdx = frameid - beginFrameNumber;
-    if (frameIdx >= 0 && frameIdx < m_frames.size()) {
-        log_debug("dumping frame {}", frameid);
-        toDisk(cacheFramePath, frameid, m_frames[frameIdx].view_objects, cacheLightCameraOnly, cacheMaterialOnly);
+ZENO_API void GlobalComm::dumpFrameCache(int frameid, bool cacheLightCameraOnly, bool cacheMaterialOnly,
+                                         std::function<void()> onFinish) {
+    CacheWriter::Job job;
+    job.frameid = frameid;
+    job.cacheLightCameraOnly = cacheLightCameraOnly;
+    job.cacheMaterialOnly = cacheMaterialOnly;
+    job.onFinish = std::move(onFinish);
+    {
+        std::lock_guard lck(m_mtx);
+        int frameIdx = frameid - beginFrameNumber;
+        if (frameIdx >= 0 && frameIdx < m_frames.size() && !cacheFramePath.empty()) {
+            log_debug("dumping frame {}", frameid);
+            job.cachedir = cacheFramePath;
+            std::swap(job.objs, m_frames[frameIdx].view_objects);
+        }
     }
+    m_writer->push(std::move(job));
+}
+
+ZENO_API void GlobalComm::flushFrameCache() {
+    m_writer->waitAll();
 }
 
 ZENO_API void GlobalComm::addViewObject(std::string const &key, std::shared_ptr<IObject> object) {
@@ -231,6 +538,7 @@ ZENO_API void GlobalComm::addViewObject(std::string const &key, std::shared_ptr<
 }
 
 ZENO_API void GlobalComm::clearState() {
+    m_writer->waitAll();
     std::lock_guard lck(m_mtx);
     m_frames.clear();
     m_inCacheFrames.clear();
@@ -241,6 +549,7 @@ ZENO_API void GlobalComm::clearState() {
 
 ZENO_API void GlobalComm::clearFrameState()
 {
+    m_writer->waitAll();
     std::lock_guard lck(m_mtx);
     m_frames.clear();
     m_inCacheFrames.clear();
@@ -285,16 +594,17 @@ ZENO_API GlobalComm::ViewObjects const *GlobalComm::getViewObjects(const int fra
     return _getViewObjects(frameid);
 }
 
-GlobalComm::ViewObjects const* GlobalComm::_getViewObjects(const int frameid) {
+bool GlobalComm::_loadFrame(const int frameid) {
     int frameIdx = frameid - beginFrameNumber;
     if (frameIdx < 0 || frameIdx >= m_frames.size())
-        return nullptr;
+        return false;
     if (maxCachedFrames != 0) {
         // load back one gc:
         if (!m_inCacheFrames.count(frameid)) {  // notinmem then cacheit
-            bool ret = fromDisk(cacheFramePath, frameid, m_frames[frameIdx].view_objects);
+            m_writer->waitFrame(frameid);
+            bool ret = fromDisk(cacheFramePath, frameid, m_frames[frameIdx].view_objects, m_frames[frameIdx].lazy_objects);
             if (!ret)
-                return nullptr;
+                return false;
 
             m_inCacheFrames.insert(frameid);
             // and dump one as balance:
@@ -305,6 +615,7 @@ GlobalComm::ViewObjects const* GlobalComm::_getViewObjects(const int frameid) {
                         // so, there is no need to dump.
                         //toDisk(cacheFramePath, i, m_frames[i - beginFrameNumber].view_objects);
                         m_frames[i - beginFrameNumber].view_objects.clear();
+                        m_frames[i - beginFrameNumber].lazy_objects.clear();
                         m_inCacheFrames.erase(i);
                         break;
                     }
@@ -312,7 +623,18 @@ GlobalComm::ViewObjects const* GlobalComm::_getViewObjects(const int frameid) {
             }
         }
     }
-    return &m_frames[frameIdx].view_objects;
+    return true;
+}
+
+GlobalComm::ViewObjects const* GlobalComm::_getViewObjects(const int frameid) {
+    if (!_loadFrame(frameid))
+        return nullptr;
+    auto &frame = m_frames[frameid - beginFrameNumber];
+    while (!frame.lazy_objects.entries.empty()) {
+        auto key = frame.lazy_objects.entries.begin()->first;
+        frame.view_objects.try_emplace(key, frame.lazy_objects.decode(key));
+    }
+    return &frame.view_objects;
 }
 
 ZENO_API GlobalComm::ViewObjects const &GlobalComm::getViewObjects() {
@@ -323,7 +645,8 @@ ZENO_API GlobalComm::ViewObjects const &GlobalComm::getViewObjects() {
 ZENO_API bool GlobalComm::load_objects(
         const int frameid,
         const std::function<bool(std::map<std::string, std::shared_ptr<zeno::IObject>> const& objs)>& callback,
-        bool& isFrameValid)
+        bool& isFrameValid,
+        const std::function<bool(std::string const& key)>& needObject)
 {
     if (!callback)
         return false;
@@ -340,6 +663,23 @@ ZENO_API bool GlobalComm::load_objects(
 
     isFrameValid = true;
     bool inserted = false;
+    if (needObject && _loadFrame(frameid)) {
+        // only decode the objects the caller doesn't have yet, the others are passed as null
+        auto &frameData = m_frames[frame];
+        auto objs = frameData.view_objects.m_curr;
+        for (auto it = frameData.lazy_objects.entries.begin(); it != frameData.lazy_objects.entries.end();) {
+            auto key = (it++)->first;
+            if (needObject(key)) {
+                auto obj = frameData.lazy_objects.decode(key);
+                frameData.view_objects.try_emplace(key, obj);
+                objs.try_emplace(key, std::move(obj));
+            } else {
+                objs.try_emplace(key, nullptr);
+            }
+        }
+        zeno::log_trace("load_objects: {} objects at frame {}", objs.size(), frameid);
+        return callback(objs);
+    }
     auto const* viewObjs = _getViewObjects(frameid);
     if (viewObjs) {
         zeno::log_trace("load_objects: {} objects at frame {}", viewObjs->size(), frameid);
@@ -392,6 +732,7 @@ ZENO_API std::string GlobalComm::cachePath()
 
 ZENO_API bool GlobalComm::removeCache(int frame)
 {
+    m_writer->waitAll();
     std::lock_guard lck(m_mtx);
     bool hasZencacheOnly = true;
     std::filesystem::path dirToRemove = std::filesystem::u8path(cacheFramePath + "/" + std::to_string(1000000 + frame).substr(1));
@@ -400,7 +741,7 @@ ZENO_API bool GlobalComm::removeCache(int frame)
         for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(dirToRemove))
         {
             std::string filePath = entry.path().string();
-            if (std::filesystem::is_directory(entry.path()) || filePath.substr(filePath.size() - 9) != ".zencache")
+            if (std::filesystem::is_directory(entry.path()) || filePath.substr(filePath.size() - 9) != ".zencache" && entry.path().extension() != kBlobLinkExt)
             {
                 hasZencacheOnly = false;
                 break;
@@ -409,6 +750,7 @@ ZENO_API bool GlobalComm::removeCache(int frame)
         if (hasZencacheOnly)
         {
             m_frames[frame - beginFrameNumber].frame_state = FRAME_BROKEN;
+            unlinkBlobs(cacheFramePath, dirToRemove);
             std::filesystem::remove_all(dirToRemove);
             zeno::log_info("remove dir: {}", dirToRemove);
         }
@@ -423,6 +765,7 @@ ZENO_API bool GlobalComm::removeCache(int frame)
 
 ZENO_API void GlobalComm::removeCachePath()
 {
+    m_writer->waitAll();
     std::lock_guard lck(m_mtx);
     std::filesystem::path dirToRemove = std::filesystem::u8path(cacheFramePath);
     if (std::filesystem::exists(dirToRemove) && cacheFramePath.find(".") == std::string::npos)
@@ -1,5 +1,6 @@
 #include <zeno/extra/GlobalState.h>
 #include <zeno/extra/GlobalComm.h>
+#include <zeno/utils/FrameHeap.h>
 #include <zeno/utils/logger.h>
 
 namespace zeno {
@@ -33,6 +34,7 @@ ZENO_API void GlobalState::frameBegin() {
 
 ZENO_API void GlobalState::frameEnd() {
     frameid++;
+    frame_heap::recycle();
 }
 
 ZENO_API void GlobalState::clearState() {
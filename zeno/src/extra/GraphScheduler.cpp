@@ -0,0 +1,297 @@
+#include <zeno/extra/GraphScheduler.h>
+#include <zeno/extra/ContextManaged.h>
+#include <zeno/extra/DirtyChecker.h>
+#include <zeno/extra/SubnetNode.h>
+#include <zeno/core/Descriptor.h>
+#include <zeno/core/Session.h>
+#include <zeno/core/Graph.h>
+#include <zeno/core/INode.h>
+#include <zeno/utils/envconfig.h>
+#include <zeno/utils/safe_at.h>
+#include <zeno/utils/log.h>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <exception>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <deque>
+
+namespace zeno {
+
+namespace {
+
+thread_local int tls_workerId = -1;
+
+struct WorkStealingPool {
+    struct Queue {
+        std::mutex mtx;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_sleepMtx;
+    std::condition_variable m_sleepCv;
+    std::atomic<size_t> m_numQueued{0};
+    std::atomic<size_t> m_nextQueue{0};
+
+    explicit WorkStealingPool(int nworkers) {
+        for (int i = 0; i < nworkers; i++) {
+            m_queues.push_back(std::make_unique<Queue>());
+        }
+        for (int i = 0; i < nworkers; i++) {
+            m_threads.emplace_back([this, i] { workerLoop(i); });
+            m_threads.back().detach();  // pool lives until process exit
+        }
+    }
+
+    void submit(std::function<void()> task) {
+        // workers push to their own queue (good locality for chains), others round-robin
+        size_t qid = tls_workerId >= 0 ? tls_workerId : m_nextQueue++ % m_queues.size();
+        {
+            std::lock_guard lck(m_queues[qid]->mtx);
+            m_queues[qid]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard lck(m_sleepMtx);
+            m_numQueued++;
+        }
+        m_sleepCv.notify_one();
+    }
+
+    bool tryPop(size_t id, std::function<void()> &task) {
+        {
+            auto &q = *m_queues[id];
+            std::lock_guard lck(q.mtx);
+            if (!q.tasks.empty()) {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+                m_numQueued--;
+                return true;
+            }
+        }
+        for (size_t k = 1; k < m_queues.size(); k++) {
+            auto &q = *m_queues[(id + k) % m_queues.size()];
+            std::lock_guard lck(q.mtx);
+            if (!q.tasks.empty()) {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                m_numQueued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(int id) {
+        tls_workerId = id;
+        std::function<void()> task;
+        while (true) {
+            if (tryPop(id, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock lck(m_sleepMtx);
+            m_sleepCv.wait(lck, [&] { return m_numQueued > 0; });
+        }
+    }
+};
+
+WorkStealingPool &getPool() {
+    static WorkStealingPool *pool = new WorkStealingPool(GraphScheduler::numWorkers());
+    return *pool;
+}
+
+bool hasCategory(INode *node, std::initializer_list<const char *> cats) {
+    if (!node->nodeClass || !node->nodeClass->desc)
+        return false;
+    for (auto const &cate: node->nodeClass->desc->categories) {
+        for (auto const *cat: cats) {
+            if (cate == cat)
+                return true;
+        }
+    }
+    return false;
+}
+
+}
+
+ZENO_API int GraphScheduler::numWorkers() {
+    static int nworkers = [] {
+        int n = envconfig::getInt("PARALLEL_EXEC", 0);
+        if (n > 0)
+            log_info("parallel graph execution enabled with {} workers", n);
+        return std::max(n, 0);
+    }();
+    return nworkers;
+}
+
+ZENO_API bool GraphScheduler::isWorkerThread() {
+    return tls_workerId >= 0;
+}
+
+// lazy nodes decide themselves which inputs to evaluate and when (loops, branches,
+// caches), so their upstream must not be evaluated ahead of time
+ZENO_API bool GraphScheduler::isLazyNode(INode *node) {
+    if (dynamic_cast<ContextManagedNode *>(node))
+        return true;
+    return hasCategory(node, {"control", "lifecycle", "subgraph", "deprecated"});
+}
+
+// serial nodes touch state shared across the graph or session (portals, view objects,
+// subgraphs, formula evaluation), they and their downstream keep the serial order
+ZENO_API bool GraphScheduler::isSerialNode(INode *node) {
+    if (isLazyNode(node))
+        return true;
+    if (dynamic_cast<SubnetNode *>(node))
+        return true;
+    if (!node->formulas.empty())
+        return true;
+    return hasCategory(node, {"layout"});
+}
+
+bool GraphScheduler::collect(std::string const &id) {
+    if (auto it = m_lut.find(id); it != m_lut.end())
+        return it->second >= 0;
+    m_lut.emplace(id, -1);  // also breaks cycles
+    auto node = safe_at(graph->nodes, id, "node name").get();
+    if (isLazyNode(node))
+        return false;
+
+    bool eligible = !isSerialNode(node);
+    std::vector<int> producers;
+    for (auto const &[ds, bound]: node->inputBounds) {
+        if (!collect(bound.first)) {
+            eligible = false;
+        } else {
+            producers.push_back(m_lut.at(bound.first));
+        }
+    }
+    if (!eligible)
+        return false;
+
+    // tasks are appended in post-order, which is exactly the serial execution order
+    int tid = tasks.size();
+    auto &task = tasks.emplace_back();
+    task.node = node;
+    std::sort(producers.begin(), producers.end());
+    producers.erase(std::unique(producers.begin(), producers.end()), producers.end());
+    task.producers = std::move(producers);
+    m_lut[id] = tid;
+    return true;
+}
+
+ZENO_API void GraphScheduler::buildTasks(std::set<std::string> const &ids) {
+    tasks.clear();
+    m_lut.clear();
+    for (auto const &id: ids) {
+        collect(id);
+    }
+
+    for (int tid = 0; tid < tasks.size(); tid++) {
+        for (int pid: tasks[tid].producers) {
+            tasks[pid].consumers.push_back(tid);
+        }
+    }
+    for (auto &task: tasks) {
+        task.successors = task.consumers;
+    }
+    // nodes often modify their input objects in place, and may pass them on as outputs,
+    // so an object made by a task can reach any of its transitive consumers: all the tasks
+    // an object may reach keep their serial order relative to each other. producers come
+    // before their consumers in tasks, so origins are complete when a task is visited
+    std::vector<std::vector<int>> origins(tasks.size());  // tasks whose objects may reach this one
+    std::vector<std::vector<int>> reached(tasks.size());  // tasks the objects of this one may reach
+    for (int tid = 0; tid < tasks.size(); tid++) {
+        auto &orig = origins[tid];
+        for (int pid: tasks[tid].producers) {
+            orig.push_back(pid);
+            orig.insert(orig.end(), origins[pid].begin(), origins[pid].end());
+        }
+        std::sort(orig.begin(), orig.end());
+        orig.erase(std::unique(orig.begin(), orig.end()), orig.end());
+        for (int oid: orig) {
+            reached[oid].push_back(tid);
+        }
+    }
+    for (auto const &group: reached) {
+        for (size_t k = 1; k < group.size(); k++) {
+            tasks[group[k - 1]].successors.push_back(group[k]);
+        }
+    }
+    for (auto &task: tasks) {
+        std::sort(task.successors.begin(), task.successors.end());
+        task.successors.erase(std::unique(task.successors.begin(), task.successors.end()), task.successors.end());
+    }
+}
+
+ZENO_API void GraphScheduler::applyTasks() {
+    if (tasks.empty())
+        return;
+    log_debug("{} nodes to exec in parallel", tasks.size());
+
+    auto &pool = getPool();
+    auto &dc = graph->getDirtyChecker();
+
+    std::vector<std::atomic<int>> indegs(tasks.size());
+    for (auto &task: tasks) {
+        for (int sid: task.successors) {
+            indegs[sid]++;
+        }
+    }
+
+    std::mutex doneMtx;
+    std::condition_variable doneCv;
+    size_t numDone = 0;
+    std::exception_ptr firstError;
+    std::atomic<bool> failed{false};
+
+    std::function<void(int)> launch = [&] (int tid) {
+        pool.submit([&, tid] {
+            auto const &task = tasks[tid];
+            if (!failed) {
+                try {
+                    if (graph->applyNode(task.node->myname)) {
+                        std::lock_guard lck(dc.mtx);
+                        for (int cid: task.consumers) {
+                            dc.taintThisNode(tasks[cid].node->myname);
+                        }
+                    }
+                } catch (...) {
+                    std::lock_guard lck(doneMtx);
+                    if (!firstError)
+                        firstError = std::current_exception();
+                    failed = true;
+                }
+            }
+            for (int sid: task.successors) {
+                if (--indegs[sid] == 0)
+                    launch(sid);
+            }
+            std::lock_guard lck(doneMtx);
+            if (++numDone == tasks.size())
+                doneCv.notify_all();
+        });
+    };
+
+    // collect roots before launching any, as running tasks already decrement indegs
+    std::vector<int> roots;
+    for (int tid = 0; tid < tasks.size(); tid++) {
+        if (indegs[tid] == 0)
+            roots.push_back(tid);
+    }
+    for (int tid: roots) {
+        launch(tid);
+    }
+    {
+        std::unique_lock lck(doneMtx);
+        doneCv.wait(lck, [&] { return numDone == tasks.size(); });
+    }
+    if (firstError)
+        std::rethrow_exception(firstError);
+}
+
+}
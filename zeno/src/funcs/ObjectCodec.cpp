@@ -25,6 +25,7 @@ enum class ObjectType : int32_t {
 
 struct ObjectHeader {
     constexpr static uint32_t kMagicNumber = 0xc0febabe;
+    constexpr static uint32_t kMagicNumberPacked = 0xc0febac0;  // see ObjectCodecOptions
 
     uint32_t magicNumber;
     ObjectType type;
@@ -39,15 +40,20 @@ namespace _implObjectCodec {
 
 #define _PER_OBJECT_TYPE(TypeName, ...) \
 std::shared_ptr<TypeName> decode##TypeName(const char *it); \
-bool encode##TypeName(TypeName const *obj, std::back_insert_iterator<std::vector<char>> it);
+bool encode##TypeName(TypeName const *obj, std::vector<char> &out);
 ZENO_XMACRO_IObject(_PER_OBJECT_TYPE)
 #undef _PER_OBJECT_TYPE
 
+std::shared_ptr<PrimitiveObject> decodePrimitiveObjectPacked(const char *it, ObjectCodecOptions const &opts);
+bool encodePrimitiveObjectPacked(PrimitiveObject const *obj, std::vector<char> &out, ObjectCodecOptions const &opts);
+size_t encodedSizePrimitiveObject(PrimitiveObject const *obj, std::vector<char> &mtlbuf);
+void writePrimitiveObject(PrimitiveObject const *obj, std::vector<char> const &mtlbuf, char *p);
+
 }
 
 using namespace _implObjectCodec;
 
-static std::shared_ptr<IObject> _decodeObjectImpl(const char *buf, size_t len) {
+static std::shared_ptr<IObject> _decodeObjectImpl(const char *buf, size_t len, ObjectCodecOptions const &opts) {
     if (len < sizeof(ObjectHeader)) {
         log_error("data too short, giving up");
         return nullptr;
@@ -55,7 +61,12 @@ static std::shared_ptr<IObject> _decodeObjectImpl(const char *buf, size_t len) {
     auto &header = *(ObjectHeader *)buf;
     auto it = buf + sizeof(ObjectHeader);
 
-    if (0) {
+    if (header.magicNumber == ObjectHeader::kMagicNumberPacked) {
+        if (header.type == ObjectType::PrimitiveObject)
+            return decodePrimitiveObjectPacked(it, opts);
+        log_error("invalid packed object header type {}", (int)header.type);
+        return nullptr;
+    } else if (0) {
 
 #define _PER_OBJECT_TYPE(TypeName, ...) \
     } else if (header.type == ObjectType::TypeName) { \
@@ -70,13 +81,19 @@ ZENO_XMACRO_IObject(_PER_OBJECT_TYPE)
 }
 
 std::shared_ptr<IObject> decodeObject(const char *buf, size_t len) {
+    return decodeObject(buf, len, ObjectCodecOptions{});
+}
+
+std::shared_ptr<IObject> decodeObject(const char *buf, size_t len, ObjectCodecOptions const &opts) {
     auto &header = *(ObjectHeader *)buf;
-    if (header.magicNumber != ObjectHeader::kMagicNumber) {
+    if (header.magicNumber != ObjectHeader::kMagicNumber && header.magicNumber != ObjectHeader::kMagicNumberPacked) {
         log_error("object header magic number mismatch");
         return nullptr;
     }
 
-    auto object = _decodeObjectImpl(buf, len);
+    auto object = _decodeObjectImpl(buf, len, opts);
+    if (!object)
+        return nullptr;
 
     auto ptr = buf + header.beginUserData;
     for (int i = 0; i < header.numUserData; i++) {
@@ -90,7 +107,7 @@ std::shared_ptr<IObject> decodeObject(const char *buf, size_t len) {
         ptr += keysize;
 
         auto decolen = valbufsize > keysize ? valbufsize - keysize : 0;
-        auto val = decodeObject(ptr, decolen);
+        auto val = decodeObject(ptr, decolen, opts);
         if (val)
             object->userData().set(key, std::move(val));
 
@@ -100,18 +117,27 @@ std::shared_ptr<IObject> decodeObject(const char *buf, size_t len) {
     return object;
 }
 
-static bool _encodeObjectImpl(IObject const *object, std::vector<char> &buf) {
+static bool _encodeObjectImpl(IObject const *object, std::vector<char> &buf, ObjectCodecOptions const &opts) {
     auto it = std::back_inserter(buf);
     ObjectHeader header;
     header.magicNumber = ObjectHeader::kMagicNumber;
 
+    if (opts.compress || opts.blobMinSize) {
+        if (auto obj = dynamic_cast<PrimitiveObject const *>(object)) {
+            header.magicNumber = ObjectHeader::kMagicNumberPacked;
+            header.type = ObjectType::PrimitiveObject;
+            it = std::copy_n((char *)&header, sizeof(ObjectHeader), it);
+            return encodePrimitiveObjectPacked(obj, buf, opts);
+        }
+    }
+
     if (0) {
 
 #define _PER_OBJECT_TYPE(TypeName, ...) \
     } else if (auto obj = dynamic_cast<TypeName const *>(object)) { \
         header.type = ObjectType::TypeName; \
         it = std::copy_n((char *)&header, sizeof(ObjectHeader), it); \
-        return encode##TypeName(obj, it);
+        return encode##TypeName(obj, buf);
 ZENO_XMACRO_IObject(_PER_OBJECT_TYPE)
 #undef _PER_OBJECT_TYPE
 
@@ -122,28 +148,80 @@ ZENO_XMACRO_IObject(_PER_OBJECT_TYPE)
 }
 
 bool encodeObject(IObject const *object, std::vector<char> &buf) {
-    auto oldsize = buf.size();
-    if (!_encodeObjectImpl(object, buf))
-        return false;
+    return encodeObject(object, buf, ObjectCodecOptions{});
+}
 
+// each entry is the key size, the key, then the encoded value
+static std::vector<std::vector<char>> _encodeUserData(IObject const *object, ObjectCodecOptions const &opts) {
     std::vector<std::vector<char>> valbufs;
     for (auto const &[key, val]: object->userData()) {
         std::vector<char> valbuf;
         size_t keysize = key.size();
         valbuf.insert(valbuf.end(), (char *)&keysize, (char *)(&keysize + 1));
         valbuf.insert(valbuf.end(), key.begin(), key.end());
-        if (encodeObject(val.get(), valbuf))
+        if (encodeObject(val.get(), valbuf, opts))
             valbufs.push_back(std::move(valbuf));
     }
+    return valbufs;
+}
+
+static char *_writeUserData(std::vector<std::vector<char>> const &valbufs, char *p) {
+    for (auto const &valbuf: valbufs) {
+        size_t valbufsize = valbuf.size();
+        std::memcpy(p, &valbufsize, sizeof(valbufsize));
+        p += sizeof(valbufsize);
+        std::memcpy(p, valbuf.data(), valbuf.size());
+        p += valbuf.size();
+    }
+    return p;
+}
+
+bool encodeObject(IObject const *object, std::vector<char> &buf, ObjectCodecOptions const &opts) {
+    auto oldsize = buf.size();
+    if (!_encodeObjectImpl(object, buf, opts))
+        return false;
+
+    auto valbufs = _encodeUserData(object, opts);
     auto &header = *(ObjectHeader *)(buf.data() + oldsize);
     header.numUserData = valbufs.size();
     header.beginUserData = buf.size() - oldsize;
+    size_t base = buf.size(), size = base;
     for (auto const &valbuf: valbufs) {
-        size_t valbufsize = valbuf.size();
-        buf.insert(buf.end(), (char *)&valbufsize, (char *)(&valbufsize + 1));
-        buf.insert(buf.end(), valbuf.begin(), valbuf.end());
+        size += sizeof(size_t) + valbuf.size();
     }
+    buf.resize(size);
+    _writeUserData(valbufs, buf.data() + base);
     return true;
 }
 
+std::function<void(char *)> encodeObjectDeferred(IObject const *object, std::size_t &size) {
+    auto prim = dynamic_cast<PrimitiveObject const *>(object);
+    if (!prim) {
+        // anything but primitives is small, staged in a buffer and copied
+        auto buf = std::make_shared<std::vector<char>>();
+        if (!encodeObject(object, *buf))
+            return nullptr;
+        size = buf->size();
+        return [buf] (char *p) {
+            std::memcpy(p, buf->data(), buf->size());
+        };
+    }
+    auto mtlbuf = std::make_shared<std::vector<char>>();
+    auto valbufs = std::make_shared<std::vector<std::vector<char>>>(_encodeUserData(object, ObjectCodecOptions{}));
+    ObjectHeader header;
+    header.magicNumber = ObjectHeader::kMagicNumber;
+    header.type = ObjectType::PrimitiveObject;
+    header.numUserData = valbufs->size();
+    header.beginUserData = sizeof(ObjectHeader) + encodedSizePrimitiveObject(prim, *mtlbuf);
+    size = header.beginUserData;
+    for (auto const &valbuf: *valbufs) {
+        size += sizeof(size_t) + valbuf.size();
+    }
+    return [prim, header, mtlbuf, valbufs] (char *p) {
+        std::memcpy(p, &header, sizeof(ObjectHeader));
+        writePrimitiveObject(prim, *mtlbuf, p + sizeof(ObjectHeader));
+        _writeUserData(*valbufs, p + header.beginUserData);
+    };
+}
+
 }
@@ -16,8 +16,9 @@ std::shared_ptr<CameraObject> decodeCameraObject(const char *it) {
     return obj;
 }
 
-bool encodeCameraObject(CameraObject const *obj, std::back_insert_iterator<std::vector<char>> it);
-bool encodeCameraObject(CameraObject const *obj, std::back_insert_iterator<std::vector<char>> it) {
+bool encodeCameraObject(CameraObject const *obj, std::vector<char> &out);
+bool encodeCameraObject(CameraObject const *obj, std::vector<char> &out) {
+    auto it = std::back_inserter(out);
     it = std::copy_n((char const *)static_cast<CameraData const *>(obj), sizeof(CameraData), it);
     return true;
 }
@@ -29,8 +30,9 @@ std::shared_ptr<LightObject> decodeLightObject(const char *it) {
     return obj;
 }
 
-bool encodeLightObject(LightObject const *obj, std::back_insert_iterator<std::vector<char>> it);
-bool encodeLightObject(LightObject const *obj, std::back_insert_iterator<std::vector<char>> it) {
+bool encodeLightObject(LightObject const *obj, std::vector<char> &out);
+bool encodeLightObject(LightObject const *obj, std::vector<char> &out) {
+    auto it = std::back_inserter(out);
     it = std::copy_n((char const *)static_cast<LightData const *>(obj), sizeof(LightData), it);
     return true;
 }
@@ -29,8 +29,9 @@ std::shared_ptr<ListObject> decodeListObject(const char *it) {
     return obj;
 }
 
-bool encodeListObject(ListObject const *obj, std::back_insert_iterator<std::vector<char>> it);
-bool encodeListObject(ListObject const *obj, std::back_insert_iterator<std::vector<char>> it) {
+bool encodeListObject(ListObject const *obj, std::vector<char> &out);
+bool encodeListObject(ListObject const *obj, std::vector<char> &out) {
+    auto it = std::back_inserter(out);
     size_t size = obj->arr.size();
     std::copy_n((char const *)&size, sizeof(size), it);
 
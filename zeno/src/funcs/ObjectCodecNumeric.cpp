@@ -27,8 +27,9 @@ std::shared_ptr<NumericObject> decodeNumericObject(const char *it) {
     return succ ? obj : nullptr;
 }
 
-bool encodeNumericObject(NumericObject const *obj, std::back_insert_iterator<std::vector<char>> it);
-bool encodeNumericObject(NumericObject const *obj, std::back_insert_iterator<std::vector<char>> it) {
+bool encodeNumericObject(NumericObject const *obj, std::vector<char> &out);
+bool encodeNumericObject(NumericObject const *obj, std::vector<char> &out) {
+    auto it = std::back_inserter(out);
     size_t index = obj->value.index();
     it = std::copy_n((char const *)&index, sizeof(index), it);
     std::visit([&] (auto const &val) {
@@ -47,8 +48,9 @@ std::shared_ptr<StringObject> decodeStringObject(const char *it) {
     return obj;
 }
 
-bool encodeStringObject(StringObject const *obj, std::back_insert_iterator<std::vector<char>> it);
-bool encodeStringObject(StringObject const *obj, std::back_insert_iterator<std::vector<char>> it) {
+bool encodeStringObject(StringObject const *obj, std::vector<char> &out);
+bool encodeStringObject(StringObject const *obj, std::vector<char> &out) {
+    auto it = std::back_inserter(out);
     size_t size = obj->value.size();
     char const *data = obj->value.data();
     it = std::copy_n((char const *)&size, sizeof(size), it);
@@ -3,9 +3,12 @@
 #include <zeno/types/MaterialObject.h>
 #include <zeno/utils/variantswitch.h>
 #include <zeno/utils/log.h>
+#include <zeno/utils/BlockCompress.h>
 //#include <zeno/utils/zeno_p.h>
 #include <algorithm>
 #include <cstring>
+#include <cstdio>
+#include <tuple>
 namespace zeno {
 
 namespace _implObjectCodec {
@@ -24,39 +27,70 @@ struct AttrVectorHeader {
     size_t nattrs;
 };
 
-template <class T0, class It>
-void decodeAttrVector(AttrVector<T0> &arr, It &it) {
+// headers are laid out serially, the array payloads are then copied by chunks in parallel
+struct CopyJobs {
+    static constexpr size_t kChunkSize = 4 << 20;
+
+    std::vector<std::tuple<char *, const char *, size_t>> jobs;
+
+    void add(char *dst, const char *src, size_t n) {
+        for (size_t off = 0; off < n; off += kChunkSize)
+            jobs.emplace_back(dst + off, src + off, std::min(kChunkSize, n - off));
+    }
+
+    void run() {
+#pragma omp parallel for if (jobs.size() > 1)
+        for (int i = 0; i < (int)jobs.size(); i++) {
+            auto [dst, src, n] = jobs[i];
+            std::memcpy(dst, src, n);
+        }
+        jobs.clear();
+    }
+};
+
+template <class T0>
+void decodeAttrVector(AttrVector<T0> &arr, const char *&it, CopyJobs &jobs) {
     AttrVectorHeader header;
-    std::copy_n(it, sizeof(header), (char *)&header);
+    std::memcpy(&header, it, sizeof(header));
     it += sizeof(header);
-    arr.values.reserve(header.size);
-    std::copy_n((T0 const *)it, header.size, std::back_inserter(arr.values));
+    arr.values.resize(header.size);
+    jobs.add((char *)arr.values.data(), it, sizeof(T0) * header.size);
     it += sizeof(T0) * header.size;
 
     for (int a = 0; a < header.nattrs; a++) {
         AttributeHeader h;
-        std::copy_n(it, sizeof(h), (char *)&h);
+        std::memcpy(&h, it, sizeof(h));
         it += sizeof(h);
         std::string key{h.name, h.namelen};
         index_switch<std::variant_size_v<AttrAcceptAll>>((size_t)h.type, [&] (auto type) {
             using T = std::variant_alternative_t<type.value, AttrAcceptAll>;
             auto &attr = arr.template add_attr<T>(key);
-            attr.clear();
-            attr.reserve(h.size);
-            std::copy_n((T const *)it, h.size, std::back_inserter(attr));
+            attr.resize(h.size);
+            jobs.add((char *)attr.data(), it, sizeof(T) * h.size);
             it += sizeof(T) * h.size;
         });
     }
-    arr.update();
 }
 
-template <class T0, class It>
-void encodeAttrVector(AttrVector<T0> const &arr, It &it) {
+template <class T0>
+size_t encodedSizeAttrVector(AttrVector<T0> const &arr) {
+    size_t n = sizeof(AttrVectorHeader) + sizeof(T0) * arr.size();
+    arr.template foreach_attr<AttrAcceptAll>([&] (auto const &key, auto const &attr) {
+        using T = std::decay_t<decltype(attr[0])>;
+        n += sizeof(AttributeHeader) + sizeof(T) * attr.size();
+    });
+    return n;
+}
+
+template <class T0>
+void encodeAttrVector(AttrVector<T0> const &arr, char *&p, CopyJobs &jobs) {
     AttrVectorHeader header;
     header.size = arr.size();
     header.nattrs = arr.template num_attrs<AttrAcceptAll>();
-    it = std::copy_n((char const *)&header, sizeof(header), it);
-    it = std::copy_n((char const *)arr.data(), sizeof(T0) * arr.size(), it);
+    std::memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    jobs.add(p, (char const *)arr.data(), sizeof(T0) * arr.size());
+    p += sizeof(T0) * arr.size();
 
     arr.template foreach_attr<AttrAcceptAll>([&] (auto const &key, auto const &attr) {
         AttributeHeader h;
@@ -65,8 +99,201 @@ void encodeAttrVector(AttrVector<T0> const &arr, It &it) {
         h.size = attr.size();
         h.namelen = key.size();
         std::strncpy(h.name, key.c_str(), sizeof(h.name));
-        it = std::copy_n((char const *)&h, sizeof(h), it);
-        it = std::copy_n((char const *)attr.data(), sizeof(T) * attr.size(), it);
+        std::memcpy(p, &h, sizeof(h));
+        p += sizeof(h);
+        jobs.add(p, (char const *)attr.data(), sizeof(T) * attr.size());
+        p += sizeof(T) * attr.size();
+    });
+}
+
+// packed encoding, each array is stored as a mode byte and its raw size, followed by
+// the raw bytes, the compressed size and the compressed bytes, or the name of a blob
+enum PackedMode : char {
+    kPackedRaw = 0,
+    kPackedLZ = 1,
+    kPackedBlob = 2,
+};
+
+template <class T, class = void>
+struct scalar_of {
+    using type = T;
+};
+
+template <class T>
+struct scalar_of<T, std::void_t<typename T::value_type>> {
+    using type = typename T::value_type;
+};
+
+template <class T, class It>
+void putPod(It &it, T const &val) {
+    it = std::copy_n((char const *)&val, sizeof(T), it);
+}
+
+template <class T>
+T getPod(const char *&it) {
+    T val;
+    std::memcpy(&val, it, sizeof(T));
+    it += sizeof(T);
+    return val;
+}
+
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+// 128-bit content hash plus size, used to name blobs
+std::string blobName(const char *data, size_t n) {
+    uint64_t h1 = 0x9e3779b97f4a7c15ull ^ n, h2 = 0xc2b2ae3d27d4eb4full + n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, data + i, 8);
+        h1 = rotl64(h1 ^ w, 31) * 0x87c37b91114253d5ull;
+        h2 = (rotl64(h2 + w, 27) * 0x4cf5ad432745937full) ^ h1;
+    }
+    if (i < n) {
+        uint64_t w = 0;
+        std::memcpy(&w, data + i, n - i);
+        h1 = rotl64(h1 ^ w, 31) * 0x87c37b91114253d5ull;
+        h2 = (rotl64(h2 + w, 27) * 0x4cf5ad432745937full) ^ h1;
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%016llx%016llx-%llx", (unsigned long long)fmix64(h1),
+                  (unsigned long long)fmix64(h2 ^ h1), (unsigned long long)n);
+    return buf;
+}
+
+void packBytes(const char *data, size_t n, size_t stride, bool compress, std::vector<char> &out) {
+    auto it = std::back_inserter(out);
+    if (compress && n >= 64) {
+        std::vector<char> shuffled(n);
+        byteShuffle(data, shuffled.data(), n, stride);
+        std::vector<char> comp(blockCompressBound(n));
+        size_t m = blockCompress(shuffled.data(), n, comp.data());
+        if (m < n - n / 8) {  // keep it raw unless it saves something
+            *it++ = kPackedLZ;
+            putPod(it, (uint64_t)n);
+            putPod(it, (uint64_t)m);
+            out.insert(out.end(), comp.data(), comp.data() + m);
+            return;
+        }
+    }
+    *it++ = kPackedRaw;
+    putPod(it, (uint64_t)n);
+    out.insert(out.end(), data, data + n);
+}
+
+bool unpackBytes(const char *&it, char *dst, size_t n, size_t stride) {
+    char mode = *it++;
+    if (getPod<uint64_t>(it) != n)
+        return false;
+    if (mode == kPackedRaw) {
+        std::memcpy(dst, it, n);
+        it += n;
+        return true;
+    }
+    if (mode == kPackedLZ) {
+        size_t m = getPod<uint64_t>(it);
+        std::vector<char> shuffled(n);
+        if (!blockDecompress(it, m, shuffled.data(), n))
+            return false;
+        byteUnshuffle(shuffled.data(), dst, n, stride);
+        it += m;
+        return true;
+    }
+    return false;
+}
+
+template <class T, class It>
+void writePackedArray(T const *data, size_t count, It &it, ObjectCodecOptions const &opts) {
+    size_t n = sizeof(T) * count;
+    size_t stride = sizeof(typename scalar_of<T>::type);
+    std::vector<char> packed;
+    if (opts.blobMinSize && opts.storeBlob && n >= opts.blobMinSize) {
+        auto name = blobName((const char *)data, n);
+        if (!opts.reuseBlob || !opts.reuseBlob(name)) {
+            packBytes((const char *)data, n, stride, opts.compress, packed);
+            opts.storeBlob(name, packed.data(), packed.size());
+        }
+        *it++ = kPackedBlob;
+        putPod(it, (uint64_t)n);
+        putPod(it, (uint8_t)name.size());
+        it = std::copy(name.begin(), name.end(), it);
+    } else {
+        packBytes((const char *)data, n, stride, opts.compress, packed);
+        it = std::copy(packed.begin(), packed.end(), it);
+    }
+}
+
+template <class T>
+bool readPackedArray(std::vector<T> &arr, size_t count, const char *&it, ObjectCodecOptions const &opts) {
+    size_t n = sizeof(T) * count;
+    size_t stride = sizeof(typename scalar_of<T>::type);
+    arr.resize(count);
+    if (*it != kPackedBlob)
+        return unpackBytes(it, (char *)arr.data(), n, stride);
+    it++;
+    if (getPod<uint64_t>(it) != n)
+        return false;
+    size_t namelen = getPod<uint8_t>(it);
+    std::string name(it, namelen);
+    it += namelen;
+    std::vector<char> blob;
+    if (!opts.loadBlob || !opts.loadBlob(name, blob)) {
+        log_error("missing blob {} for packed primitive", name);
+        return false;
+    }
+    const char *bit = blob.data();
+    return unpackBytes(bit, (char *)arr.data(), n, stride);
+}
+
+template <class T0>
+bool decodeAttrVectorPacked(AttrVector<T0> &arr, const char *&it, ObjectCodecOptions const &opts) {
+    size_t size = getPod<uint64_t>(it);
+    size_t nattrs = getPod<uint32_t>(it);
+    if (!readPackedArray(arr.values, size, it, opts))
+        return false;
+    for (size_t a = 0; a < nattrs; a++) {
+        size_t type = getPod<uint8_t>(it);
+        size_t namelen = getPod<uint16_t>(it);
+        std::string key(it, namelen);
+        it += namelen;
+        size_t count = getPod<uint64_t>(it);
+        if (type >= std::variant_size_v<AttrAcceptAll>)
+            return false;
+        bool ok = index_switch<std::variant_size_v<AttrAcceptAll>>(type, [&] (auto type) {
+            using T = std::variant_alternative_t<type.value, AttrAcceptAll>;
+            auto &attr = arr.template add_attr<T>(key);
+            return readPackedArray(attr, count, it, opts);
+        });
+        if (!ok)
+            return false;
+    }
+    arr.update();
+    return true;
+}
+
+template <class T0, class It>
+void encodeAttrVectorPacked(AttrVector<T0> const &arr, It &it, ObjectCodecOptions const &opts) {
+    putPod(it, (uint64_t)arr.size());
+    putPod(it, (uint32_t)arr.template num_attrs<AttrAcceptAll>());
+    writePackedArray(arr.data(), arr.size(), it, opts);
+    arr.template foreach_attr<AttrAcceptAll>([&] (auto const &key, auto const &attr) {
+        using T = std::decay_t<decltype(attr[0])>;
+        putPod(it, (uint8_t)variant_index<AttrAcceptAll, T>::value);
+        putPod(it, (uint16_t)key.size());
+        it = std::copy(key.begin(), key.end(), it);
+        putPod(it, (uint64_t)attr.size());
+        writePackedArray(attr.data(), attr.size(), it, opts);
     });
 }
 
@@ -75,15 +302,94 @@ void encodeAttrVector(AttrVector<T0> const &arr, It &it) {
 std::shared_ptr<PrimitiveObject> decodePrimitiveObject(const char *it);
 std::shared_ptr<PrimitiveObject> decodePrimitiveObject(const char *it) {
     auto obj = std::make_shared<PrimitiveObject>();
-    decodeAttrVector(obj->verts, it);
-    decodeAttrVector(obj->points, it);
-    decodeAttrVector(obj->lines, it);
-    decodeAttrVector(obj->tris, it);
-    decodeAttrVector(obj->quads, it);
-    decodeAttrVector(obj->loops, it);
-    decodeAttrVector(obj->polys, it);
-    decodeAttrVector(obj->edges, it);
-    decodeAttrVector(obj->uvs, it);
+    CopyJobs jobs;
+    decodeAttrVector(obj->verts, it, jobs);
+    decodeAttrVector(obj->points, it, jobs);
+    decodeAttrVector(obj->lines, it, jobs);
+    decodeAttrVector(obj->tris, it, jobs);
+    decodeAttrVector(obj->quads, it, jobs);
+    decodeAttrVector(obj->loops, it, jobs);
+    decodeAttrVector(obj->polys, it, jobs);
+    decodeAttrVector(obj->edges, it, jobs);
+    decodeAttrVector(obj->uvs, it, jobs);
+    jobs.run();
+    obj->verts.update();
+    obj->points.update();
+    obj->lines.update();
+    obj->tris.update();
+    obj->quads.update();
+    obj->loops.update();
+    obj->polys.update();
+    obj->edges.update();
+    obj->uvs.update();
+    if (*it++ == '1') {
+        obj->mtl = std::make_shared<MaterialObject>();
+        obj->mtl->deserialize(it);
+    }
+    return obj;
+}
+
+// sized first, so that the caller can provide exactly the memory to write into
+size_t encodedSizePrimitiveObject(PrimitiveObject const *obj, std::vector<char> &mtlbuf);
+size_t encodedSizePrimitiveObject(PrimitiveObject const *obj, std::vector<char> &mtlbuf) {
+    if (obj->mtl)
+        mtlbuf = obj->mtl->serialize();
+    return encodedSizeAttrVector(obj->verts)
+        + encodedSizeAttrVector(obj->points)
+        + encodedSizeAttrVector(obj->lines)
+        + encodedSizeAttrVector(obj->tris)
+        + encodedSizeAttrVector(obj->quads)
+        + encodedSizeAttrVector(obj->loops)
+        + encodedSizeAttrVector(obj->polys)
+        + encodedSizeAttrVector(obj->edges)
+        + encodedSizeAttrVector(obj->uvs)
+        + 1 + mtlbuf.size();
+}
+
+void writePrimitiveObject(PrimitiveObject const *obj, std::vector<char> const &mtlbuf, char *p);
+void writePrimitiveObject(PrimitiveObject const *obj, std::vector<char> const &mtlbuf, char *p) {
+    CopyJobs jobs;
+    encodeAttrVector(obj->verts, p, jobs);
+    encodeAttrVector(obj->points, p, jobs);
+    encodeAttrVector(obj->lines, p, jobs);
+    encodeAttrVector(obj->tris, p, jobs);
+    encodeAttrVector(obj->quads, p, jobs);
+    encodeAttrVector(obj->loops, p, jobs);
+    encodeAttrVector(obj->polys, p, jobs);
+    encodeAttrVector(obj->edges, p, jobs);
+    encodeAttrVector(obj->uvs, p, jobs);
+    jobs.run();
+    *p++ = obj->mtl ? '1' : '0';
+    std::memcpy(p, mtlbuf.data(), mtlbuf.size());
+}
+
+bool encodePrimitiveObject(PrimitiveObject const *obj, std::vector<char> &out);
+bool encodePrimitiveObject(PrimitiveObject const *obj, std::vector<char> &out) {
+    std::vector<char> mtlbuf;
+    size_t size = encodedSizePrimitiveObject(obj, mtlbuf);
+    // grow the output once, then fill it in place
+    size_t base = out.size();
+    out.resize(base + size);
+    writePrimitiveObject(obj, mtlbuf, out.data() + base);
+    return true;
+}
+
+std::shared_ptr<PrimitiveObject> decodePrimitiveObjectPacked(const char *it, ObjectCodecOptions const &opts);
+std::shared_ptr<PrimitiveObject> decodePrimitiveObjectPacked(const char *it, ObjectCodecOptions const &opts) {
+    auto obj = std::make_shared<PrimitiveObject>();
+    bool ok = decodeAttrVectorPacked(obj->verts, it, opts)
+        && decodeAttrVectorPacked(obj->points, it, opts)
+        && decodeAttrVectorPacked(obj->lines, it, opts)
+        && decodeAttrVectorPacked(obj->tris, it, opts)
+        && decodeAttrVectorPacked(obj->quads, it, opts)
+        && decodeAttrVectorPacked(obj->loops, it, opts)
+        && decodeAttrVectorPacked(obj->polys, it, opts)
+        && decodeAttrVectorPacked(obj->edges, it, opts)
+        && decodeAttrVectorPacked(obj->uvs, it, opts);
+    if (!ok) {
+        log_error("packed primitive broken");
+        return nullptr;
+    }
     if (*it++ == '1') {
         obj->mtl = std::make_shared<MaterialObject>();
         obj->mtl->deserialize(it);
@@ -91,17 +397,18 @@ std::shared_ptr<PrimitiveObject> decodePrimitiveObject(const char *it) {
     return obj;
 }
 
-bool encodePrimitiveObject(PrimitiveObject const *obj, std::back_insert_iterator<std::vector<char>> it);
-bool encodePrimitiveObject(PrimitiveObject const *obj, std::back_insert_iterator<std::vector<char>> it) {
-    encodeAttrVector(obj->verts, it);
-    encodeAttrVector(obj->points, it);
-    encodeAttrVector(obj->lines, it);
-    encodeAttrVector(obj->tris, it);
-    encodeAttrVector(obj->quads, it);
-    encodeAttrVector(obj->loops, it);
-    encodeAttrVector(obj->polys, it);
-    encodeAttrVector(obj->edges, it);
-    encodeAttrVector(obj->uvs, it);
+bool encodePrimitiveObjectPacked(PrimitiveObject const *obj, std::vector<char> &out, ObjectCodecOptions const &opts);
+bool encodePrimitiveObjectPacked(PrimitiveObject const *obj, std::vector<char> &out, ObjectCodecOptions const &opts) {
+    auto it = std::back_inserter(out);
+    encodeAttrVectorPacked(obj->verts, it, opts);
+    encodeAttrVectorPacked(obj->points, it, opts);
+    encodeAttrVectorPacked(obj->lines, it, opts);
+    encodeAttrVectorPacked(obj->tris, it, opts);
+    encodeAttrVectorPacked(obj->quads, it, opts);
+    encodeAttrVectorPacked(obj->loops, it, opts);
+    encodeAttrVectorPacked(obj->polys, it, opts);
+    encodeAttrVectorPacked(obj->edges, it, opts);
+    encodeAttrVectorPacked(obj->uvs, it, opts);
     if (obj->mtl) {
         *it++ = '1';
         for (char c: obj->mtl->serialize())
@@ -3,6 +3,7 @@
 #include <zeno/types/ListObject.h>
 #include <zeno/types/NumericObject.h>
 #include <zeno/types/DummyObject.h>
+#include <zeno/types/PrimitiveObject.h>
 #include <zeno/extra/GlobalState.h>
 #include <zeno/extra/GlobalComm.h>
 #include <zeno/utils/cppdemangle.h>
@@ -34,6 +35,9 @@ struct ToView : zeno::INode {
             }
             auto previewclone = [&] (zany const &p) {
                 if (auto methview = p->method_node("view"); methview.empty()) {
+                    // the view copy is only read, its arrays need not be copied
+                    if (auto prim = dynamic_cast<PrimitiveObject *>(p.get()))
+                        return std::static_pointer_cast<IObject>(prim->share_clone());
                     return p->clone();
                 } else {
                     return safe_at(getThisGraph()->callTempNode(methview, {{"arg0", p}}),
@@ -53,9 +57,9 @@ struct ToView : zeno::INode {
                     if (isStatic)
                         key.append("static");
                     else
-                        key.append(std::to_string(getThisSession()->globalState->frameid));
+                        key.append(std::to_string(getGlobalState()->frameid));
                     key.push_back(':');
-                    key.append(std::to_string(getThisSession()->globalState->sessionid));
+                    key.append(std::to_string(getGlobalState()->sessionid));
                     log_debug("ToView: add view object [{}] of type {}", key, cppdemangle(typeid(*p)));
                     getThisSession()->globalComm->addViewObject(key, std::move(pp));
                     set_output2("viewid", std::move(key));
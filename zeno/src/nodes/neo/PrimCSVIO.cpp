@@ -7,48 +7,38 @@
 #include <zeno/utils/string.h>
 #include <zeno/utils/log.h>
 #include <zeno/utils/vec.h>
+#include <zeno/utils/chunked_write.h>
+#include <functional>
 #include <fstream>
 
 namespace zeno {
 namespace {
 
-static void dump(int const &v, std::ostream &fout) {
-    fout << v;
-}
-
-static void dump(float const &v, std::ostream &fout) {
-    fout << v;
-}
-
-template <size_t N, class T>
-static void dump(vec<N, T> const &v, std::ostream &fout) {
-    fout << v[0];
-    for (int i = 1; i < N; i++)
-        fout << ' ' << v[i];
-}
-
 template <class T>
-void dump_csv(AttrVector<T> avec, std::ostream &fout) {
+void dump_csv(AttrVector<T> const &avec, std::ostream &fout) {
     fout << "pos";
-    avec.template foreach_attr<AttrAcceptAll>([&] (auto const &key, auto &arr) {
+    std::vector<std::function<void(ChunkBuffer &, size_t)>> columns;
+    avec.template foreach_attr<AttrAcceptAll>([&] (auto const &key, auto const &arr) {
         fout << ',' << key;
+        columns.emplace_back([&arr] (ChunkBuffer &cb, size_t i) {
+            cb << ',' << arr[i];
+        });
     });
     fout << '\n';
-    for (int i = 0; i < avec.size(); i++) {
-        dump(avec[i], fout);
-        avec.template foreach_attr<AttrAcceptAll>([&] (auto const &key, auto &arr) {
-            fout << ',';
-            dump(arr[i], fout);
-        });
-        fout << '\n';
-    }
+    write_chunked(fout, avec.size(), [&] (ChunkBuffer &cb, size_t i) {
+        cb << avec[i];
+        for (auto const &column: columns) {
+            column(cb, i);
+        }
+        cb << '\n';
+    });
 }
 
 struct WritePrimToCSV : INode {
     virtual void apply() override {
         auto prim = get_input<PrimitiveObject>("prim");
         auto path = get_input<StringObject>("path")->get();
-        std::ofstream fout(path);
+        auto fout = open_chunked(path);
         auto memb = invoker_variant(array_index(
                 {"verts", "points", "lines", "tris", "quads", "loops", "polys"},
                 get_input2<std::string>("type")),
@@ -62,6 +52,7 @@ struct WritePrimToCSV : INode {
         std::visit([&] (auto const &memb) {
             dump_csv(memb(*prim), fout);
         }, memb);
+        close_chunked(fout, path);
         set_output("prim", std::move(prim));
     }
 };
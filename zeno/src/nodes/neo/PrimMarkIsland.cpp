@@ -3,22 +3,26 @@
 #include <zeno/funcs/PrimitiveUtils.h>
 #include <zeno/types/StringObject.h>
 #include <zeno/types/NumericObject.h>
-#include <zeno/utils/tuple_hash.h>
-#include <unordered_map>
+#include <atomic>
 
 namespace zeno {
 
-ZENO_API void primMarkIsland(PrimitiveObject *prim, std::string tagAttr) {
-    // Oh, I mean, Tesla was a great DJ
-    auto &tagVert = prim->add_attr<int>(tagAttr);
+namespace {
+
+// tags each vert with the root vert of its island, linked exactly as it always was
+// (each face's later roots under the root of its first vert) so existing graphs keep
+// their tag values; path halving makes it near linear without changing any root
+void markIslandRoots(PrimitiveObject *prim, std::vector<int> &tagVert) {
     auto m = tagVert.size();
     std::vector<int> found(m);
     for (int i = 0; i < m; i++) {
         found[i] = i;
     }
     auto find = [&] (int i) {
-        while (i != found[i])
+        while (i != found[i]) {
+            found[i] = found[found[i]];
             i = found[i];
+        }
         return i;
     };
     for (int i = 0; i < prim->lines.size(); i++) {
@@ -59,6 +63,102 @@ ZENO_API void primMarkIsland(PrimitiveObject *prim, std::string tagAttr) {
     }
 }
 
+// lock-free union-find over the face edges: roots are always linked from the larger
+// index to the smaller one with a CAS, so each root ends up the smallest vertex of its
+// island and paths strictly decrease, which lets find() halve them without locking
+std::vector<int> markIslandCompact(PrimitiveObject *prim, std::vector<int> &tagVert) {
+    intptr_t m = tagVert.size();
+    std::vector<std::atomic<int>> found(m);
+#pragma omp parallel for
+    for (intptr_t i = 0; i < m; i++) {
+        found[i].store(i, std::memory_order_relaxed);
+    }
+    auto find = [&] (int i) {
+        int p = found[i].load(std::memory_order_relaxed);
+        while (p != i) {
+            int gp = found[p].load(std::memory_order_relaxed);
+            if (gp != p)
+                found[i].store(gp, std::memory_order_relaxed);  // any ancestor is still valid
+            i = p;
+            p = gp;
+        }
+        return i;
+    };
+    auto unite = [&] (int e0, int e1) {
+        while (true) {
+            e0 = find(e0);
+            e1 = find(e1);
+            if (e0 == e1)
+                return;
+            if (e0 > e1)
+                std::swap(e0, e1);
+            if (found[e1].compare_exchange_weak(e1, e0, std::memory_order_relaxed))
+                return;
+        }
+    };
+#pragma omp parallel for
+    for (intptr_t i = 0; i < (intptr_t)prim->lines.size(); i++) {
+        auto ind = prim->lines[i];
+        unite(ind[0], ind[1]);
+    }
+#pragma omp parallel for
+    for (intptr_t i = 0; i < (intptr_t)prim->tris.size(); i++) {
+        auto ind = prim->tris[i];
+        unite(ind[0], ind[1]);
+        unite(ind[0], ind[2]);
+    }
+#pragma omp parallel for
+    for (intptr_t i = 0; i < (intptr_t)prim->quads.size(); i++) {
+        auto ind = prim->quads[i];
+        unite(ind[0], ind[1]);
+        unite(ind[0], ind[2]);
+        unite(ind[0], ind[3]);
+    }
+#pragma omp parallel for
+    for (intptr_t i = 0; i < (intptr_t)prim->polys.size(); i++) {
+        auto [base, len] = prim->polys[i];
+        for (int j = base + 1; j < base + len; j++) {
+            unite(prim->loops[base], prim->loops[j]);
+        }
+    }
+
+    // islands are numbered compactly in the order of their smallest vertex
+#pragma omp parallel for
+    for (intptr_t i = 0; i < m; i++) {
+        tagVert[i] = find(i);
+    }
+    std::vector<int> counts;
+    for (intptr_t i = 0; i < m; i++) {
+        if (tagVert[i] == i) {
+            found[i].store(counts.size(), std::memory_order_relaxed);
+            counts.push_back(0);
+        }
+    }
+#pragma omp parallel for
+    for (intptr_t i = 0; i < m; i++) {
+        tagVert[i] = found[tagVert[i]].load(std::memory_order_relaxed);
+    }
+    for (intptr_t i = 0; i < m; i++) {
+        counts[tagVert[i]]++;
+    }
+    return counts;
+}
+
+}
+
+// tags each vert with its island: by default the index of the island's root vert, with
+// compact set the islands are numbered 0, 1... in the order of their smallest vert and
+// the number of verts in each island is returned (nothing is returned otherwise)
+ZENO_API std::vector<int> primMarkIsland(PrimitiveObject *prim, std::string tagAttr, bool compact) {
+    // Oh, I mean, Tesla was a great DJ
+    auto &tagVert = prim->add_attr<int>(tagAttr);
+    if (!compact) {
+        markIslandRoots(prim, tagVert);
+        return {};
+    }
+    return markIslandCompact(prim, tagVert);
+}
+
 namespace {
 
 struct PrimMarkIsland : INode {
@@ -66,7 +166,7 @@ struct PrimMarkIsland : INode {
         auto prim = get_input<PrimitiveObject>("prim");
         auto tagAttr = get_input<StringObject>("tagAttr")->get();
 
-        primMarkIsland(prim.get(), tagAttr);
+        primMarkIsland(prim.get(), tagAttr, get_input2<bool>("compact"));
 
         set_output("prim", std::move(prim));
     }
@@ -77,6 +177,7 @@ ZENDEFNODE(PrimMarkIsland, {
     {
     {"PrimitiveObject", "prim"},
     {"string", "tagAttr", "tag"},
+    {"bool", "compact", "0"},
     },
     {
     {"PrimitiveObject", "prim"},
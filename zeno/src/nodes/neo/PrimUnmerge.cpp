@@ -3,11 +3,65 @@
 #include <zeno/funcs/PrimitiveUtils.h>
 #include <zeno/types/ListObject.h>
 #include <zeno/types/StringObject.h>
+#include <zeno/types/UserData.h>
 #include <zeno/para/parallel_reduce.h>
-#include <zeno/para/parallel_for.h>
 
 namespace zeno {
 
+namespace {
+
+// items bucketed by tag in csr form, tags outside [0, ntags) are dropped
+struct TagBuckets {
+    std::vector<int> offsets;
+    std::vector<int> items;
+
+    template <class F>
+    TagBuckets(int ntags, intptr_t n, F const &tagOf) : offsets(ntags + 1) {
+        std::vector<int> tags(n);
+#pragma omp parallel for
+        for (intptr_t i = 0; i < n; i++) {
+            tags[i] = tagOf(i);
+        }
+        for (intptr_t i = 0; i < n; i++) {
+            if (tags[i] >= 0 && tags[i] < ntags)
+                offsets[tags[i] + 1]++;
+        }
+        for (int t = 0; t < ntags; t++) {
+            offsets[t + 1] += offsets[t];
+        }
+        items.resize(offsets[ntags]);
+        std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+        for (intptr_t i = 0; i < n; i++) {
+            if (tags[i] >= 0 && tags[i] < ntags)
+                items[cursor[tags[i]]++] = i;
+        }
+    }
+
+    int size(int t) const {
+        return offsets[t + 1] - offsets[t];
+    }
+
+    int const *begin(int t) const {
+        return items.data() + offsets[t];
+    }
+};
+
+template <class T>
+void gatherAttrs(AttrVector<T> const &in, AttrVector<T> &out, int const *revamp, int n) {
+    in.template foreach_attr<AttrAcceptAll>([&] (auto const &key, auto const &inarr) {
+        using U = std::decay_t<decltype(inarr[0])>;
+        auto &outarr = out.template add_attr<U>(key);
+        for (int i = 0; i < n; i++) {
+            outarr[i] = inarr[revamp[i]];
+        }
+    });
+}
+
+}
+
+// single pass over the mesh: verts and faces are bucketed by tag once, then each piece
+// gathers its own buckets, instead of filtering a full copy of the mesh for every tag;
+// a face goes to a piece when all of its verts carry that tag, as in primFilterVerts
 ZENO_API std::vector<std::shared_ptr<PrimitiveObject>> primUnmergeVerts(PrimitiveObject *prim, std::string tagAttr) {
     if (!prim->verts.size()) return {};
 
@@ -19,136 +73,97 @@ ZENO_API std::vector<std::shared_ptr<PrimitiveObject>> primUnmergeVerts(Primitiv
         primList[tag] = std::make_shared<PrimitiveObject>();
     }
 
-#if 1
-    for (int tag = 0; tag < tagMax; tag++) {
-        primList[tag]->assign(prim);
-        primFilterVerts(primList[tag].get(), tagAttr, tag);
-    }
-
-#else
-    std::vector<std::vector<int>> vert_revamp(tagMax);
-    std::vector<int> vert_unrevamp(prim->verts.size());
-
-    for (size_t i = 0; i < prim->verts.size(); i++) {
-        int tag = tagArr[i];
-        vert_revamp[tag].push_back(i);
-        vert_unrevamp[i] = tag;
-    }
-
-    for (int tag = 0; tag < tagMax; tag++) {
-        auto &revamp = vert_revamp[tag];
-        auto const &outprim = primList[tag];
-
-        outprim->verts.resize(revamp.size());
-        parallel_for((size_t)0, revamp.size(), [&] (size_t i) {
-            outprim->verts[i] = prim->verts[revamp[i]];
-        });
-        prim->verts.foreach_attr([&] (auto const &key, auto const &inarr) {
-            using T = std::decay_t<decltype(inarr[0])>;
-            auto &outarr = outprim->verts.add_attr<T>(key);
-            parallel_for((size_t)0, revamp.size(), [&] (size_t i) {
-                outarr[i] = inarr[revamp[i]];
-            });
-        });
+    TagBuckets vertBuckets(tagMax, prim->verts.size(), [&] (intptr_t i) { return tagArr[i]; });
+    std::vector<int> vert_unrevamp(prim->verts.size());  // index of each vert within its piece
+#pragma omp parallel for
+    for (intptr_t tag = 0; tag < tagMax; tag++) {
+        auto revamp = vertBuckets.begin(tag);
+        for (int i = 0; i < vertBuckets.size(tag); i++) {
+            vert_unrevamp[revamp[i]] = i;
+        }
     }
 
-    std::vector<std::vector<int>> face_revamp;
-
-    auto mock = [&] (auto getter) {
-        auto &prim_tris = getter(prim);
-        if (prim_tris.size()) {
-            face_revamp.clear();
-            face_revamp.resize(tagMax);
-            using T = std::decay_t<decltype(prim_tris[0])>;
-
-            for (size_t i = 0; i < prim_tris.size(); i++) {
-                auto ind = reinterpret_cast<decay_vec_t<T> const *>(&prim_tris[i]);
-                int tag = vert_unrevamp[ind[0]];
-                bool bad = false;
-                for (int j = 1; j < is_vec_n<T>; j++) {
-                    int new_tag = vert_unrevamp[ind[j]];
-                    if (tag != new_tag) {
-                        bad = true;
-                        break;
-                    }
-                }
-                if (!bad) face_revamp[tag].push_back(i);
-            }
-
-            for (int tag = 0; tag < tagMax; tag++) {
-                auto &revamp = face_revamp[tag];
-                auto &v_revamp = vert_revamp[tag];
-                auto *outprim = primList[tag].get();
-                auto &outprim_tris = getter(outprim);
-
-                outprim_tris.resize(revamp.size());
-                parallel_for((size_t)0, revamp.size(), [&] (size_t i) {
-                    auto ind = reinterpret_cast<decay_vec_t<T> const *>(&prim_tris[revamp[i]]);
-                    auto outind = reinterpret_cast<decay_vec_t<T> *>(&outprim_tris[i]);
-                    for (int j = 0; j < is_vec_n<T>; j++) {
-                        outind[j] = v_revamp[ind[j]];
-                    }
-                });
-
-                prim_tris.foreach_attr([&] (auto const &key, auto const &inarr) {
-                    using T = std::decay_t<decltype(inarr[0])>;
-                    auto &outarr = outprim_tris.template add_attr<T>(key);
-                    parallel_for((size_t)0, revamp.size(), [&] (size_t i) {
-                        outarr[i] = inarr[revamp[i]];
-                    });
-                });
-            }
+    auto faceTag = [&] (int const *ind, int n) {
+        int tag = tagArr[ind[0]];
+        for (int j = 1; j < n; j++) {
+            if (tagArr[ind[j]] != tag)
+                return -1;
         }
+        return tag;
     };
-    mock([] (auto &&p) -> auto & { return p->points; });
-    mock([] (auto &&p) -> auto & { return p->lines; });
-    mock([] (auto &&p) -> auto & { return p->tris; });
-    mock([] (auto &&p) -> auto & { return p->quads; });
-
-    if (prim->polys.size()) {
-        face_revamp.clear();
-        face_revamp.resize(tagMax);
-
-        for (size_t i = 0; i < prim->polys.size(); i++) {
-            auto &[base, len] = prim->polys[i];
-            if (len <= 0) continue;
-            int tag = vert_unrevamp[prim->loops[base]];
-            bool bad = false;
-            for (int j = base + 1; j < base + len; i++) {
-                int new_tag = vert_unrevamp[prim->loops[j]];
-                if (tag != new_tag) {
-                    bad = true;
-                    break;
-                }
+    auto bucketFaces = [&] (auto const &faces) {
+        using T = std::decay_t<decltype(faces[0])>;
+        return TagBuckets(tagMax, faces.size(), [&] (intptr_t i) {
+            return faceTag(reinterpret_cast<int const *>(&faces[i]), sizeof(T) / sizeof(int));
+        });
+    };
+    auto pointsBuckets = bucketFaces(prim->points);
+    auto linesBuckets = bucketFaces(prim->lines);
+    auto trisBuckets = bucketFaces(prim->tris);
+    auto quadsBuckets = bucketFaces(prim->quads);
+    auto edgesBuckets = bucketFaces(prim->edges);
+    TagBuckets polysBuckets(tagMax, prim->polys.size(), [&] (intptr_t i) {
+        auto [base, len] = prim->polys[i];
+        return len > 0 ? faceTag(prim->loops.data() + base, len) : -1;
+    });
+
+    auto const &userData = prim->userData();  // fetched once, the first call creates it
+
+    auto unmergeFaces = [&] (auto const &faces, auto &outfaces, TagBuckets const &buckets, int tag) {
+        using T = std::decay_t<decltype(faces[0])>;
+        int n = buckets.size(tag);
+        auto revamp = buckets.begin(tag);
+        outfaces.resize(n);
+        for (int i = 0; i < n; i++) {
+            auto ind = reinterpret_cast<int const *>(&faces[revamp[i]]);
+            auto outind = reinterpret_cast<int *>(&outfaces[i]);
+            for (int j = 0; j < (int)(sizeof(T) / sizeof(int)); j++) {
+                outind[j] = vert_unrevamp[ind[j]];
             }
-            if (!bad) face_revamp[tag].push_back(i);
         }
+        gatherAttrs(faces, outfaces, revamp, n);
+    };
 
-        for (int tag = 0; tag < tagMax; tag++) {
-            auto &revamp = face_revamp[tag];
-            auto &v_revamp = vert_revamp[tag];
-            auto *outprim = primList[tag].get();
+#pragma omp parallel for schedule(dynamic)
+    for (intptr_t tag = 0; tag < tagMax; tag++) {
+        auto *outprim = primList[tag].get();
+        outprim->userData() = userData;
 
-            outprim->polys.resize(revamp.size());
-            for (size_t i = 0; i < revamp.size(); i++) {
-                auto const &[base, len] = prim->polys[revamp[i]];
-                int new_base = outprim->loops.size();
+        int nverts = vertBuckets.size(tag);
+        auto revamp = vertBuckets.begin(tag);
+        outprim->verts.resize(nverts);
+        for (int i = 0; i < nverts; i++) {
+            outprim->verts[i] = prim->verts[revamp[i]];
+        }
+        gatherAttrs(prim->verts, outprim->verts, revamp, nverts);
+
+        unmergeFaces(prim->points, outprim->points, pointsBuckets, tag);
+        unmergeFaces(prim->lines, outprim->lines, linesBuckets, tag);
+        unmergeFaces(prim->tris, outprim->tris, trisBuckets, tag);
+        unmergeFaces(prim->quads, outprim->quads, quadsBuckets, tag);
+        unmergeFaces(prim->edges, outprim->edges, edgesBuckets, tag);
+
+        int npolys = polysBuckets.size(tag);
+        auto polysRevamp = polysBuckets.begin(tag);
+        if (npolys) {
+            std::vector<int> loopsRevamp;
+            outprim->polys.resize(npolys);
+            for (int i = 0; i < npolys; i++) {
+                auto [base, len] = prim->polys[polysRevamp[i]];
+                outprim->polys[i] = {(int)loopsRevamp.size(), len};
                 for (int j = base; j < base + len; j++) {
-                    outprim->loops.push_back(prim->loops[j]);
+                    loopsRevamp.push_back(j);
                 }
-                outprim->polys[i] = {new_base, len};
             }
-
-            prim->polys.foreach_attr([&] (auto const &key, auto const &inarr) {
-                using T = std::decay_t<decltype(inarr[0])>;
-                auto &outarr = outprim->polys.add_attr<T>(key);
-                parallel_for((size_t)0, revamp.size(), [&] (size_t i) {
-                    outarr[i] = inarr[revamp[i]];
-                });
-            });
+            gatherAttrs(prim->polys, outprim->polys, polysRevamp, npolys);
+            outprim->loops.resize(loopsRevamp.size());
+            for (size_t i = 0; i < loopsRevamp.size(); i++) {
+                outprim->loops[i] = vert_unrevamp[prim->loops[loopsRevamp[i]]];
+            }
+            gatherAttrs(prim->loops, outprim->loops, loopsRevamp.data(), loopsRevamp.size());
+            outprim->uvs = prim->uvs;  // loop uvs index into the shared uv table
         }
     }
-#endif
 
     return primList;
 }
@@ -161,7 +176,9 @@ struct PrimUnmerge : INode {
         auto tagAttr = get_input<StringObject>("tagAttr")->get();
         auto method = get_input<StringObject>("method")->get();
 
-        if (get_input2<bool>("preSimplify")) {
+        if (get_input2<bool>("markIsland")) {
+            primMarkIsland(prim.get(), tagAttr, true);  // compact ids need no simplifying
+        } else if (get_input2<bool>("preSimplify")) {
             primSimplifyTag(prim.get(), tagAttr);
         }
         auto primList = primUnmergeVerts(prim.get(), tagAttr);
@@ -180,6 +197,7 @@ ZENDEFNODE(PrimUnmerge, {
         {"string", "tagAttr", "tag"},
         {"bool", "preSimplify", "0"},
         {"enum verts faces", "method", "verts"},
+        {"bool", "markIsland", "0"},
     },
     {
         {"list", "listPrim"},
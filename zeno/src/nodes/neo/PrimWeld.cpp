@@ -3,78 +3,202 @@
 #include <zeno/funcs/PrimitiveUtils.h>
 #include <zeno/types/StringObject.h>
 #include <zeno/types/NumericObject.h>
+#include <zeno/utils/log.h>
 #include <unordered_map>
 #include <algorithm>
+#include <limits>
+#include <cmath>
 
 namespace zeno {
 namespace {
 
-template <class T>
-static void revamp_vector(std::vector<T> &arr, std::vector<int> const &revamp) {
-    std::vector<T> newarr(arr.size());
-    for (int i = 0; i < revamp.size(); i++) {
-        newarr[i] = arr[revamp[i]];
+// groups are numbered by their first vertex, unrevamp[vert] = group, revamp[group] = first vertex
+static void group_by_tag(std::vector<int> const &tag, std::vector<int> &revamp, std::vector<int> &unrevamp) {
+    intptr_t n = tag.size();
+    int tmin = std::numeric_limits<int>::max(), tmax = std::numeric_limits<int>::lowest();
+#pragma omp parallel for reduction(min: tmin) reduction(max: tmax)
+    for (intptr_t i = 0; i < n; i++) {
+        tmin = std::min(tmin, tag[i]);
+        tmax = std::max(tmax, tag[i]);
+    }
+    if (n && (int64_t)tmax - tmin < 2 * (int64_t)n) {
+        // compact tags (indices, PrimMarkClose output...) are looked up directly
+        std::vector<int> lut((size_t)((int64_t)tmax - tmin + 1), -1);
+        for (intptr_t i = 0; i < n; i++) {
+            auto &g = lut[tag[i] - tmin];
+            if (g == -1) {
+                g = revamp.size();
+                revamp.push_back(i);
+            }
+            unrevamp[i] = g;
+        }
+    } else {
+        std::unordered_map<int, int> lut;
+        lut.reserve(n);
+        for (intptr_t i = 0; i < n; i++) {
+            auto [it, fresh] = lut.try_emplace(tag[i], (int)revamp.size());
+            if (fresh)
+                revamp.push_back(i);
+            unrevamp[i] = it->second;
+        }
+    }
+}
+
+// open addressing cell -> int table, std::unordered_map is what makes PrimMarkClose slow
+struct CellTable {
+    std::vector<int64_t> keys;
+    std::vector<int> vals;
+    size_t mask;
+    int shift = 64 - 4;
+
+    static constexpr int64_t kEmpty = std::numeric_limits<int64_t>::min();
+
+    explicit CellTable(size_t n) {
+        size_t cap = 16;
+        while (cap < 2 * n) cap <<= 1, shift--;
+        keys.assign(cap, kEmpty);
+        vals.resize(cap);
+        mask = cap - 1;
+    }
+
+    static int64_t pack(vec3i const &c) {
+        return ((int64_t)(c[0] & 0x1fffff) << 42) | ((int64_t)(c[1] & 0x1fffff) << 21) | (int64_t)(c[2] & 0x1fffff);
+    }
+
+    size_t slot(int64_t key) const {
+        size_t h = (size_t)((uint64_t)key * 0x9e3779b97f4a7c15ull >> shift);
+        while (keys[h & mask] != key && keys[h & mask] != kEmpty)
+            h++;
+        return h & mask;
+    }
+
+    int *find(vec3i const &c) {
+        auto s = slot(pack(c));
+        return keys[s] == kEmpty ? nullptr : &vals[s];
+    }
+
+    int &operator[](vec3i const &c) {
+        auto key = pack(c);
+        auto s = slot(key);
+        keys[s] = key;
+        return vals[s];
+    }
+};
+
+// each vertex joins the earliest group whose leading vertex lies within distance, found
+// through a spatial hash of cell size 2 * distance: the ball around a vertex then only
+// overlaps its own cell and one neighbour along each axis, 8 cells instead of 27
+static void group_by_pos(std::vector<vec3f> const &pos, float distance, std::vector<int> &revamp, std::vector<int> &unrevamp) {
+    intptr_t n = pos.size();
+    distance = std::max(distance, 0.0f);
+    float factor = distance > 0 ? 0.5f / distance : 1.0f;  // zero distance welds exact duplicates only
+    float dist2 = distance * distance;
+    std::vector<vec3i> cells(n), sides(n);
+#pragma omp parallel for
+    for (intptr_t i = 0; i < n; i++) {
+        auto f = pos[i] * factor;
+        auto c = vec3i(floor(f));
+        cells[i] = c;
+        for (int d = 0; d < 3; d++) {
+            sides[i][d] = f[d] - c[d] < 0.5f ? -1 : 1;
+        }
+    }
+
+    CellTable heads(n);     // cell -> last group led from it
+    std::vector<int> next;  // next[group] = previous group led from the same cell
+    auto search = [&] (vec3f const &p, int const *head) {
+        int found = -1;
+        for (int g = head ? *head : -1; g != -1; g = next[g]) {
+            if (lengthSquared(pos[revamp[g]] - p) <= dist2)
+                found = g;  // lists run from the latest group to the earliest
+        }
+        return found;
+    };
+    for (intptr_t i = 0; i < n; i++) {
+        auto p = pos[i];
+        auto c = cells[i];
+        int *self = heads.find(c);
+        int found = search(p, self);
+        for (int k = 1; k < 8; k++) {
+            auto o = vec3i(k & 1 ? sides[i][0] : 0, k & 2 ? sides[i][1] : 0, k & 4 ? sides[i][2] : 0);
+            int g = search(p, heads.find(c + o));
+            if (g != -1 && (found == -1 || g < found))
+                found = g;
+        }
+        if (found == -1) {
+            found = revamp.size();
+            revamp.push_back(i);
+            next.push_back(self ? *self : -1);
+            heads[c] = found;
+        }
+        unrevamp[i] = found;
     }
-    std::swap(arr, newarr);
 }
 
 struct PrimWeld : INode {
     virtual void apply() override {
         auto prim = get_input<PrimitiveObject>("prim");
-        auto tagAttr = get_input<StringObject>("tagAttr")->get();
         auto isAverage = get_input<StringObject>("method")->get() == "average";
+        auto weldBy = get_input2<std::string>("weldBy");
 
-        std::unordered_multimap<int, int> lut;
-        auto &tag = prim->verts.attr<int>(tagAttr);
-        for (int i = 0; i < prim->size(); i++) {
-            lut.insert({tag[i], i});
-        }
         std::vector<int> revamp;
         std::vector<int> unrevamp(prim->size());
-        revamp.resize(lut.size());
-        int nrevamp = 0;
-        for (auto it = lut.begin(); it != lut.end();) {
-            auto nit = std::find_if(std::next(it), lut.end(), [val = it->first] (auto const &p) {
-                return p.first != val;
-            });
-            auto start = it->second;
-            if (isAverage) {
-                vec3f average = prim->verts[start];
-                int count = 1;
-                for (++it; it != nit; ++it) {
-                    unrevamp[it->second] = nrevamp;
-                    auto pos = prim->verts[it->second];
-                    average += pos;
-                    ++count;
-                }
-                average *= 1 / (float)count;
-                prim->verts[start] = average;
-            } else {
-                for (; it != nit; ++it) {
-                    //printf("(%d) %d -> %d\n", it->first, it->second, nrevamp);
-                    unrevamp[it->second] = nrevamp;
-                    // unrevamp[old_coor] = new_coor
-                }
-            }
-            revamp[nrevamp] = start;
-            ++nrevamp;
+        if (weldBy == "pos") {
+            group_by_pos(prim->verts.values, get_input2<float>("distance"), revamp, unrevamp);
+        } else {
+            auto tagAttr = get_input<StringObject>("tagAttr")->get();
+            group_by_tag(prim->verts.attr<int>(tagAttr), revamp, unrevamp);
         }
-        revamp.resize(nrevamp);
-        //primRevampVerts(prim.get(), revamp, &unrevamp);
+        intptr_t nrevamp = revamp.size();
+        zeno::log_debug("PrimWeld: collapse from {} to {}", prim->verts.size(), nrevamp);
 
-        revamp_vector(prim->verts.values, revamp);
         if (isAverage) {
-            prim->verts.foreach_attr<AttrAcceptAll>([&] (auto const &key, auto &arr) {
+            // members of each group in csr form, sorted by vertex index
+            std::vector<int> offsets(nrevamp + 1);
+            for (intptr_t i = 0; i < (intptr_t)unrevamp.size(); i++) {
+                offsets[unrevamp[i] + 1]++;
+            }
+            for (intptr_t g = 0; g < nrevamp; g++) {
+                offsets[g + 1] += offsets[g];
+            }
+            std::vector<int> members(unrevamp.size());
+            {
+                std::vector<int> cursor(offsets.begin(), offsets.end() - 1);
+                for (intptr_t i = 0; i < (intptr_t)unrevamp.size(); i++) {
+                    members[cursor[unrevamp[i]]++] = i;
+                }
+            }
+            auto average = [&] (auto &arr) {
                 using T = std::decay_t<decltype(arr[0])>;
                 std::vector<T> new_arr(nrevamp);
-                for (size_t i = 0; i < arr.size(); i++) {
-                    new_arr[unrevamp[i]] += arr[i] / (T)lut.count(i);
+#pragma omp parallel for
+                for (intptr_t g = 0; g < nrevamp; g++) {
+                    int beg = offsets[g], end = offsets[g + 1];
+                    T sum = arr[members[beg]];
+                    for (int k = beg + 1; k < end; k++) {
+                        sum += arr[members[k]];
+                    }
+                    new_arr[g] = sum / (T)(end - beg);
                 }
                 arr = std::move(new_arr);
+            };
+            average(prim->verts.values);
+            prim->verts.foreach_attr<AttrAcceptAll>([&] (auto const &key, auto &arr) {
+                average(arr);
             });
         } else {
+            auto pick = [&] (auto &arr) {
+                using T = std::decay_t<decltype(arr[0])>;
+                std::vector<T> new_arr(nrevamp);
+#pragma omp parallel for
+                for (intptr_t g = 0; g < nrevamp; g++) {
+                    new_arr[g] = arr[revamp[g]];
+                }
+                arr = std::move(new_arr);
+            };
+            pick(prim->verts.values);
             prim->verts.foreach_attr<AttrAcceptAll>([&] (auto const &key, auto &arr) {
-                revamp_vector(arr, revamp);
+                pick(arr);
             });
         }
 
@@ -84,12 +208,14 @@ struct PrimWeld : INode {
                 x = unrevamp[x];
         };
 
-        for (size_t i = 0; i < prim->points.size(); i++) {
+#pragma omp parallel for
+        for (intptr_t i = 0; i < prim->points.size(); i++) {
             auto &ind = prim->points[i];
             repair(ind);
         }
 
-        for (size_t i = 0; i < prim->lines.size(); i++) {
+#pragma omp parallel for
+        for (intptr_t i = 0; i < prim->lines.size(); i++) {
             auto &ind = prim->lines[i];
             repair(ind[0]);
             repair(ind[1]);
@@ -99,7 +225,8 @@ struct PrimWeld : INode {
         }), prim->lines.end());
         prim->lines.update();
 
-        for (size_t i = 0; i < prim->tris.size(); i++) {
+#pragma omp parallel for
+        for (intptr_t i = 0; i < prim->tris.size(); i++) {
             auto &ind = prim->tris[i];
             repair(ind[0]);
             repair(ind[1]);
@@ -109,7 +236,8 @@ struct PrimWeld : INode {
             return ind[0] == ind[1] || ind[0] == ind[2] || ind[1] == ind[2];
         }), prim->tris.end());
 
-        for (size_t i = 0; i < prim->quads.size(); i++) {
+#pragma omp parallel for
+        for (intptr_t i = 0; i < prim->quads.size(); i++) {
             auto &ind = prim->quads[i];
             repair(ind[0]);
             repair(ind[1]);
@@ -134,7 +262,8 @@ struct PrimWeld : INode {
         }), prim->quads.end());
         prim->quads.update();
 
-        for (size_t i = 0; i < prim->loops.size(); i++) {
+#pragma omp parallel for
+        for (intptr_t i = 0; i < prim->loops.size(); i++) {
             auto &ind = prim->loops[i];
             repair(ind);
         }
@@ -161,6 +290,8 @@ ZENDEFNODE(PrimWeld, {
     {"PrimitiveObject", "prim"},
     {"string", "tagAttr", "weld"},
     {"enum oneof average", "method", "oneof"},
+    {"enum tag pos", "weldBy", "tag"},
+    {"float", "distance", "0.00001"},
     },
     {
     {"PrimitiveObject", "prim"},
@@ -1,133 +1,419 @@
 #include <zeno/zeno.h>
 #include <zeno/types/PrimitiveObject.h>
+#include <zeno/types/UserData.h>
 #include <zeno/funcs/PrimitiveUtils.h>
 #include <zeno/types/StringObject.h>
+#include <zeno/utils/MappedFile.h>
 #include <zeno/utils/string.h>
-#include <zeno/utils/fileio.h>
 #include <zeno/utils/logger.h>
 #include <zeno/utils/vec.h>
+#include <unordered_map>
 #include <string_view>
 #include <algorithm>
 #include <cstring>
 #include <cstdlib>
-#include <cassert>
-#include <cstdio>
-#include <fstream>
+#include <cstdint>
+#include <string>
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 namespace zeno {
 namespace {
 
-template <std::size_t ...Is>
-static bool match_helper(char const *&it, char const *arr, std::index_sequence<Is...>) {
-    if (((it[Is] == arr[Is]) && ...)) {
-        it += sizeof...(Is);
-        return true;
-    } else {
-        return false;
-    }
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
 }
 
-template <std::size_t N>
-static bool match(char const *&it, char const (&arr)[N]) {
-    return match_helper(it, arr, std::make_index_sequence<N - 1>{});
+static void skip_space(char const *&it, char const *eit) {
+    while (it != eit && is_space(*it))
+        ++it;
 }
 
-static float takef(char const *&it) {
+// fast path for the plain decimals exporters write, anything else (too many digits,
+// inf, nan, hex...) falls back to strtof on a bounded copy
+static float takef(char const *&it, char const *eit) {
+    static constexpr double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    skip_space(it, eit);
+    char const *p = it;
+    bool neg = false;
+    if (p != eit && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+    uint64_t mant = 0;
+    int ndigits = 0, exp10 = 0;
+    for (; p != eit && unsigned(*p - '0') < 10; ++p, ++ndigits)
+        mant = mant * 10 + (*p - '0');
+    if (p != eit && *p == '.') {
+        ++p;
+        for (; p != eit && unsigned(*p - '0') < 10; ++p, ++ndigits, --exp10)
+            mant = mant * 10 + (*p - '0');
+    }
+    bool ok = ndigits != 0 && ndigits <= 18;
+    if (ok && p != eit && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool eneg = false;
+        if (p != eit && (*p == '-' || *p == '+'))
+            eneg = *p++ == '-';
+        int e = 0;
+        char const *edigits = p;
+        for (; p != eit && unsigned(*p - '0') < 10 && e < 10000; ++p)
+            e = e * 10 + (*p - '0');
+        ok = p != edigits;
+        exp10 += eneg ? -e : e;
+    }
+    if (ok && exp10 >= -22 && exp10 <= 22) {
+        double val = (double)mant;
+        val = exp10 < 0 ? val / pow10[-exp10] : val * pow10[exp10];
+        it = p;
+        return (float)(neg ? -val : val);
+    }
+    char buf[64];
+    auto n = std::min<std::size_t>(std::find_if(it, eit, is_space) - it, sizeof(buf) - 1);
+    std::memcpy(buf, it, n);
+    buf[n] = 0;
     char *eptr;
-    float val = std::strtof(it, &eptr);
-    it = eptr;
+    float val = std::strtof(buf, &eptr);
+    it += eptr - buf;
     return val;
 }
 
-static int takeu(char const *&it) {
-    char *eptr;
-    int val(std::strtoul(it, &eptr, 10));
-    it = eptr;
-    return val;
+static int takei(char const *&it, char const *eit) {
+    bool neg = false;
+    if (it != eit && (*it == '-' || *it == '+'))
+        neg = *it++ == '-';
+    int val = 0;
+    for (; it != eit && unsigned(*it - '0') < 10; ++it)
+        val = val * 10 + (*it - '0');
+    return neg ? -val : val;
 }
 
-std::shared_ptr<PrimitiveObject> parse_obj(std::vector<char> &&bin) {
-    /*bin.resize(bin.size() + 8, '\0');*/
+enum class ObjLine {
+    none, vert, uv, nrm, face, line, mtl, obj,
+};
 
-    char const *it = bin.data();
-    char const *eit = bin.data() + bin.size();// - 8;
+// classifies a line by its keyword and skips past it
+static ObjLine take_keyword(char const *&it, char const *nit) {
+    skip_space(it, nit);
+    std::size_t len = nit - it;
+    auto kw = [&] (char const *name, std::size_t n, ObjLine kind) {
+        if (len > n && std::memcmp(it, name, n) == 0 && is_space(it[n])) {
+            it += n + 1;
+            return kind;
+        }
+        return ObjLine::none;
+    };
+    switch (len ? it[0] : 0) {
+    case 'v':
+        if (len > 1 && is_space(it[1]))
+            return kw("v", 1, ObjLine::vert);
+        if (len > 1 && it[1] == 't')
+            return kw("vt", 2, ObjLine::uv);
+        return kw("vn", 2, ObjLine::nrm);
+    case 'f': return kw("f", 1, ObjLine::face);
+    case 'l': return kw("l", 1, ObjLine::line);
+    case 'o': return kw("o", 1, ObjLine::obj);
+    case 'g': return kw("g", 1, ObjLine::obj);
+    case 'u': return kw("usemtl", 6, ObjLine::mtl);
+    default: return ObjLine::none;
+    }
+}
 
-    auto prim = std::make_shared<PrimitiveObject>();
+template <class F>
+static void foreach_line(char const *it, char const *eit, F const &f) {
+    while (it < eit) {
+        auto nit = (char const *)std::memchr(it, '\n', eit - it);
+        if (!nit)
+            nit = eit;
+        f(it, nit);
+        it = nit + 1;
+    }
+}
+
+static std::string_view take_name(char const *it, char const *nit) {
+    skip_space(it, nit);
+    std::string_view name(it, nit - it);
+    while (!name.empty() && is_space(name.back()))
+        name.remove_suffix(1);
+    return name;
+}
+
+// where the elements with a known count go in the whole primitive
+struct ObjTarget {
+    vec3f *verts;
+    vec2f *uvs;
+    vec3f *nrms;
+    vec2i *polys;      // loop bases are slice local until the loops get merged
+    int *poly_mtls;    // slice local name ids, -2 for inherited from the previous slice
+    int *poly_objs;
+};
+
+// a line-aligned slice of the file: the first pass counts its verts, uvs, normals and
+// faces, so the second one already knows their global indices and writes them in place
+struct ObjChunk {
+    char const *beg;
+    char const *end;
+    std::size_t nverts = 0, nuvs = 0, nnrms = 0, npolys = 0;
+    std::vector<int> loops;
     std::vector<int> loop_uvs;
+    std::vector<int> loop_nrms;
+    std::vector<vec2i> lines;
+    std::vector<std::string> mtl_names;
+    std::vector<std::string> obj_names;
+    std::unordered_map<std::string, int> mtl_lut;
+    std::unordered_map<std::string, int> obj_lut;
+    int last_mtl = -2;  // names active at the slice end, as local ids
+    int last_obj = -2;
+    bool has_mtls = false;
+    bool has_objs = false;
 
-    while (it < eit) {
-        auto nit = std::find(it, eit, '\n');
-        auto nnit = nit + 1;
-        if (nit[-1] == '\r')
-            --nit;
-
-        if (match(it, "v ")) {
-            float x = takef(it);
-            float y = takef(it);
-            float z = takef(it);
-            prim->verts.emplace_back(x, y, z);
-
-        } else if (match(it, "vt ")) {
-            float x = takef(it);
-            float y = takef(it);
-            prim->uvs.emplace_back(x, y);
-
-        } else if (match(it, "f ")) {
-            int beg = prim->loops.size();
-            int cnt{};
-            while (it != nit) {
-                int x = takeu(it) - 1;
-                if (*it == '/' && it[1] != '/') {
-                    ++it;
-                    int xt = takeu(it) - 1;
-                    loop_uvs.push_back(xt);
+    // absolute indices are 1-based, relative ones count back from the last element
+    static int index(int idx, std::size_t count) {
+        return idx < 0 ? (int)count + idx : idx - 1;
+    }
+
+    static int name_id(std::vector<std::string> &names, std::unordered_map<std::string, int> &lut, std::string_view name) {
+        auto [it, fresh] = lut.try_emplace(std::string(name), (int)names.size());
+        if (fresh)
+            names.emplace_back(name);
+        return it->second;
+    }
+
+    void count() {
+        foreach_line(beg, end, [&] (char const *it, char const *nit) {
+            switch (take_keyword(it, nit)) {
+            case ObjLine::vert: nverts++; break;
+            case ObjLine::uv: nuvs++; break;
+            case ObjLine::nrm: nnrms++; break;
+            case ObjLine::face: npolys++; break;
+            default: break;
+            }
+        });
+    }
+
+    // vi, ti, ni, fi start at the global index of the first vert, uv, normal and face
+    void parse(ObjTarget const &out, std::size_t vi, std::size_t ti, std::size_t ni, std::size_t fi) {
+        loops.reserve(npolys * 4);
+        int &cur_mtl = last_mtl, &cur_obj = last_obj;
+        foreach_line(beg, end, [&] (char const *it, char const *nit) {
+            switch (take_keyword(it, nit)) {
+            case ObjLine::vert: {
+                float x = takef(it, nit);
+                float y = takef(it, nit);
+                float z = takef(it, nit);
+                out.verts[vi++] = vec3f(x, y, z);
+            } break;
+            case ObjLine::uv: {
+                float x = takef(it, nit);
+                float y = takef(it, nit);
+                out.uvs[ti++] = vec2f(x, y);
+            } break;
+            case ObjLine::nrm: {
+                float x = takef(it, nit);
+                float y = takef(it, nit);
+                float z = takef(it, nit);
+                out.nrms[ni++] = vec3f(x, y, z);
+            } break;
+            case ObjLine::face: {
+                int beg = loops.size();
+                skip_space(it, nit);
+                while (it != nit) {
+                    loops.push_back(index(takei(it, nit), vi));
+                    if (it != nit && *it == '/') {
+                        ++it;
+                        if (it != nit && *it != '/')
+                            loop_uvs.push_back(index(takei(it, nit), ti));
+                        if (it != nit && *it == '/') {
+                            ++it;
+                            loop_nrms.push_back(index(takei(it, nit), ni));
+                        }
+                    }
+                    it = std::find_if(it, nit, is_space);
+                    skip_space(it, nit);
+                }
+                out.polys[fi] = vec2i(beg, (int)loops.size() - beg);
+                out.poly_mtls[fi] = cur_mtl;
+                out.poly_objs[fi] = cur_obj;
+                fi++;
+            } break;
+            case ObjLine::line: {
+                skip_space(it, nit);
+                int last = index(takei(it, nit), vi);
+                for (;;) {
+                    it = std::find_if(it, nit, is_space);
+                    skip_space(it, nit);
+                    if (it == nit)
+                        break;
+                    int next = index(takei(it, nit), vi);
+                    lines.emplace_back(last, next);
+                    last = next;
                 }
-                it = std::find(it, nit, ' ');
-                prim->loops.push_back(x);
-                ++cnt;
-                it = std::find_if(it, nit, [] (char c) { return c != ' '; });
+            } break;
+            case ObjLine::mtl:
+                cur_mtl = name_id(mtl_names, mtl_lut, take_name(it, nit));
+                has_mtls = true;
+                break;
+            case ObjLine::obj:
+                cur_obj = name_id(obj_names, obj_lut, take_name(it, nit));
+                has_objs = true;
+                break;
+            default: break;
             }
-            prim->polys.emplace_back(beg, cnt);
+        });
+    }
+};
 
-        } else if (match(it, "l ")) {
-            int x = takeu(it) - 1;
-            int y = takeu(it) - 1;
-            prim->lines.emplace_back(x, y);
+// the file is cut into line-aligned slices parsed concurrently, counted beforehand so
+// that the primitive is allocated once and each slice writes its own part of it
+std::shared_ptr<PrimitiveObject> parse_obj(char const *data, std::size_t size) {
+    auto prim = std::make_shared<PrimitiveObject>();
+    if (!size)
+        return prim;
 
-        //} else if (match(it, "o ")) {
-            // todo: support tag verts to be multi components of primitive
-            //std::string_view o_name(it, nit - it);
+#if defined(_OPENMP)
+    std::size_t nthreads = omp_get_max_threads();
+#else
+    std::size_t nthreads = 1;
+#endif
+    std::size_t nchunks = std::max<std::size_t>(1, std::min(size >> 20, nthreads * 8));
+    std::vector<ObjChunk> chunks(nchunks);
+    for (std::size_t c = 0; c < nchunks; c++) {
+        auto it = c ? std::max(data + size / nchunks * c, chunks[c - 1].beg) : data;
+        if (c) {
+            auto nit = (char const *)std::memchr(it, '\n', data + size - it);
+            it = nit ? nit + 1 : data + size;
+            chunks[c - 1].end = it;
+        }
+        chunks[c].beg = it;
+    }
+    chunks[nchunks - 1].end = data + size;
+
+#pragma omp parallel for schedule(dynamic)
+    for (intptr_t c = 0; c < (intptr_t)nchunks; c++) {
+        chunks[c].count();
+    }
+
+    struct Offsets {
+        std::size_t verts = 0, uvs = 0, nrms = 0, polys = 0, loops = 0, lines = 0;
+    };
+    std::vector<Offsets> offs(nchunks + 1);
+    for (std::size_t c = 0; c < nchunks; c++) {
+        offs[c + 1].verts = offs[c].verts + chunks[c].nverts;
+        offs[c + 1].uvs = offs[c].uvs + chunks[c].nuvs;
+        offs[c + 1].nrms = offs[c].nrms + chunks[c].nnrms;
+        offs[c + 1].polys = offs[c].polys + chunks[c].npolys;
+    }
+    prim->verts.resize(offs[nchunks].verts);
+    prim->uvs.resize(offs[nchunks].uvs);
+    prim->polys.resize(offs[nchunks].polys);
+    std::vector<vec3f> nrms(offs[nchunks].nrms);
+    std::vector<int> poly_mtls(offs[nchunks].polys);
+    std::vector<int> poly_objs(offs[nchunks].polys);
+    ObjTarget target{prim->verts.data(), prim->uvs.data(), nrms.data(),
+                     prim->polys.data(), poly_mtls.data(), poly_objs.data()};
+
+#pragma omp parallel for schedule(dynamic)
+    for (intptr_t c = 0; c < (intptr_t)nchunks; c++) {
+        auto const &o = offs[c];
+        chunks[c].parse(target, o.verts, o.uvs, o.nrms, o.polys);
+    }
 
+    bool has_uvs = true, has_nrms = true, has_mtls = false, has_objs = false;
+    for (std::size_t c = 0; c < nchunks; c++) {
+        auto const &ch = chunks[c];
+        offs[c + 1].loops = offs[c].loops + ch.loops.size();
+        offs[c + 1].lines = offs[c].lines + ch.lines.size();
+        has_uvs = has_uvs && ch.loop_uvs.size() == ch.loops.size();
+        has_nrms = has_nrms && ch.loop_nrms.size() == ch.loops.size();
+        has_mtls = has_mtls || ch.has_mtls;
+        has_objs = has_objs || ch.has_objs;
+    }
+    auto const &total = offs[nchunks];
+    has_uvs = has_uvs && total.loops;
+    has_nrms = has_nrms && total.loops && total.nrms;
+
+    prim->loops.resize(total.loops);
+    prim->lines.resize(total.lines);
+    std::vector<int> loop_uvs(has_uvs ? total.loops : 0);
+    std::vector<int> loop_nrms(has_nrms ? total.loops : 0);
+#pragma omp parallel for schedule(dynamic)
+    for (intptr_t c = 0; c < (intptr_t)nchunks; c++) {
+        auto const &ch = chunks[c];
+        auto const &o = offs[c];
+        std::copy(ch.loops.begin(), ch.loops.end(), prim->loops.begin() + o.loops);
+        if (has_uvs)
+            std::copy(ch.loop_uvs.begin(), ch.loop_uvs.end(), loop_uvs.begin() + o.loops);
+        if (has_nrms)
+            std::copy(ch.loop_nrms.begin(), ch.loop_nrms.end(), loop_nrms.begin() + o.loops);
+        std::copy(ch.lines.begin(), ch.lines.end(), prim->lines.begin() + o.lines);
+        for (std::size_t i = o.polys; i < offs[c + 1].polys; i++) {
+            prim->polys[i][0] += o.loops;
+        }
+    }
+    if (has_uvs) {
+        prim->loops.add_attr<int>("uvs") = std::move(loop_uvs);
+    }
+    if (has_nrms) {
+        // per-corner normals are moved onto the verts, split normals keep their last corner
+        auto &nrm = prim->verts.add_attr<vec3f>("nrm");
+        for (std::size_t i = 0; i < total.loops; i++) {
+            int v = prim->loops[i], j = loop_nrms[i];
+            if (v >= 0 && v < (int)total.verts && j >= 0 && j < (int)total.nrms)
+                nrm[v] = nrms[j];
         }
-        it = nnit;
     }
 
-    {
-        int vert_count = prim->verts.size();
-        for (auto &i : prim->loops) {
-            if (i < 0) {
-                i += vert_count + 1;
+    // slice-local name ids to global ones, a slice starts with whatever was last active
+    auto merge_names = [&] (auto nameList, auto lastId, std::vector<int> &polyIds, std::string const &prefix) {
+        std::vector<std::string> names;
+        std::unordered_map<std::string, int> lut;
+        int cur = -1;
+        for (std::size_t c = 0; c < nchunks; c++) {
+            std::vector<int> remap;
+            for (auto const &name: chunks[c].*nameList) {
+                auto [it, fresh] = lut.try_emplace(name, (int)names.size());
+                if (fresh)
+                    names.push_back(name);
+                remap.push_back(it->second);
             }
-        }
-        for (auto &i : loop_uvs) {
-            if (i < 0) {
-                i += vert_count + 1;
+            for (std::size_t i = offs[c].polys; i < offs[c + 1].polys; i++) {
+                polyIds[i] = polyIds[i] == -2 ? cur : remap[polyIds[i]];
             }
+            if (chunks[c].*lastId != -2)
+                cur = remap[chunks[c].*lastId];
+        }
+        for (std::size_t i = 0; i < names.size(); i++) {
+            prim->userData().set2(prefix + "_" + std::to_string(i), names[i]);
         }
+        return (int)names.size();
+    };
+    if (has_mtls) {
+        prim->userData().set2("matNum", merge_names(&ObjChunk::mtl_names, &ObjChunk::last_mtl, poly_mtls, "Material"));
+        prim->polys.add_attr<int>("matid") = std::move(poly_mtls);
     }
-
-    if (loop_uvs.size() == prim->loops.size()) {
-        prim->loops.add_attr<int>("uvs") = std::move(loop_uvs);
+    if (has_objs) {
+        prim->userData().set2("objNum", merge_names(&ObjChunk::obj_names, &ObjChunk::last_obj, poly_objs, "Object"));
+        prim->polys.add_attr<int>("objid") = std::move(poly_objs);
     }
 
     return prim;
 }
 
+std::shared_ptr<PrimitiveObject> read_obj(std::string const &path) {
+    MappedFile file(path);
+    if (!file.valid())
+        return nullptr;
+    return parse_obj(file.data(), file.size());
+}
+
 struct ReadObjPrim : INode {
     virtual void apply() override {
         auto path = get_input<StringObject>("path")->get();
-        auto binary = file_get_binary<std::vector<char>>(path);
-        auto prim = parse_obj(std::move(binary));
+        auto prim = read_obj(path);
+        if (!prim)
+            prim = std::make_shared<PrimitiveObject>();
         if (get_param<bool>("triangulate")) {
             primTriangulate(prim.get());
         }
@@ -149,12 +435,11 @@ ZENDEFNODE(ReadObjPrim,
 struct MustReadObjPrim : INode {
     virtual void apply() override {
         auto path = get_input2<std::string>("path");
-        auto binary = file_get_binary<std::vector<char>>(path);
-        if (binary.empty()) {
+        auto prim = read_obj(path);
+        if (!prim) {
             auto s = zeno::format("can not find {}", path);
             throw zeno::makeError(s);
         }
-        auto prim = parse_obj(std::move(binary));
         if (get_param<bool>("triangulate")) {
             primTriangulate(prim.get());
         }
@@ -4,6 +4,7 @@
 #include <zeno/types/StringObject.h>
 #include <zeno/utils/string.h>
 #include <zeno/utils/fileio.h>
+#include <zeno/utils/chunked_write.h>
 #include <zeno/utils/logger.h>
 #include <zeno/utils/vec.h>
 #include <string_view>
@@ -13,40 +14,37 @@
 #include <cassert>
 #include <cstdio>
 #include <fstream>
-#include <iomanip>
 
 namespace zeno {
 namespace {
 
 void dump_obj(PrimitiveObject *prim, std::ostream &fout) {
     fout << "# https://github.com/zenustech/zeno\n";
-    fout << std::setprecision(8);
-    for (auto const &[x, y, z]: prim->verts) {
-        fout << "v " << x << ' ' << y << ' ' << z << '\n';
-    }
+    write_chunked(fout, prim->verts.size(), [&] (ChunkBuffer &cb, size_t i) {
+        cb << "v " << prim->verts[i] << '\n';
+    });
     if (prim->loops.size() && prim->loops.has_attr("uvs")) {
         auto &loop_uvs = prim->loops.attr<int>("uvs");
-        for (auto const &[x, y]: prim->uvs) {
-            fout << "vt " << x << ' ' << y << '\n';
-        }
-        for (auto const &[base, len]: prim->polys) {
-            fout << 'f';
+        write_chunked(fout, prim->uvs.size(), [&] (ChunkBuffer &cb, size_t i) {
+            cb << "vt " << prim->uvs[i] << '\n';
+        });
+        write_chunked(fout, prim->polys.size(), [&] (ChunkBuffer &cb, size_t i) {
+            auto [base, len] = prim->polys[i];
+            cb << 'f';
             for (int j = base; j < base + len; j++) {
-                auto l = prim->loops[j] + 1;
-                auto lt = loop_uvs[j] + 1;
-                fout << ' ' << l << '/' << lt;
+                cb << ' ' << prim->loops[j] + 1 << '/' << loop_uvs[j] + 1;
             }
-            fout << '\n';
-        }
+            cb << '\n';
+        });
     } else {
-        for (auto const &[base, len]: prim->polys) {
-            fout << 'f';
+        write_chunked(fout, prim->polys.size(), [&] (ChunkBuffer &cb, size_t i) {
+            auto [base, len] = prim->polys[i];
+            cb << 'f';
             for (int j = base; j < base + len; j++) {
-                auto l = prim->loops[j] + 1;
-                fout << ' ' << l;
+                cb << ' ' << prim->loops[j] + 1;
             }
-            fout << '\n';
-        }
+            cb << '\n';
+        });
     }
 }
 
@@ -57,8 +55,9 @@ struct WriteObjPrim : INode {
         if (get_param<bool>("polygonate")) {
             primPolygonate(prim.get());
         }
-        std::ofstream fout(path);
+        auto fout = open_chunked(path);
         dump_obj(prim.get(), fout);
+        close_chunked(fout, path);
         set_output("prim", std::move(prim));
     }
 };
@@ -0,0 +1,143 @@
+#include <zeno/zeno.h>
+#include <zeno/types/PrimitiveObject.h>
+#include <zeno/types/StringObject.h>
+#include <zeno/utils/chunked_write.h>
+#include <zeno/utils/vec.h>
+#include <functional>
+#include <cstdint>
+#include <fstream>
+
+namespace zeno {
+namespace {
+
+template <class T>
+constexpr char const *ply_type_name() {
+    if constexpr (std::is_same_v<T, int>) {
+        return "int";
+    } else {
+        return "float";
+    }
+}
+
+template <class T>
+void ply_put(ChunkBuffer &cb, T const &val, bool binary) {
+    if (binary) {
+        cb.put(val);
+    } else {
+        cb << ' ' << val;
+    }
+}
+
+// binary_little_endian unless asked for ascii, every vertex attribute is written as
+// a property (vectors get one per component), faces are tris, quads then polys
+void dump_ply(PrimitiveObject *prim, std::ostream &fout, bool binary) {
+    std::vector<std::string> props{"float x", "float y", "float z"};
+    std::vector<std::function<void(ChunkBuffer &, size_t)>> columns;
+    prim->verts.foreach_attr<AttrAcceptAll>([&] (auto const &key, auto const &arr) {
+        using T = std::decay_t<decltype(arr[0])>;
+        if constexpr (is_vec_v<T>) {
+            constexpr size_t N = is_vec_n<T>;
+            for (size_t d = 0; d < N; d++) {
+                auto name = key == "nrm" && N == 3 ? std::string("n") + "xyz"[d] : key + '_' + "xyzw"[d];
+                props.push_back(std::string(ply_type_name<decay_vec_t<T>>()) + ' ' + name);
+            }
+        } else {
+            props.push_back(std::string(ply_type_name<T>()) + ' ' + key);
+        }
+        columns.emplace_back([&arr, binary] (ChunkBuffer &cb, size_t i) {
+            ply_put(cb, arr[i], binary);
+        });
+    });
+
+    size_t ntris = prim->tris.size(), nquads = prim->quads.size(), npolys = prim->polys.size();
+    size_t nfaces = ntris + nquads + npolys;
+    bool longPolys = false;
+    for (auto const &[base, len]: prim->polys) {
+        longPolys = longPolys || len > 255;
+    }
+
+    fout << "ply\n";
+    fout << (binary ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n");
+    fout << "comment https://github.com/zenustech/zeno\n";
+    fout << "element vertex " << prim->verts.size() << '\n';
+    for (auto const &prop: props) {
+        fout << "property " << prop << '\n';
+    }
+    fout << "element face " << nfaces << '\n';
+    fout << (longPolys ? "property list int int vertex_indices\n" : "property list uchar int vertex_indices\n");
+    fout << "element edge " << prim->lines.size() << '\n';
+    fout << "property int vertex1\nproperty int vertex2\n";
+    fout << "end_header\n";
+
+    write_chunked(fout, prim->verts.size(), [&] (ChunkBuffer &cb, size_t i) {
+        if (binary) {
+            cb.put(prim->verts[i]);
+        } else {
+            cb << prim->verts[i];
+        }
+        for (auto const &column: columns) {
+            column(cb, i);
+        }
+        if (!binary)
+            cb << '\n';
+    });
+
+    auto putFace = [&] (ChunkBuffer &cb, int const *ind, int len) {
+        if (!binary) {
+            cb << len;
+        } else if (longPolys) {
+            cb.put(len);
+        } else {
+            cb.put((uint8_t)len);
+        }
+        for (int j = 0; j < len; j++) {
+            ply_put(cb, ind[j], binary);
+        }
+        if (!binary)
+            cb << '\n';
+    };
+    write_chunked(fout, nfaces, [&] (ChunkBuffer &cb, size_t i) {
+        if (i < ntris) {
+            putFace(cb, prim->tris[i].data(), 3);
+        } else if (i < ntris + nquads) {
+            putFace(cb, prim->quads[i - ntris].data(), 4);
+        } else {
+            auto [base, len] = prim->polys[i - ntris - nquads];
+            putFace(cb, prim->loops.data() + base, len);
+        }
+    });
+
+    write_chunked(fout, prim->lines.size(), [&] (ChunkBuffer &cb, size_t i) {
+        if (binary) {
+            cb.put(prim->lines[i]);
+        } else {
+            cb << prim->lines[i] << '\n';
+        }
+    });
+}
+
+struct WritePlyPrim : INode {
+    virtual void apply() override {
+        auto prim = get_input<PrimitiveObject>("prim");
+        auto path = get_input<StringObject>("path")->get();
+        auto fout = open_chunked(path);
+        dump_ply(prim.get(), fout, get_input2<bool>("binary"));
+        close_chunked(fout, path);
+        set_output("prim", std::move(prim));
+    }
+};
+
+ZENDEFNODE(WritePlyPrim,
+        { /* inputs: */ {
+        {"primitive", "prim"},
+        {"writepath", "path"},
+        {"bool", "binary", "1"},
+        }, /* outputs: */ {
+        {"primitive", "prim"},
+        }, /* params: */ {
+        }, /* category: */ {
+        "primitive",
+        }});
+
+}
+}
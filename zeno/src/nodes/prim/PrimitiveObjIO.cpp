@@ -6,6 +6,7 @@
 #include <zeno/utils/string.h>
 #include <zeno/utils/logger.h>
 #include <zeno/utils/vec.h>
+#include <zeno/utils/chunked_write.h>
 #include <cstring>
 #include <cstdlib>
 #include <cassert>
@@ -136,38 +137,33 @@ static void writeobj(
         std::shared_ptr<zeno::PrimitiveObject> &prim,
         const char *path)
 {
-    FILE *fp = fopen(path, "w");
-    if (!fp) {
-        perror(path);
-        abort();
-    }
-    for (auto const &vert: prim->verts) {
-        fprintf(fp, "v %f %f %f\n", vert[0], vert[1], vert[2]);
-    }
+    auto fout = zeno::open_chunked(path);
+    zeno::write_chunked(fout, prim->verts.size(), [&] (zeno::ChunkBuffer &cb, size_t i) {
+        cb << "v " << prim->verts[i] << '\n';
+    });
     if (prim->tris.has_attr("uv0")) {
         auto& uv0 = prim->tris.attr<zeno::vec3f>("uv0");
         auto& uv1 = prim->tris.attr<zeno::vec3f>("uv1");
         auto& uv2 = prim->tris.attr<zeno::vec3f>("uv2");
-        for (auto i = 0; i < prim->tris.size(); i++) {
-            fprintf(fp, "vt %f %f %f\n", uv0[i][0], uv0[i][1], uv0[i][2]);
-            fprintf(fp, "vt %f %f %f\n", uv1[i][0], uv1[i][1], uv1[i][2]);
-            fprintf(fp, "vt %f %f %f\n", uv2[i][0], uv2[i][1], uv2[i][2]);
-        }
-        int count = 0;
-        for (auto const &ind: prim->tris) {
-            fprintf(fp, "f %d/%d %d/%d %d/%d\n",
-                ind[0] + 1, count + 1,
-                ind[1] + 1, count + 2,
-                ind[2] + 1, count + 3
-            );
-            count += 3;
-        }
+        zeno::write_chunked(fout, prim->tris.size(), [&] (zeno::ChunkBuffer &cb, size_t i) {
+            cb << "vt " << uv0[i] << '\n';
+            cb << "vt " << uv1[i] << '\n';
+            cb << "vt " << uv2[i] << '\n';
+        });
+        zeno::write_chunked(fout, prim->tris.size(), [&] (zeno::ChunkBuffer &cb, size_t i) {
+            auto const &ind = prim->tris[i];
+            int count = i * 3;
+            cb << "f " << ind[0] + 1 << '/' << count + 1
+               << ' ' << ind[1] + 1 << '/' << count + 2
+               << ' ' << ind[2] + 1 << '/' << count + 3 << '\n';
+        });
     } else {
-        for (auto const &ind: prim->tris) {
-            fprintf(fp, "f %d %d %d\n", ind[0] + 1, ind[1] + 1, ind[2] + 1);
-        }
+        zeno::write_chunked(fout, prim->tris.size(), [&] (zeno::ChunkBuffer &cb, size_t i) {
+            auto const &ind = prim->tris[i];
+            cb << "f " << ind[0] + 1 << ' ' << ind[1] + 1 << ' ' << ind[2] + 1 << '\n';
+        });
     }
-    fclose(fp);
+    zeno::close_chunked(fout, path);
 }
 
 
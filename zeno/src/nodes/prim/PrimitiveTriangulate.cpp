@@ -72,12 +72,15 @@ ZENO_API void primTriangulate(PrimitiveObject *prim, bool with_uv, bool has_line
     } else {
         prim->tris.add_attr<int>("matid");
     }
+    // fetch the arrays once, outside of the parallel loops
+    auto &poly_matid = prim->polys.attr<int>("matid");
+    auto &tri_matid = prim->tris.attr<int>("matid");
 
 
     if (!(prim->loops.has_attr("uvs") && prim->uvs.size() > 0) || !with_uv) {
         parallel_for(prim->polys.size(), [&] (size_t i) {
             auto [start, len] = prim->polys[i];
-            auto matidx = prim->polys.attr<int>("matid")[i];
+            auto matidx = poly_matid[i];
             if (len >= 3) {
                 int scanbase;
                 if constexpr (has_lines.value) {
@@ -89,14 +92,14 @@ ZENO_API void primTriangulate(PrimitiveObject *prim, bool with_uv, bool has_line
                         prim->loops[start],
                         prim->loops[start + 1],
                         prim->loops[start + 2]);
-                prim->tris.attr<int>("matid")[scanbase] = matidx;
+                tri_matid[scanbase] = matidx;
                 scanbase++;
                 for (int j = 3; j < len; j++) {
                     prim->tris[scanbase] = vec3i(
                             prim->loops[start],
                             prim->loops[start + j - 1],
                             prim->loops[start + j]);
-                    prim->tris.attr<int>("matid")[scanbase] = matidx;
+                    tri_matid[scanbase] = matidx;
                     scanbase++;
                 }
             }
@@ -119,7 +122,7 @@ ZENO_API void primTriangulate(PrimitiveObject *prim, bool with_uv, bool has_line
 
         parallel_for(prim->polys.size(), [&] (size_t i) {
             auto [start, len] = prim->polys[i];
-            auto matidx = prim->polys.attr<int>("matid")[i];
+            auto matidx = poly_matid[i];
             if (len >= 3) {
                 int scanbase;
                 if constexpr (has_lines.value) {
@@ -134,7 +137,7 @@ ZENO_API void primTriangulate(PrimitiveObject *prim, bool with_uv, bool has_line
                         prim->loops[start],
                         prim->loops[start + 1],
                         prim->loops[start + 2]);
-                prim->tris.attr<int>("matid")[scanbase] = matidx;
+                tri_matid[scanbase] = matidx;
                 scanbase++;
                 for (int j = 3; j < len; j++) {
                     uv0[scanbase] = {uvs[loop_uv[start]][0], uvs[loop_uv[start]][1], 0};
@@ -144,7 +147,7 @@ ZENO_API void primTriangulate(PrimitiveObject *prim, bool with_uv, bool has_line
                             prim->loops[start],
                             prim->loops[start + j - 1],
                             prim->loops[start + j]);
-                    prim->tris.attr<int>("matid")[scanbase] = matidx;
+                    tri_matid[scanbase] = matidx;
                     scanbase++;
                 }
             }
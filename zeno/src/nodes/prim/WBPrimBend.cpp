@@ -779,13 +779,14 @@ struct HeightStarPattern : zeno::INode {
         auto sharpness = get_input2<float>("sharpness");
         auto starness = get_input2<float>("starness");
         auto sides = get_input2<int>("sides");
-        prim->verts.add_attr<float>("result");
+        auto &res = prim->verts.attr<vec3f>("res");
+        auto &results = prim->verts.add_attr<float>("result");
 
         std::uniform_real_distribution<float> dist(0, 1);
 
 #pragma omp parallel for
         for (int i = 0; i < prim->verts.size(); i++) {
-            auto coord = prim->verts.attr<vec3f>("res")[i];
+            auto coord = res[i];
             vec2f coord2d = vec2f(coord[0], coord[1]);
             vec2f cellcenter = vec2f(floor(coord2d[0]), floor(coord2d[1]));
             float result = 0;
@@ -817,7 +818,7 @@ struct HeightStarPattern : zeno::INode {
                     }
                 }
             }
-            prim->verts.attr<float>("result")[i] = result;
+            results[i] = result;
         }
         prim->verts.erase_attr("res");
         set_output("prim", std::move(prim));
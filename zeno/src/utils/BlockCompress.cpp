@@ -0,0 +1,156 @@
+#include <zeno/utils/BlockCompress.h>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+namespace zeno {
+
+namespace {
+
+constexpr std::size_t kMinMatch = 4;
+constexpr std::size_t kLastLiterals = 5;  // the tail is always stored as literals
+constexpr std::size_t kMaxOffset = 65535;
+constexpr int kHashLog = 16;
+
+inline uint32_t read32(const char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - kHashLog);
+}
+
+inline char *writeLength(char *op, std::size_t len) {
+    while (len >= 255) {
+        *op++ = (char)255;
+        len -= 255;
+    }
+    *op++ = (char)len;
+    return op;
+}
+
+inline bool readLength(const unsigned char *&ip, const unsigned char *iend, std::size_t &len) {
+    unsigned char c;
+    do {
+        if (ip >= iend)
+            return false;
+        c = *ip++;
+        len += c;
+    } while (c == 255);
+    return true;
+}
+
+inline char *writeSequence(char *op, const char *lit, std::size_t litLen, std::size_t offset, std::size_t matchLen) {
+    auto token = op++;
+    *token = (char)(std::min<std::size_t>(litLen, 15) << 4);
+    if (litLen >= 15)
+        op = writeLength(op, litLen - 15);
+    std::memcpy(op, lit, litLen);
+    op += litLen;
+    if (matchLen) {
+        *op++ = (char)(offset & 0xff);
+        *op++ = (char)(offset >> 8);
+        std::size_t ml = matchLen - kMinMatch;
+        *token |= (char)std::min<std::size_t>(ml, 15);
+        if (ml >= 15)
+            op = writeLength(op, ml - 15);
+    }
+    return op;
+}
+
+}
+
+ZENO_API std::size_t blockCompressBound(std::size_t n) {
+    return n + n / 255 + 16;
+}
+
+ZENO_API std::size_t blockCompress(const char *src, std::size_t n, char *dst) {
+    char *op = dst;
+    std::size_t anchor = 0;
+    if (n > kLastLiterals + kMinMatch) {
+        std::vector<uint32_t> table(std::size_t(1) << kHashLog);  // position + 1, 0 for empty
+        std::size_t limit = n - kLastLiterals;
+        std::size_t ip = 0;
+        while (ip + kMinMatch <= limit) {
+            uint32_t seq = read32(src + ip);
+            auto &slot = table[hash32(seq)];
+            std::size_t ref = slot;
+            slot = (uint32_t)(ip + 1);
+            if (ref && ip - (ref - 1) <= kMaxOffset && read32(src + ref - 1) == seq) {
+                ref--;
+                std::size_t len = kMinMatch;
+                while (ip + len < limit && src[ref + len] == src[ip + len])
+                    len++;
+                op = writeSequence(op, src + anchor, ip - anchor, ip - ref, len);
+                ip += len;
+                anchor = ip;
+            } else {
+                ip += 1 + ((ip - anchor) >> 6);  // skip faster through incompressible data
+            }
+        }
+    }
+    op = writeSequence(op, src + anchor, n - anchor, 0, 0);
+    return op - dst;
+}
+
+ZENO_API bool blockDecompress(const char *src, std::size_t n, char *dst, std::size_t rawSize) {
+    auto ip = (const unsigned char *)src;
+    auto iend = ip + n;
+    std::size_t op = 0;
+    while (ip < iend) {
+        unsigned token = *ip++;
+        std::size_t litLen = token >> 4;
+        if (litLen == 15 && !readLength(ip, iend, litLen))
+            return false;
+        if (litLen > std::size_t(iend - ip) || litLen > rawSize - op)
+            return false;
+        std::memcpy(dst + op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip == iend)
+            break;  // the last sequence has no match part
+
+        if (iend - ip < 2)
+            return false;
+        std::size_t offset = ip[0] | (std::size_t(ip[1]) << 8);
+        ip += 2;
+        std::size_t matchLen = token & 15;
+        if (matchLen == 15 && !readLength(ip, iend, matchLen))
+            return false;
+        matchLen += kMinMatch;
+        if (offset == 0 || offset > op || matchLen > rawSize - op)
+            return false;
+        char *out = dst + op;
+        const char *ref = out - offset;
+        if (offset >= matchLen) {
+            std::memcpy(out, ref, matchLen);
+        } else {
+            for (std::size_t i = 0; i < matchLen; i++)  // overlapping copy repeats the pattern
+                out[i] = ref[i];
+        }
+        op += matchLen;
+    }
+    return op == rawSize;
+}
+
+ZENO_API void byteShuffle(const char *src, char *dst, std::size_t n, std::size_t stride) {
+    std::size_t count = n / stride;
+    for (std::size_t b = 0; b < stride; b++) {
+        char *out = dst + b * count;
+        for (std::size_t i = 0; i < count; i++)
+            out[i] = src[i * stride + b];
+    }
+}
+
+ZENO_API void byteUnshuffle(const char *src, char *dst, std::size_t n, std::size_t stride) {
+    std::size_t count = n / stride;
+    for (std::size_t b = 0; b < stride; b++) {
+        const char *in = src + b * count;
+        for (std::size_t i = 0; i < count; i++)
+            dst[i * stride + b] = in[i];
+    }
+}
+
+}
@@ -0,0 +1,105 @@
+#include <zeno/utils/FrameHeap.h>
+#include <zeno/utils/log.h>
+#include <typeindex>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <map>
+
+namespace zeno::frame_heap {
+
+namespace {
+
+struct Idle {
+    std::unique_ptr<Buffer> buf;
+    std::type_index type;
+    std::size_t capacity;
+    int epoch;  // of the frame in which it was given back
+};
+
+struct Pool {
+    std::atomic<std::size_t> budget{0};  // 0 while disabled
+    std::mutex mtx;
+    std::list<Idle> idles;  // oldest first
+    std::multimap<std::pair<std::type_index, std::size_t>, std::list<Idle>::iterator> lut;
+    std::size_t idleBytes = 0;
+    int epoch = 0;
+
+    // moves the buffer out to dst, to be destroyed once the lock is released
+    void release(decltype(lut)::iterator it, std::list<Idle> &dst) {
+        idleBytes -= it->second->capacity;
+        dst.splice(dst.end(), idles, it->second);
+        lut.erase(it);
+    }
+
+    decltype(lut)::iterator find(std::list<Idle>::iterator idle) {
+        auto it = lut.lower_bound({idle->type, idle->capacity});
+        while (it->second != idle)
+            ++it;
+        return it;
+    }
+};
+
+Pool &getPool() {
+    static Pool *pool = new Pool;  // outlives static destructors still giving buffers back
+    return *pool;
+}
+
+}
+
+ZENO_API void enable(std::size_t budget) {
+    getPool().budget.store(std::max(budget, kMinPooled), std::memory_order_relaxed);
+    log_debug("frame heap enabled, {} bytes may stay idle", budget);
+}
+
+ZENO_API bool enabled() {
+    return getPool().budget.load(std::memory_order_relaxed) != 0;
+}
+
+ZENO_API void give(std::type_info const &type, std::size_t capacity, std::unique_ptr<Buffer> buf) {
+    auto &pool = getPool();
+    if (!enabled())
+        return;
+    std::lock_guard lck(pool.mtx);
+    auto idle = pool.idles.insert(pool.idles.end(), Idle{std::move(buf), std::type_index(type), capacity, pool.epoch});
+    pool.lut.emplace(std::make_pair(idle->type, capacity), idle);
+    pool.idleBytes += capacity;
+}
+
+ZENO_API std::unique_ptr<Buffer> take(std::type_info const &type, std::size_t size) {
+    auto &pool = getPool();
+    std::lock_guard lck(pool.mtx);
+    auto it = pool.lut.lower_bound({std::type_index(type), size});
+    // a buffer much bigger than asked is better left for a bigger array
+    if (it == pool.lut.end() || it->first.first != std::type_index(type) || it->first.second > 2 * size)
+        return nullptr;
+    std::list<Idle> taken;
+    pool.release(it, taken);
+    return std::move(taken.front().buf);
+}
+
+ZENO_API void recycle() {
+    auto &pool = getPool();
+    auto budget = pool.budget.load(std::memory_order_relaxed);
+    if (!budget)
+        return;
+    std::list<Idle> freed;  // destroyed outside of the lock
+    {
+        std::lock_guard lck(pool.mtx);
+        std::size_t before = pool.idleBytes;
+        // given back before the last frame and not taken since, so not in the working set
+        for (auto it = pool.lut.begin(); it != pool.lut.end();) {
+            auto cur = it++;
+            if (cur->second->epoch < pool.epoch)
+                pool.release(cur, freed);
+        }
+        while (pool.idleBytes > budget)
+            pool.release(pool.find(pool.idles.begin()), freed);
+        pool.epoch++;
+        if (before != pool.idleBytes)
+            log_debug("frame heap freed {} bytes, {} bytes kept", before - pool.idleBytes, pool.idleBytes);
+    }
+}
+
+}
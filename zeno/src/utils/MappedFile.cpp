@@ -0,0 +1,95 @@
+#include <zeno/utils/MappedFile.h>
+#include <zeno/utils/log.h>
+#include <filesystem>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace zeno {
+
+#ifdef _WIN32
+
+ZENO_API MappedFile::MappedFile(std::string const &path) {
+    auto wpath = std::filesystem::u8path(path).wstring();
+    HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        log_error("failed to open file for mapping: {}", path);
+        return;
+    }
+    m_file = file;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        log_error("failed to get size of file: {}", path);
+        return;
+    }
+    m_size = size.QuadPart;
+    if (m_size == 0) {
+        m_valid = true;
+        return;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        log_error("failed to create file mapping: {}", path);
+        return;
+    }
+    m_mapping = mapping;
+    m_data = (char const *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data) {
+        log_error("failed to map view of file: {}", path);
+        return;
+    }
+    m_valid = true;
+}
+
+ZENO_API MappedFile::~MappedFile() {
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file)
+        CloseHandle(m_file);
+}
+
+#else
+
+ZENO_API MappedFile::MappedFile(std::string const &path) {
+    m_fd = open(std::filesystem::u8path(path).c_str(), O_RDONLY);
+    if (m_fd == -1) {
+        log_error("failed to open file for mapping: {}", path);
+        return;
+    }
+    struct stat st;
+    if (fstat(m_fd, &st) == -1) {
+        log_error("failed to get size of file: {}", path);
+        return;
+    }
+    m_size = st.st_size;
+    if (m_size == 0) {
+        m_valid = true;
+        return;
+    }
+    void *p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (p == MAP_FAILED) {
+        log_error("failed to mmap file: {}", path);
+        return;
+    }
+    m_data = (char const *)p;
+    m_valid = true;
+}
+
+ZENO_API MappedFile::~MappedFile() {
+    if (m_data)
+        munmap((void *)m_data, m_size);
+    if (m_fd != -1)
+        close(m_fd);
+}
+
+#endif
+
+}
@@ -0,0 +1,201 @@
+#include <zeno/utils/SharedMemory.h>
+#include <zeno/utils/log.h>
+#include <zeno/utils/scope_exit.h>
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <cstring>
+#include <cerrno>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace zeno {
+
+#ifdef _WIN32
+
+ZENO_API bool SharedMemory::supported() {
+    return false;
+}
+
+ZENO_API std::string SharedMemory::publish(std::size_t size, std::function<void(char *)> const &fill) {
+    return {};
+}
+
+ZENO_API std::string SharedMemory::publish(const char *data, std::size_t size) {
+    return {};
+}
+
+ZENO_API bool SharedMemory::consume(std::string const &name, std::function<void(const char *, std::size_t)> const &func) {
+    log_error("shared memory not supported on this platform");
+    return false;
+}
+
+ZENO_API std::size_t SharedMemory::pendingPublished() {
+    return 0;
+}
+
+ZENO_API void SharedMemory::releasePublished(int idleTimeoutMs) {
+}
+
+ZENO_API void SharedMemory::removeOrphans() {
+}
+
+#else
+
+namespace {
+
+constexpr const char kNamePrefix[] = "/zeno-";
+
+// names of the segments published by this process and not known to be consumed yet
+struct Published {
+    std::mutex mtx;
+    std::set<std::string> names;
+
+    // the consumer unlinks each segment once mapped, so a failing open means consumed
+    std::size_t prune() {
+        std::lock_guard lck(mtx);
+        for (auto it = names.begin(); it != names.end();) {
+            int fd = shm_open(it->c_str(), O_RDONLY, 0);
+            if (fd == -1 && errno == ENOENT) {
+                it = names.erase(it);
+            } else {
+                if (fd != -1)
+                    close(fd);
+                ++it;
+            }
+        }
+        return names.size();
+    }
+};
+
+Published &published() {
+    static Published instance;
+    return instance;
+}
+
+}
+
+ZENO_API bool SharedMemory::supported() {
+    return true;
+}
+
+ZENO_API std::string SharedMemory::publish(std::size_t size, std::function<void(char *)> const &fill) {
+    static std::atomic<unsigned> counter{0};
+    std::string name = kNamePrefix + std::to_string(getpid()) + "-" + std::to_string(counter++);
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) {
+        log_warn("failed to create shared memory {}: {}", name, std::strerror(errno));
+        return {};
+    }
+    bool ok = false;
+    if (ftruncate(fd, size) == 0) {
+        void *p = size ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : nullptr;
+        if (p != MAP_FAILED) {
+            if (size) {
+                fill((char *)p);
+                munmap(p, size);
+            }
+            ok = true;
+        }
+    }
+    close(fd);
+    if (!ok) {
+        log_warn("failed to fill shared memory {}: {}", name, std::strerror(errno));
+        shm_unlink(name.c_str());
+        return {};
+    }
+    auto &pub = published();
+    std::lock_guard lck(pub.mtx);
+    pub.names.insert(name);
+    return name;
+}
+
+ZENO_API std::string SharedMemory::publish(const char *data, std::size_t size) {
+    return publish(size, [&] (char *p) {
+        std::memcpy(p, data, size);
+    });
+}
+
+ZENO_API bool SharedMemory::consume(std::string const &name, std::function<void(const char *, std::size_t)> const &func) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) {
+        log_error("failed to open shared memory {}: {}", name, std::strerror(errno));
+        return false;
+    }
+    shm_unlink(name.c_str());  // the mapping stays valid until unmapped
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return false;
+    }
+    std::size_t size = st.st_size;
+    void *p = size ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+    close(fd);
+    if (p == MAP_FAILED) {
+        log_error("failed to map shared memory {}: {}", name, std::strerror(errno));
+        return false;
+    }
+    scope_exit unmap{[&] {
+        if (size)
+            munmap(p, size);
+    }};
+    func((const char *)p, size);
+    return true;
+}
+
+ZENO_API std::size_t SharedMemory::pendingPublished() {
+    return published().prune();
+}
+
+ZENO_API void SharedMemory::releasePublished(int idleTimeoutMs) {
+    auto &pub = published();
+    std::size_t pending = pub.prune();
+    auto lastProgress = std::chrono::steady_clock::now();
+    while (pending && std::chrono::steady_clock::now() - lastProgress < std::chrono::milliseconds(idleTimeoutMs)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::size_t left = pub.prune();
+        if (left < pending)
+            lastProgress = std::chrono::steady_clock::now();
+        pending = left;
+    }
+    std::lock_guard lck(pub.mtx);
+    if (!pub.names.empty())
+        log_warn("removing {} shared memory segments never consumed", pub.names.size());
+    for (auto const &name: pub.names)
+        shm_unlink(name.c_str());
+    pub.names.clear();
+}
+
+ZENO_API void SharedMemory::removeOrphans() {
+#ifdef __linux__
+    std::error_code ec;
+    for (auto const &entry: std::filesystem::directory_iterator("/dev/shm", ec)) {
+        // names are /zeno-<pid>-<counter>, the leading slash is not part of the file name
+        auto fname = entry.path().filename().string();
+        if (fname.rfind(kNamePrefix + 1, 0) != 0)
+            continue;
+        auto pidstr = fname.substr(sizeof(kNamePrefix) - 2);
+        pidstr = pidstr.substr(0, pidstr.find('-'));
+        if (pidstr.empty() || !std::all_of(pidstr.begin(), pidstr.end(), [] (char c) { return c >= '0' && c <= '9'; }))
+            continue;
+        pid_t pid = std::stoi(pidstr);
+        if (kill(pid, 0) == -1 && errno == ESRCH) {
+            log_debug("removing orphan shared memory {}", fname);
+            shm_unlink(("/" + fname).c_str());
+        }
+    }
+#endif
+}
+
+#endif
+
+}
@@ -76,8 +76,11 @@ bool Scene::loadFrameObjects(int frameid) {
     const auto& cbLoadObjs = [this](std::map<std::string, std::shared_ptr<zeno::IObject>> const& objs) -> bool {
         return this->objectsMan->load_objects(objs);
     };
+    const auto& needObject = [this](std::string const& key) -> bool {
+        return this->objectsMan->objects.find(key) == this->objectsMan->objects.end();
+    };
     bool isFrameValid = false;
-    bool inserted = zeno::getSession().globalComm->load_objects(frameid, cbLoadObjs, isFrameValid);
+    bool inserted = zeno::getSession().globalComm->load_objects(frameid, cbLoadObjs, isFrameValid, needObject);
     if (!isFrameValid)
         return false;
 